@@ -0,0 +1,128 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Cost of the protocol core alone, without ns-3 (see kdtmCore).
+ *
+ * A NeighborTable of "neighbors" entries driven by a ManualClock is filled
+ * once, then each operation is run "iterations" times and its mean time is
+ * printed:
+ *
+ *  - hello: AddEntry of a neighbor keeping its trend, by neighbor
+ *  - kinematics: UpdateMyKinematics after a turn, by neighbor
+ *  - degree: CalculateDegree, by neighbor
+ *  - position: GetPosition of each neighbor, by neighbor
+ *  - positions: GetPositions of all the neighbors, by neighbor
+ *  - copies: Add of a copy and mean position of the copies of a warning
+ *  - codec: EncodeHello and DecodeHello of a hello
+ *
+ * It only includes the core headers and builds with the core sources:
+ *
+ *   kdtm-core-benchmark [neighbors [iterations]]
+ */
+
+#include "kdtm-neighbor-table.h"
+#include "kdtm-copy-queue.h"
+#include "kdtm-codec.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace ns3::kdtm;
+
+/// Runs f iterations times, prints the mean time per unit
+template <class F>
+static void
+Measure (char const *name, char const *unit, uint32_t iterations, uint32_t units, F f)
+{
+  double sum = 0;
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  for (uint32_t k = 0; k < iterations; k++)
+    {
+      sum += f (k);
+    }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+  double ns = std::chrono::duration<double, std::nano> (end - begin).count ();
+  std::cout << name << " " << ns / iterations / units << " ns/" << unit << " (sum " << sum << ")" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t neighbors = argc > 1 ? std::atoi (argv[1]) : 200;
+  uint32_t iterations = argc > 2 ? std::atoi (argv[2]) : 10000;
+
+  // Neighbors on both sides of the node, entering and leaving its range
+  ManualClock clock (SecondsToTableTime (10));
+  NeighborTable table (250, CoreVector (0, 0, 0), CoreVector (25, 0, 0));
+  table.SetClock (&clock);
+  table.SetTrajectoryBegin (SecondsToTableTime (-30));
+  for (uint32_t j = 0; j < neighbors; j++)
+    {
+      double x = -1000.0 + 2000.0 * j / neighbors;
+      table.AddEntry (j, CoreVector (x, 4.0 * (j % 4), 0), CoreVector (20.0 + (j % 11), 0, 0),
+                      clock.Now (), 1.0 / (100 + j % 50), SecondsToTableTime (- (double) (j % 20)));
+    }
+
+  Measure ("hello", "neighbor", iterations, neighbors, [&] (uint32_t k) {
+    TableTime now = SecondsToTableTime (10 + 1e-3 * k);
+    double dt = 1e-3 * k;
+    for (uint32_t j = 0; j < neighbors; j++)
+      {
+        double x = -1000.0 + 2000.0 * j / neighbors + (20.0 + (j % 11)) * dt;
+        table.AddEntry (j, CoreVector (x, 4.0 * (j % 4), 0), CoreVector (20.0 + (j % 11), 0, 0),
+                        now, 1.0 / (100 + j % 50), SecondsToTableTime (- (double) (j % 20)));
+      }
+    return (double) table.GetNFastUpdates ();
+  });
+
+  Measure ("kinematics", "neighbor", iterations, neighbors, [&] (uint32_t k) {
+    // Alternate between two headings, all the windows are recomputed
+    double vy = k % 2 ? 5 : -5;
+    return (double) table.UpdateMyKinematics (clock.Now (), CoreVector (0, 0, 0), CoreVector (25, vy, 0));
+  });
+
+  clock.Set (SecondsToTableTime (12));
+  Measure ("degree", "neighbor", iterations, neighbors, [&] (uint32_t k) {
+    return table.CalculateDegree (12);
+  });
+
+  Measure ("position", "neighbor", iterations, neighbors, [&] (uint32_t k) {
+    TableTime now = SecondsToTableTime (12 + 1e-3 * k);
+    double sum = 0;
+    for (uint32_t j = 0; j < neighbors; j++)
+      {
+        sum += table.GetPosition (j, now).x;
+      }
+    return sum;
+  });
+
+  std::vector<uint32_t> ids;
+  std::vector<double> x, y;
+  Measure ("positions", "neighbor", iterations, neighbors, [&] (uint32_t k) {
+    table.GetPositions (SecondsToTableTime (12 + 1e-3 * k), ids, x, y);
+    return x.back ();
+  });
+
+  CopyQueue<CopyEntry> queue;
+  Measure ("copies", "copy", iterations, 1, [&] (uint32_t k) {
+    uint32_t messageId = k / 8;
+    queue.Add (CopyEntry (CoreVector (k % 250, 0, 0), 0, messageId, k));
+    if (k % 8 == 7)
+      {
+        queue.Purge (messageId);
+      }
+    return queue.GetMeanPosition (messageId).x;
+  });
+
+  Measure ("codec", "hello", iterations, 1, [&] (uint32_t k) {
+    HelloFields fields = { k, 1, 2, 3, 4, 5, 6 };
+    uint8_t b[HELLO_SIZE];
+    EncodeHello (b, fields);
+    DecodeHello (b, fields);
+    return (double) fields.id;
+  });
+
+  return 0;
+}
@@ -1,26 +1,1584 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
+/*
+ * Highway warning dissemination scenario for kDTM.
+ *
+ * Vehicles drive on a straight multi-lane highway (half of the lanes in each
+ * direction) with constant velocity.  Beacons and warnings are delivered over
+ * an ideal disk channel of radius "range": every vehicle inside the range of
+ * the sender receives the frame after a fixed frame time.  Each vehicle keeps
+ * a kDTM PositionTable filled by periodic hellos and a warning Queue; on
+ * backoff expiry it rebroadcasts a warning when its distance to the mean
+ * position of the copies it heard exceeds the kinetic threshold.
+ *
+ * At the end of the run a single line is written on the standard output:
+ *
+ *   kdtm-stats vehicles=<n> meanDegree=<d> ...
+ *
+ * which is the format consumed by kdtm-sweep.
+ *
+ * With --distributed (ns-3 configured with --enable-mpi) the highway is cut
+ * in one strip per rank (SpatialPartition) and each rank only simulates the
+ * protocol state of the vehicles that started in its strip:
+ *
+ *   mpirun -np 4 ./waf --run "kdtm-example --distributed"
+ *
+ * Vehicle kinematics are deterministic and replicated on every rank, so the
+ * hellos of the ghost vehicles (remote vehicles close to the local ones) are
+ * generated locally.  Warnings towards vehicles of another rank are sent
+ * with MpiInterface::SendPacket; a point-to-point remote link of one frame
+ * time between consecutive ranks gives the simulator its lookahead.
+ *
+ * With --trace=<file> the vehicles follow a binary mobility trace produced
+ * by kdtm-trace-convert (SUMO FCD or ns-2 movements) instead of driving on
+ * the synthetic highway.  The trace is memory mapped and streamed, vehicles
+ * only take part in the protocol while they are in the trace.
+ *
+ * With --record=<file> every warning reception and rebroadcast decision is
+ * appended to a columnar binary file, see kdtm-record-reader.
+ *
+ * With --deliveries=<file> every call into the protocol core of a vehicle
+ * (hello added to its table, copy added to its queue, decision, sample) is
+ * written with its inputs to a binary file that kdtm-replay feeds back to
+ * the core alone, without channel, mobility or packets.
+ *
+ * Filling the neighbor tables takes the first seconds of every run.  With
+ * --saveSnapshot=<file> the protocol state of all the vehicles (kinematics,
+ * position tables, queues) is written at --snapshotTime; runs started with
+ * --loadSnapshot=<file> restore it instead of simulating the warm-up and
+ * continue from there with their own --run, e.g. for a sweep on the backoff:
+ *
+ *   ./waf --run "kdtm-example --saveSnapshot=warm.snp"
+ *   ./waf --run "kdtm-example --loadSnapshot=warm.snp --maxBackoff=0.1 --run=2"
+ *
+ * Simulation time restarts at 0 in a restored run, the other times
+ * (--warningTime, --simTime) stay those of the original scenario.
+ *
+ * --stability, --degree and --threshold select the kinetic degree and
+ * threshold models (see CreateKineticModel), e.g. the fixed threshold
+ * distance-to-mean baseline:
+ *
+ *   ./waf --run "kdtm-example --threshold=constant"
+ *
+ * --compactWarnings sends the warnings as KDTM_WARNING_COMPACT
+ * (CompactWarningHeader) instead of KDTM_WARNING.  The warning bytes sent
+ * and their airtime on an 802.11p 10 MHz channel at 6 Mbit/s are reported
+ * as warningBytes and warningAirtime.
+ *
+ * --warnings=<n> raises n hazards at --warningTime, spread evenly along the
+ * road, each one disseminated as its own message.  With --batchWindow=<s>
+ * the rebroadcasts of a vehicle are held for at most that time and the ones
+ * pending together are sent as a single KDTM_WARNING_BATCH frame
+ * (AggregateWarnings).  framesSaved is the number of frames the batches
+ * spared and batchDelay the mean time a rebroadcast was held.
+ *
+ * With --piggyback every warning frame starts with the kinematics of its
+ * sender (KDTM_NEIGHBOR_STATE), receivers refresh their PositionTable with
+ * them as with a hello, and a vehicle skips the hellos due less than a hello
+ * interval after its last warning.  hellos is the number of hello frames
+ * sent.  Not with --distributed: the ranks of the ghosts of a vehicle do not
+ * know when it deferred its hellos.
+ *
+ * --failedVehicles=<f> turns off the radio of that fraction of the vehicles
+ * at --failureTime: they stop sending and receiving, but stay in the tables
+ * of their neighbors until their predicted link window ends.  With
+ * --txFeedback the hellos stand for acknowledged frames: the neighbors of
+ * the sender table which did not receive one are reported to its MAC TX
+ * error callback, and PositionTable evicts them after its TX failure limit.
+ * Comparing both runs,
+ *
+ *   ./waf --run "kdtm-example --failedVehicles=0.2"
+ *   ./waf --run "kdtm-example --failedVehicles=0.2 --txFeedback"
+ *
+ * meanTableSize is the mean number of entries of the sampled tables,
+ * evictions the number of neighbors evicted and efficiency the number of
+ * vehicles reached per warning transmission.
+ *
+ * With --twoHopSummary every hello starts with a summary of the neighbors
+ * of its sender (KDTM_NEIGHBOR_SUMMARY), kept by the receivers with the
+ * entry of the sender, of --summaryBits bits per neighbor.  A vehicle whose neighbors are all covered by the
+ * vehicles it heard a warning from does not rebroadcast it.  summaryBytes
+ * is the number of bytes the summaries added to the hellos and pruned the
+ * number of rebroadcasts they avoided.
+ *
+ * Every vehicle schedules its own hello event by default.  With
+ * --helloSlot=<s> a HelloScheduler groups the hello deadlines of all the
+ * vehicles in slots of that width and sends the hellos of a slot from a
+ * single event; each vehicle keeps the phase of its deadlines.
+ * helloEvents is the number of simulator events that sent hellos and
+ * helloLateness the mean time a hello was sent after its deadline.
+ *
+ * The end-to-end figures of the warnings are computed as they go by a
+ * DisseminationKpi, in log-bucket histograms: latencyP50, latencyP95 and
+ * latencyMax of the first receptions, hopsP95, coverage (vehicles reached
+ * among those within --targetRadius of the source when the warning was
+ * raised) and txPerDelivery (transmissions per vehicle reached).  With
+ * --kpi=<file> the figures of each warning and of the run are written to
+ * that file.
+ *
+ * --tableDump=<file> writes the time, index and table of every vehicle at
+ * each sample through an AsyncTraceWriter: the text goes to a ring drained
+ * to the file by a thread of its own.  With --dumpPolicy=drop the
+ * simulation never waits for the disk, the records which do not fit in the
+ * ring of --dumpRecords records are counted in dumpDropped.
+ */
+
 #include "ns3/core-module.h"
-#include "ns3/kdtm-helper.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/kdtm-ptable.h"
+#include "ns3/kdtm-packet.h"
+#include "ns3/kdtm-wqueue.h"
+#include "ns3/kdtm-partition.h"
+#include "ns3/kdtm-trace.h"
+#include "ns3/kdtm-record.h"
+#include "ns3/kdtm-snapshot.h"
+#include "ns3/kdtm-kinetic-model.h"
+#include "ns3/kdtm-replay.h"
+#include "ns3/kdtm-hello-scheduler.h"
+#include "ns3/kdtm-kpi.h"
+#include "ns3/kdtm-trace-writer.h"
+
+#ifdef NS3_MPI
+#include <mpi.h>
+#include "ns3/mpi-interface.h"
+#include "ns3/mpi-receiver.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/simple-net-device.h"
+#endif
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <vector>
 
 using namespace ns3;
+using namespace ns3::kdtm;
+
+NS_LOG_COMPONENT_DEFINE ("KdtmExample");
+
+/// State of one vehicle of the scenario
+struct Vehicle
+{
+  Vehicle (double range)
+    : table (range, Vector (0, 0, 0), Vector (0, 0, 0)),
+      local (true),
+      advertised (false),
+      failed (false)
+  {
+  }
+
+  Ptr<Node> node;
+  Ptr<MobilityModel> mobility;
+  PositionTable table;
+  Queue queue;
+  Time trajectoryBegin;
+  bool local;     // protocol state simulated by this rank
+  std::set<uint32_t> received;   // message ids
+  std::set<uint32_t> forwarded;  // message ids sent or decided
+  std::set<uint32_t> targeted;   // message ids whose target area the vehicle was in
+  /// Rebroadcasts waiting for the batch window, and since when
+  std::vector<Ptr<Packet> > pending;
+  std::vector<Time> pendingSince;
+  EventId flush;
+  /// A warning carried the kinematics of the vehicle at stateAdvertised
+  bool advertised;
+  Time stateAdvertised;
+  /// MAC address of the vehicle, for the TX errors of its neighbors
+  Mac48Address address;
+  /// Radio turned off by --failedVehicles
+  bool failed;
+};
+
+class KdtmExample
+{
+public:
+  KdtmExample ();
+  ~KdtmExample ();
+
+  /// Parse command line, return false if the scenario can not be run
+  bool Configure (int argc, char **argv);
+  /// Build the scenario and run the simulation
+  void Run ();
+  /// Sum the statistics of all the ranks on rank 0
+  void Gather ();
+  /// Release the distributed simulation
+  void Finish ();
+#ifdef NS3_MPI
+  /// Sum the buckets of a histogram of all the ranks on rank 0
+  static void ReduceHistogram (LogHistogram & histogram);
+#endif
+  /// Write the kdtm-stats line
+  void Report (std::ostream & os);
+
+private:
+  ///\name parameters
+  //\{
+  uint32_t m_run;
+  double m_density;       // vehicles per km and per lane
+  uint32_t m_lanes;
+  double m_roadLength;    // m
+  double m_range;         // m
+  double m_alpha;
+  double m_simTime;       // s
+  double m_helloInterval; // s
+  double m_warningTime;   // s
+  double m_maxBackoff;    // s
+  double m_frameTime;     // s
+  bool m_distributed;
+  std::string m_trace;
+  std::string m_record;
+  std::string m_deliveries;
+  std::string m_saveSnapshot;
+  std::string m_loadSnapshot;
+  double m_snapshotTime;  // s
+  std::string m_stabilityModel;
+  std::string m_degreeModel;
+  std::string m_thresholdModel;
+  double m_degreeEpsilon;
+  bool m_compactWarnings;
+  uint32_t m_warnings;
+  double m_batchWindow;   // s
+  bool m_piggyback;
+  double m_failedVehicles;  // fraction
+  double m_failureTime;   // s
+  bool m_txFeedback;
+  bool m_twoHopSummary;
+  uint32_t m_summaryBits;   // per neighbor
+  double m_helloSlot;     // s, 0 for an event per hello
+  std::string m_kpiFile;
+  double m_targetRadius;  // m
+  std::string m_tableDump;
+  std::string m_dumpPolicy;
+  uint32_t m_dumpRecords;
+  //\}
 
+  uint32_t m_systemId;
+  uint32_t m_systemCount;
+  SpatialPartition m_partition;
+  MobilityTraceStreamer m_streamer;
+  DisseminationRecorder m_recorder;
+  DeliveryRecorder m_deliveryRecorder;
+  Ptr<KineticModel> m_model;
+  HelloScheduler m_helloScheduler;
+  DisseminationKpi m_kpi;
+  AsyncTraceWriter m_dump;
+  double m_roadBegin;     // x range of the road
+  double m_roadEnd;
+  /// Scenario time of the simulation time 0, the time of the restored snapshot
+  Time m_timeOrigin;
 
-int 
+  std::vector<Vehicle *> m_vehicles;
+  /// node id -> index in m_vehicles
+  std::map<uint32_t, uint32_t> m_vehicleIndex;
+  Ptr<UniformRandomVariable> m_random;
+
+  ///\name statistics
+  //\{
+  uint64_t m_samples;
+  double m_degreeSum;
+  double m_thresholdSum;
+  uint32_t m_reached;
+  uint32_t m_transmissions;
+  uint64_t m_warningBytes;
+  double m_warningAirtime; // s
+  uint32_t m_hopSum;
+  Time m_warningStart;
+  Time m_lastReception;
+  uint32_t m_batchFrames;
+  uint32_t m_batchedWarnings;
+  double m_batchDelaySum;  // s
+  uint32_t m_batchDelays;
+  uint32_t m_hellos;
+  uint32_t m_deferredHellos;
+  double m_tableSizeSum;
+  uint64_t m_evictions;
+  uint64_t m_summaryBytes;
+  uint32_t m_pruned;
+  uint64_t m_helloEvents;
+  double m_helloLateness;  // s
+  uint64_t m_dumpDropped;
+  //\}
+
+  void CreateVehicles ();
+  void CreateTraceVehicles ();
+  /// Create the vehicles of the snapshot, false if it can not be read
+  bool LoadSnapshot ();
+  void SaveSnapshot ();
+  Vehicle * CreateVehicle (uint32_t owner);
+  void CreateRemoteLinks ();
+  void UpdatePartitionExtent ();
+  /// Warning positions are unsigned, vehicles that left the road are clamped
+  static uint64_t EncodePosition (double coordinate);
+  /// Duration of a frame of size bytes of kDTM headers on the channel
+  static double GetAirtime (uint32_t size);
+  /// Warning with the headers selected by --compactWarnings
+  Ptr<Packet> CreateWarning (uint32_t sourceId, uint32_t prevHopId, uint32_t hopCount,
+                             uint32_t messageId, Vector position) const;
+  bool InRange (uint32_t i, uint32_t j) const;
+  /// False for the vehicles of a trace which are not on the road and for
+  /// the failed ones
+  bool IsActive (uint32_t i) const;
+  void UpdateKinematics (uint32_t i);
+
+  void SendHello (uint32_t i);
+  /// Schedule the hello of vehicle i due at deadline
+  void ScheduleHello (uint32_t i, Time deadline);
+  /// Report the neighbors of the table of i which missed its hello as TX errors
+  void ReportHelloFailures (uint32_t i);
+  void Sample ();
+  /// Turn off the radio of the --failedVehicles
+  void FailVehicles ();
+
+  void StartWarning ();
+  void Broadcast (uint32_t i, Ptr<Packet> packet);
+  /// Broadcast a rebroadcast, or hold it for the batch window
+  void Rebroadcast (uint32_t i, Ptr<Packet> packet);
+  /// Send the rebroadcasts held by a vehicle
+  void FlushBatch (uint32_t i);
+  void ReceiveWarning (uint32_t i, Ptr<Packet> packet);
+  /// Reception of a single warning frame, with the kinematics of its sender if not 0
+  void ReceiveSingleWarning (uint32_t i, Ptr<Packet> packet, NeighborStateHeader const *state);
+  /// Reception of a warning sent by another rank, the context is the receiver node id
+  void ReceiveRemoteWarning (Ptr<Packet> packet);
+  void BackOffExpired (uint32_t i, uint32_t messageId);
+  void Record (uint32_t i, uint32_t messageId, uint32_t hopCount, uint32_t prevHop,
+               DisseminationDecision decision, double threshold);
+};
+
+int
 main (int argc, char *argv[])
 {
-  bool verbose = true;
+  KdtmExample example;
+  if (!example.Configure (argc, argv))
+    {
+      NS_FATAL_ERROR ("Configuration failed. Aborted.");
+    }
 
+  example.Run ();
+  example.Gather ();
+  example.Report (std::cout);
+  example.Finish ();
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+KdtmExample::KdtmExample ()
+  : m_run (1),
+    m_density (20),
+    m_lanes (4),
+    m_roadLength (5000),
+    m_range (250),
+    m_alpha (10),
+    m_simTime (60),
+    m_helloInterval (1),
+    m_warningTime (30),
+    m_maxBackoff (0.05),
+    m_frameTime (0.001),
+    m_distributed (false),
+    m_snapshotTime (25),
+    m_stabilityModel ("poisson"),
+    m_degreeModel ("sigmoid"),
+    m_thresholdModel ("exponential"),
+    m_degreeEpsilon (0),
+    m_compactWarnings (false),
+    m_warnings (1),
+    m_batchWindow (0),
+    m_piggyback (false),
+    m_failedVehicles (0),
+    m_failureTime (20),
+    m_txFeedback (false),
+    m_twoHopSummary (false),
+    m_summaryBits (8),
+    m_helloSlot (0),
+    m_targetRadius (1000),
+    m_dumpPolicy ("block"),
+    m_dumpRecords (16384),
+    m_systemId (0),
+    m_systemCount (1),
+    m_roadBegin (0),
+    m_roadEnd (0),
+    m_samples (0),
+    m_degreeSum (0),
+    m_thresholdSum (0),
+    m_reached (0),
+    m_transmissions (0),
+    m_warningBytes (0),
+    m_warningAirtime (0),
+    m_hopSum (0),
+    m_batchFrames (0),
+    m_batchedWarnings (0),
+    m_batchDelaySum (0),
+    m_batchDelays (0),
+    m_hellos (0),
+    m_deferredHellos (0),
+    m_tableSizeSum (0),
+    m_evictions (0),
+    m_summaryBytes (0),
+    m_pruned (0),
+    m_helloEvents (0),
+    m_helloLateness (0),
+    m_dumpDropped (0)
+{
+}
+
+KdtmExample::~KdtmExample ()
+{
+  for (std::vector<Vehicle *>::iterator i = m_vehicles.begin (); i != m_vehicles.end (); ++i)
+    {
+      delete *i;
+    }
+}
+
+bool
+KdtmExample::Configure (int argc, char **argv)
+{
   CommandLine cmd;
-  cmd.AddValue ("verbose", "Tell application to log if true", verbose);
+  cmd.AddValue ("run", "Run number of the random generator", m_run);
+  cmd.AddValue ("density", "Vehicles per km and per lane", m_density);
+  cmd.AddValue ("lanes", "Number of lanes (half in each direction)", m_lanes);
+  cmd.AddValue ("roadLength", "Highway length (m)", m_roadLength);
+  cmd.AddValue ("range", "Transmission range (m)", m_range);
+  cmd.AddValue ("alpha", "Steepness of the link double sigmoid", m_alpha);
+  cmd.AddValue ("simTime", "Simulation time (s)", m_simTime);
+  cmd.AddValue ("helloInterval", "Hello interval (s)", m_helloInterval);
+  cmd.AddValue ("warningTime", "Time the warning is raised (s)", m_warningTime);
+  cmd.AddValue ("maxBackoff", "Maximum rebroadcast backoff (s)", m_maxBackoff);
+  cmd.AddValue ("distributed", "Partition the highway across MPI ranks", m_distributed);
+  cmd.AddValue ("trace", "Binary mobility trace written by kdtm-trace-convert", m_trace);
+  cmd.AddValue ("record", "File of the dissemination records", m_record);
+  cmd.AddValue ("deliveries", "File of the events delivered to the protocol core, see kdtm-replay",
+                m_deliveries);
+  cmd.AddValue ("saveSnapshot", "Write the protocol state to this file at snapshotTime", m_saveSnapshot);
+  cmd.AddValue ("snapshotTime", "Time the snapshot is written (s)", m_snapshotTime);
+  cmd.AddValue ("loadSnapshot", "Start from the protocol state of this snapshot", m_loadSnapshot);
+  cmd.AddValue ("stability", "Link stability model: poisson or unit", m_stabilityModel);
+  cmd.AddValue ("degree", "Link degree model: sigmoid or window", m_degreeModel);
+  cmd.AddValue ("threshold", "Threshold model: exponential or constant", m_thresholdModel);
+  cmd.AddValue ("degreeEpsilon", "Link degree under which a neighbor is left out of the kinetic degree",
+                m_degreeEpsilon);
+  cmd.AddValue ("compactWarnings", "Send warnings with the compact header", m_compactWarnings);
+  cmd.AddValue ("warnings", "Number of hazards raised at warningTime", m_warnings);
+  cmd.AddValue ("batchWindow", "Time rebroadcasts are held to be sent in one frame (s), 0 for none",
+                m_batchWindow);
+  cmd.AddValue ("piggyback", "Warnings carry the kinematics of their sender and defer its hellos",
+                m_piggyback);
+  cmd.AddValue ("failedVehicles", "Fraction of the vehicles whose radio fails at failureTime",
+                m_failedVehicles);
+  cmd.AddValue ("failureTime", "Time the radios fail (s)", m_failureTime);
+  cmd.AddValue ("txFeedback", "Evict the neighbors which miss hellos on MAC TX errors", m_txFeedback);
+  cmd.AddValue ("twoHopSummary", "Hellos carry a summary of the neighbors of their sender, used to "
+                "skip the rebroadcasts which reach no new neighbor", m_twoHopSummary);
+  cmd.AddValue ("summaryBits", "Bits of the neighbor summary per neighbor", m_summaryBits);
+  cmd.AddValue ("helloSlot", "Width of the slots the hellos are sent by (s), 0 for an event per hello",
+                m_helloSlot);
+  cmd.AddValue ("kpi", "File of the dissemination KPIs of each warning", m_kpiFile);
+  cmd.AddValue ("targetRadius", "Distance to the source of the vehicles a warning must reach (m)",
+                m_targetRadius);
+  cmd.AddValue ("tableDump", "File the tables of the vehicles are written to at each sample", m_tableDump);
+  cmd.AddValue ("dumpPolicy", "What the table dump does when its ring is full: block or drop",
+                m_dumpPolicy);
+  cmd.AddValue ("dumpRecords", "Records of the ring of the table dump", m_dumpRecords);
+  cmd.Parse (argc, argv);
+
+  RngSeedManager::SetRun (m_run);
+
+  m_model = CreateKineticModel (m_stabilityModel, m_degreeModel, m_thresholdModel);
+  if (!m_model)
+    {
+      std::cerr << "Unknown kinetic model " << m_stabilityModel << "/" << m_degreeModel
+                << "/" << m_thresholdModel << std::endl;
+      return false;
+    }
+
+  if (m_distributed)
+    {
+#ifdef NS3_MPI
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+      MpiInterface::Enable (&argc, &argv);
+      m_systemId = MpiInterface::GetSystemId ();
+      m_systemCount = MpiInterface::GetSize ();
+#else
+      std::cerr << "Distributed mode requires ns-3 configured with --enable-mpi" << std::endl;
+      return false;
+#endif
+    }
+
+  m_roadBegin = 0;
+  m_roadEnd = m_roadLength;
+  if (!m_trace.empty ())
+    {
+      if (!m_streamer.Open (m_trace))
+        {
+          return false;
+        }
+      m_roadBegin = m_streamer.GetHeader ()->xMin;
+      m_roadEnd = m_streamer.GetHeader ()->xMax;
+    }
+  if (!m_record.empty ())
+    {
+      std::ostringstream path;
+      path << m_record;
+      if (m_systemCount > 1)
+        {
+          path << "." << m_systemId;
+        }
+      if (!m_recorder.Open (path.str ()))
+        {
+          return false;
+        }
+    }
+
+  // The local extent is refreshed every hello interval, the halo covers the
+  // range and what two vehicles can drive towards each other meanwhile.
+  m_partition = SpatialPartition (m_roadBegin, m_roadEnd, m_systemCount,
+                                  m_range + 2 * 35 * m_helloInterval);
 
-  cmd.Parse (argc,argv);
+  // Snapshots hold the state of every vehicle and constant velocities
+  if ((!m_saveSnapshot.empty () || !m_loadSnapshot.empty ())
+      && (m_distributed || !m_trace.empty ()))
+    {
+      std::cerr << "Snapshots are only supported by sequential highway runs" << std::endl;
+      return false;
+    }
+  // Only the owner rank of a vehicle knows it sent a warning: the ranks
+  // of its ghosts would keep the hellos it defers
+  if (m_piggyback && m_distributed)
+    {
+      std::cerr << "--piggyback is only supported by sequential runs" << std::endl;
+      return false;
+    }
+  if (!m_deliveries.empty () && !m_loadSnapshot.empty ())
+    {
+      std::cerr << "Deliveries are recorded from empty tables, not from a snapshot" << std::endl;
+      return false;
+    }
+  if (!m_saveSnapshot.empty () && m_snapshotTime >= m_warningTime)
+    {
+      std::cerr << "The snapshot must be taken before the warning" << std::endl;
+      return false;
+    }
 
-  /* ... */
+  return m_density > 0 && m_lanes > 0 && m_roadLength > 0 && m_range > 0
+         && m_warningTime < m_simTime;
+}
+
+void
+KdtmExample::Run ()
+{
+  m_random = CreateObject<UniformRandomVariable> ();
+  if (!m_loadSnapshot.empty ())
+    {
+      if (!LoadSnapshot ())
+        {
+          NS_FATAL_ERROR ("Can not restore snapshot " << m_loadSnapshot);
+        }
+    }
+  else if (m_trace.empty ())
+    {
+      CreateVehicles ();
+    }
+  else
+    {
+      CreateTraceVehicles ();
+    }
+  CreateRemoteLinks ();
+  UpdatePartitionExtent ();
+
+  if (!m_deliveries.empty ())
+    {
+      DeliveryConfig config;
+      config.range = m_range;
+      config.alpha = m_alpha;
+      config.degreeEpsilon = m_degreeEpsilon;
+      config.stability = m_stabilityModel;
+      config.degree = m_degreeModel;
+      config.threshold = m_thresholdModel;
+      for (uint32_t i = 0; i < m_vehicles.size (); i++)
+        {
+          config.trajectoryBegin.push_back (m_vehicles[i]->trajectoryBegin);
+        }
+      std::ostringstream path;
+      path << m_deliveries;
+      if (m_systemCount > 1)
+        {
+          path << "." << m_systemId;
+        }
+      if (!m_deliveryRecorder.Open (path.str (), config))
+        {
+          NS_FATAL_ERROR ("Can not create " << path.str ());
+        }
+    }
+
+  if (!m_tableDump.empty ())
+    {
+      if (m_dumpPolicy != "block" && m_dumpPolicy != "drop")
+        {
+          NS_FATAL_ERROR ("Unknown --dumpPolicy=" << m_dumpPolicy);
+        }
+      std::ostringstream path;
+      path << m_tableDump;
+      if (m_systemCount > 1)
+        {
+          path << "." << m_systemId;
+        }
+      if (!m_dump.Open (path.str (), m_dumpRecords,
+                        m_dumpPolicy == "drop" ? KDTM_TRACE_DROP : KDTM_TRACE_BLOCK))
+        {
+          NS_FATAL_ERROR ("Can not create " << path.str ());
+        }
+    }
 
+  if (m_helloSlot > 0)
+    {
+      m_helloScheduler.SetSlot (Seconds (m_helloSlot));
+      m_helloScheduler.SetCallback (MakeCallback (&KdtmExample::SendHello, this));
+    }
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      ScheduleHello (i, Seconds (m_random->GetValue (0, m_helloInterval)));
+    }
+  Simulator::Schedule (Seconds (m_helloInterval), &KdtmExample::Sample, this);
+  Simulator::Schedule (Seconds (m_warningTime) - m_timeOrigin, &KdtmExample::StartWarning, this);
+  if (m_failedVehicles > 0 && Seconds (m_failureTime) >= m_timeOrigin)
+    {
+      Simulator::Schedule (Seconds (m_failureTime) - m_timeOrigin, &KdtmExample::FailVehicles, this);
+    }
+  if (!m_saveSnapshot.empty ())
+    {
+      if (Seconds (m_snapshotTime) < m_timeOrigin)
+        {
+          NS_FATAL_ERROR ("The snapshot time is before the restored snapshot");
+        }
+      Simulator::Schedule (Seconds (m_snapshotTime) - m_timeOrigin, &KdtmExample::SaveSnapshot, this);
+    }
+
+  Simulator::Stop (Seconds (m_simTime) - m_timeOrigin);
   Simulator::Run ();
+  if (m_helloSlot > 0)
+    {
+      m_helloEvents = m_helloScheduler.GetNEvents ();
+      m_helloScheduler.Clear ();
+    }
   Simulator::Destroy ();
-  return 0;
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      if (m_vehicles[i]->local)
+        {
+          m_evictions += m_vehicles[i]->table.GetNEvictions ();
+        }
+    }
+  m_recorder.Close ();
+  m_deliveryRecorder.Close ();
+  m_dump.Close ();
+  m_dumpDropped = m_dump.GetNDropped ();
+
+  if (!m_kpiFile.empty ())
+    {
+      std::ostringstream path;
+      path << m_kpiFile;
+      if (m_systemCount > 1)
+        {
+          path << "." << m_systemId;
+        }
+      std::ofstream os (path.str ().c_str ());
+      m_kpi.Write (os);
+    }
+}
+
+void
+KdtmExample::Gather ()
+{
+#ifdef NS3_MPI
+  if (!m_distributed)
+    {
+      return;
+    }
+  double local[] = { (double) m_samples, m_degreeSum, m_thresholdSum,
+                     (double) m_reached, (double) m_transmissions, (double) m_hopSum,
+                     (double) m_warningBytes, m_warningAirtime,
+                     (double) m_batchFrames, (double) m_batchedWarnings, m_batchDelaySum,
+                     (double) m_batchDelays, (double) m_hellos, (double) m_deferredHellos,
+                     m_tableSizeSum, (double) m_evictions, (double) m_summaryBytes,
+                     (double) m_pruned, (double) m_helloEvents, m_helloLateness,
+                     (double) m_dumpDropped };
+  double global[21];
+  MPI_Reduce (local, global, 21, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  double last = m_lastReception.GetSeconds ();
+  double globalLast;
+  MPI_Reduce (&last, &globalLast, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  m_samples = (uint64_t) global[0];
+  m_degreeSum = global[1];
+  m_thresholdSum = global[2];
+  m_reached = (uint32_t) global[3];
+  m_transmissions = (uint32_t) global[4];
+  m_hopSum = (uint32_t) global[5];
+  m_warningBytes = (uint64_t) global[6];
+  m_warningAirtime = global[7];
+  m_batchFrames = (uint32_t) global[8];
+  m_batchedWarnings = (uint32_t) global[9];
+  m_batchDelaySum = global[10];
+  m_batchDelays = (uint32_t) global[11];
+  m_hellos = (uint32_t) global[12];
+  m_deferredHellos = (uint32_t) global[13];
+  m_tableSizeSum = global[14];
+  m_evictions = (uint64_t) global[15];
+  m_summaryBytes = (uint64_t) global[16];
+  m_pruned = (uint32_t) global[17];
+  m_helloEvents = (uint64_t) global[18];
+  m_helloLateness = global[19];
+  m_dumpDropped = (uint64_t) global[20];
+  m_lastReception = Seconds (globalLast);
+
+  LogHistogram latency = m_kpi.GetLatency ();
+  LogHistogram hops = m_kpi.GetHops ();
+  ReduceHistogram (latency);
+  ReduceHistogram (hops);
+  double counts[] = { (double) m_kpi.GetNTargets (), (double) m_kpi.GetNReachedTargets (),
+                      (double) m_kpi.GetNTransmissions () };
+  double globalCounts[3];
+  MPI_Reduce (counts, globalCounts, 3, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  m_kpi.RestoreRun (latency, hops, (uint64_t) globalCounts[0], (uint64_t) globalCounts[1],
+                    (uint64_t) globalCounts[2]);
+#endif
+}
+
+#ifdef NS3_MPI
+void
+KdtmExample::ReduceHistogram (LogHistogram & histogram)
+{
+  std::vector<uint64_t> counts (histogram.GetNBuckets ());
+  for (uint32_t k = 0; k < counts.size (); k++)
+    {
+      counts[k] = histogram.GetBucketCount (k);
+    }
+  std::vector<uint64_t> global (counts.size ());
+  MPI_Reduce (&counts[0], &global[0], counts.size (), MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+  // Ranks without values must not bring their 0 to the bounds
+  double bounds[] = { histogram.GetCount () ? histogram.GetMin () : std::numeric_limits<double>::infinity (),
+                      histogram.GetCount () ? - histogram.GetMax () : std::numeric_limits<double>::infinity () };
+  double globalBounds[2];
+  MPI_Reduce (bounds, globalBounds, 2, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  double sum = histogram.GetSum ();
+  double globalSum;
+  MPI_Reduce (&sum, &globalSum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  histogram.Restore (global, globalSum, globalBounds[0], - globalBounds[1]);
+}
+#endif
+
+void
+KdtmExample::Finish ()
+{
+#ifdef NS3_MPI
+  if (m_distributed)
+    {
+      MpiInterface::Disable ();
+    }
+#endif
+}
+
+void
+KdtmExample::Report (std::ostream & os)
+{
+  if (m_systemId != 0)
+    {
+      return;
+    }
+  uint32_t n = m_vehicles.size ();
+  // Sources reached their own warning with no hop
+  uint32_t copies = n * m_warnings;
+  os << "kdtm-stats"
+     << " vehicles=" << n
+     << " meanDegree=" << (m_samples ? m_degreeSum / m_samples : 0)
+     << " meanThreshold=" << (m_samples ? m_thresholdSum / m_samples : 0)
+     << " reachability=" << (copies ? (double) m_reached / copies : 0)
+     << " transmissions=" << m_transmissions
+     << " meanHops=" << (m_reached > m_warnings ? (double) m_hopSum / (m_reached - m_warnings) : 0)
+     << " delay=" << (m_lastReception - m_warningStart).GetSeconds ()
+     << " warningBytes=" << m_warningBytes
+     << " warningAirtime=" << m_warningAirtime
+     << " framesSaved=" << m_batchedWarnings - m_batchFrames
+     << " batchDelay=" << (m_batchDelays ? m_batchDelaySum / m_batchDelays : 0)
+     << " hellos=" << m_hellos
+     << " meanTableSize=" << (m_samples ? m_tableSizeSum / m_samples : 0)
+     << " evictions=" << m_evictions
+     << " efficiency=" << (m_transmissions ? (double) m_reached / m_transmissions : 0)
+     << " summaryBytes=" << m_summaryBytes
+     << " pruned=" << m_pruned
+     << " helloEvents=" << m_helloEvents
+     << " helloLateness=" << (m_hellos ? m_helloLateness / m_hellos : 0)
+     << " latencyP50=" << m_kpi.GetLatency ().GetQuantile (0.5)
+     << " latencyP95=" << m_kpi.GetLatency ().GetQuantile (0.95)
+     << " latencyMax=" << m_kpi.GetLatency ().GetMax ()
+     << " hopsP95=" << m_kpi.GetHops ().GetQuantile (0.95)
+     << " coverage=" << m_kpi.GetCoverage ()
+     << " txPerDelivery=" << m_kpi.GetTransmissionsPerDelivery ()
+     << " dumpDropped=" << m_dumpDropped
+     << std::endl;
+
+  uint64_t updates = 0;
+  uint64_t fastUpdates = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      updates += m_vehicles[i]->table.GetNUpdates ();
+      fastUpdates += m_vehicles[i]->table.GetNFastUpdates ();
+    }
+  NS_LOG_INFO (fastUpdates << " of " << updates << " hellos of known neighbors only refreshed their entry");
+  NS_LOG_INFO (m_deferredHellos << " hellos deferred after a warning");
+}
+
+void
+KdtmExample::CreateVehicles ()
+{
+  uint32_t perLane = (uint32_t) (m_density * m_roadLength / 1000.0);
+  double laneWidth = 4.0;
+
+  for (uint32_t lane = 0; lane < m_lanes; lane++)
+    {
+      // lanes [0, lanes/2[ drive towards +x, the others towards -x
+      double direction = (lane < m_lanes / 2) ? 1.0 : -1.0;
+      for (uint32_t k = 0; k < perLane; k++)
+        {
+          // Every rank draws the same values: kinematics are replicated
+          Vector position (m_random->GetValue (0, m_roadLength), lane * laneWidth, 0);
+          Vector velocity (direction * m_random->GetValue (20, 35), 0, 0);
+          uint32_t owner = m_partition.GetOwner (position);
+
+          Vehicle *v = CreateVehicle (owner);
+          Ptr<ConstantVelocityMobilityModel> mobility = CreateObject<ConstantVelocityMobilityModel> ();
+          v->node->AggregateObject (mobility);
+          mobility->SetPosition (position);
+          mobility->SetVelocity (velocity);
+          v->mobility = mobility;
+        }
+    }
+  NS_LOG_INFO ("Created " << m_vehicles.size () << " vehicles");
+}
+
+void
+KdtmExample::CreateTraceVehicles ()
+{
+  NodeContainer nodes;
+  for (uint32_t i = 0; i < m_streamer.GetNVehicles (); i++)
+    {
+      Vehicle *v = CreateVehicle (m_partition.GetOwner (m_streamer.GetFirstPosition (i)));
+      nodes.Add (v->node);
+    }
+  m_streamer.Install (nodes);
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      m_vehicles[i]->mobility = m_vehicles[i]->node->GetObject<MobilityModel> ();
+    }
+  NS_LOG_INFO ("Created " << m_vehicles.size () << " vehicles from " << m_trace);
+}
+
+void
+KdtmExample::SaveSnapshot ()
+{
+  std::ofstream os (m_saveSnapshot.c_str (), std::ios::binary);
+  WriteSnapshotHeader (os, Simulator::Now () + m_timeOrigin, m_vehicles.size ());
+  SnapshotWrite (os, m_samples);
+  SnapshotWrite (os, m_degreeSum);
+  SnapshotWrite (os, m_thresholdSum);
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      Vehicle *v = m_vehicles[i];
+      SnapshotWrite (os, v->mobility->GetPosition ());
+      SnapshotWrite (os, v->mobility->GetVelocity ());
+      SnapshotWrite (os, v->trajectoryBegin + m_timeOrigin);
+      v->table.Save (os);
+      v->queue.Save (os);
+    }
+  if (!os)
+    {
+      NS_FATAL_ERROR ("Can not write snapshot " << m_saveSnapshot);
+    }
+  NS_LOG_INFO ("Saved the state of " << m_vehicles.size () << " vehicles to " << m_saveSnapshot);
+}
+
+bool
+KdtmExample::LoadSnapshot ()
+{
+  std::ifstream is (m_loadSnapshot.c_str (), std::ios::binary);
+  uint32_t n;
+  if (!ReadSnapshotHeader (is, m_timeOrigin, n)
+      || !SnapshotRead (is, m_samples)
+      || !SnapshotRead (is, m_degreeSum)
+      || !SnapshotRead (is, m_thresholdSum))
+    {
+      return false;
+    }
+  if (m_timeOrigin >= Seconds (m_warningTime))
+    {
+      std::cerr << "The snapshot was taken after the warning" << std::endl;
+      return false;
+    }
+
+  // The nodes are created in the order of the snapshot: the ids in the
+  // restored tables are those of the original run.
+  Time shift = - m_timeOrigin;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Vector position, velocity;
+      Time trajectoryBegin;
+      if (!SnapshotRead (is, position) || !SnapshotRead (is, velocity)
+          || !SnapshotRead (is, trajectoryBegin))
+        {
+          return false;
+        }
+      Vehicle *v = CreateVehicle (m_systemId);
+      Ptr<ConstantVelocityMobilityModel> mobility = CreateObject<ConstantVelocityMobilityModel> ();
+      v->node->AggregateObject (mobility);
+      mobility->SetPosition (position);
+      mobility->SetVelocity (velocity);
+      v->mobility = mobility;
+      v->trajectoryBegin = trajectoryBegin + shift;
+      if (!v->table.Load (is, shift) || !v->queue.Load (is))
+        {
+          return false;
+        }
+    }
+  NS_LOG_INFO ("Restored " << n << " vehicles at " << m_timeOrigin.GetSeconds () << " s");
+  return true;
+}
+
+Vehicle *
+KdtmExample::CreateVehicle (uint32_t owner)
+{
+  Vehicle *v = new Vehicle (m_range);
+  v->node = CreateObject<Node> (owner);
+  v->local = (owner == m_systemId);
+  v->address = Mac48Address::Allocate ();
+
+  v->table.SetAlpha (m_alpha);
+  v->table.SetDegreeEpsilon (m_degreeEpsilon);
+  v->trajectoryBegin = Seconds (- m_random->GetValue (0, 2 * v->table.GetPoissonCoeff ()));
+  v->table.SetTrajectoryBegin (v->trajectoryBegin);
+
+  m_vehicleIndex[v->node->GetId ()] = m_vehicles.size ();
+  m_vehicles.push_back (v);
+  return v;
+}
+
+void
+KdtmExample::CreateRemoteLinks ()
+{
+#ifdef NS3_MPI
+  if (!m_distributed)
+    {
+      return;
+    }
+
+  // Device 0 of each vehicle receives the warnings of the other ranks
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+      m_vehicles[i]->node->AddDevice (device);
+      Ptr<MpiReceiver> receiver = CreateObject<MpiReceiver> ();
+      receiver->SetReceiveCallback (MakeCallback (&KdtmExample::ReceiveRemoteWarning, this));
+      device->AggregateObject (receiver);
+    }
+
+  // The links between the anchors of consecutive ranks carry no traffic,
+  // their delay is the lookahead of the distributed simulator.
+  NodeContainer anchors;
+  for (uint32_t rank = 0; rank < m_systemCount; rank++)
+    {
+      anchors.Add (CreateObject<Node> (rank));
+    }
+  PointToPointHelper link;
+  link.SetChannelAttribute ("Delay", TimeValue (Seconds (m_frameTime)));
+  for (uint32_t rank = 0; rank + 1 < m_systemCount; rank++)
+    {
+      link.Install (anchors.Get (rank), anchors.Get (rank + 1));
+    }
+#endif
+}
+
+void
+KdtmExample::UpdatePartitionExtent ()
+{
+  m_partition.ResetExtent ();
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      if (m_vehicles[i]->local && IsActive (i))
+        {
+          m_partition.ExtendExtent (m_vehicles[i]->mobility->GetPosition ());
+        }
+    }
+}
+
+uint64_t
+KdtmExample::EncodePosition (double coordinate)
+{
+  return coordinate > 0 ? (uint64_t) coordinate : 0;
 }
 
+double
+KdtmExample::GetAirtime (uint32_t size)
+{
+  // 802.11p, 10 MHz, 6 Mbit/s: 40 us of preamble and SIGNAL, then 8 us
+  // OFDM symbols of 48 bits carrying SERVICE, the MAC header (24), LLC/SNAP
+  // (8), the kDTM headers, the FCS (4) and the tail
+  uint32_t bits = 16 + 8 * (24 + 8 + size + 4) + 6;
+  uint32_t symbols = (bits + 47) / 48;
+  return 40e-6 + 8e-6 * symbols;
+}
+
+Ptr<Packet>
+KdtmExample::CreateWarning (uint32_t sourceId, uint32_t prevHopId, uint32_t hopCount,
+                            uint32_t messageId, Vector position) const
+{
+  Ptr<Packet> packet = Create<Packet> ();
+  if (m_compactWarnings)
+    {
+      packet->AddHeader (CompactWarningHeader (sourceId, prevHopId, hopCount, messageId, position.x, position.y));
+      packet->AddHeader (TypeHeader (KDTM_WARNING_COMPACT));
+    }
+  else
+    {
+      packet->AddHeader (WarningHeader (sourceId, prevHopId, hopCount, messageId,
+                                        EncodePosition (position.x), EncodePosition (position.y)));
+      packet->AddHeader (TypeHeader (KDTM_WARNING));
+    }
+  return packet;
+}
+
+bool
+KdtmExample::IsActive (uint32_t i) const
+{
+  return !m_vehicles[i]->failed && (m_trace.empty () || m_streamer.IsActive (i));
+}
+
+bool
+KdtmExample::InRange (uint32_t i, uint32_t j) const
+{
+  return CalculateDistance (m_vehicles[i]->mobility->GetPosition (),
+                            m_vehicles[j]->mobility->GetPosition ()) <= m_range;
+}
+
+void
+KdtmExample::UpdateKinematics (uint32_t i)
+{
+  Vehicle *v = m_vehicles[i];
+  v->table.UpdateMyKinematics (Simulator::Now (), v->mobility->GetPosition (), v->mobility->GetVelocity ());
+}
+
+void
+KdtmExample::ScheduleHello (uint32_t i, Time deadline)
+{
+  if (m_helloSlot > 0)
+    {
+      m_helloScheduler.Schedule (i, deadline);
+      return;
+    }
+  m_helloEvents++;
+  Simulator::Schedule (deadline - Simulator::Now (), &KdtmExample::SendHello, this, i);
+}
+
+void
+KdtmExample::SendHello (uint32_t i)
+{
+  Vehicle *sender = m_vehicles[i];
+  // The next deadlines follow this one, not the end of its slot
+  Time deadline = m_helloSlot > 0 ? m_helloScheduler.GetDeadline () : Simulator::Now ();
+  Vector position = sender->mobility->GetPosition ();
+  Vector velocity = sender->mobility->GetVelocity ();
+  double beta = 1.0 / sender->table.GetPoissonCoeff ();
+
+  // A warning of the vehicle told its neighbors as much as this hello would
+  Time sinceAdvertised = Simulator::Now () - sender->stateAdvertised;
+  if (m_piggyback && sender->advertised && sinceAdvertised < Seconds (m_helloInterval))
+    {
+      m_deferredHellos++;
+      ScheduleHello (i, sender->stateAdvertised + Seconds (m_helloInterval));
+      return;
+    }
+  ScheduleHello (i, deadline + Seconds (m_helloInterval));
+
+  // Hellos of remote vehicles far from the local ones are heard by nobody
+  if (!IsActive (i) || (!sender->local && !m_partition.IsInHalo (position)))
+    {
+      return;
+    }
+  if (sender->local)
+    {
+      // Summed over the hellos counted in m_hellos, which Report divides by
+      m_hellos++;
+      m_helloLateness += (Simulator::Now () - deadline).GetSeconds ();
+    }
+
+  // Only the owner rank has the table of the sender
+  NeighborSummary summary;
+  if (m_twoHopSummary && sender->local)
+    {
+      Ptr<Packet> packet = Create<Packet> ();
+      packet->AddHeader (NeighborSummaryHeader (sender->table.CreateNeighborSummary (m_summaryBits)));
+      packet->AddHeader (TypeHeader (KDTM_NEIGHBOR_SUMMARY));
+      m_summaryBytes += packet->GetSize ();
+      TypeHeader tHeader (KDTM_HELLO);
+      NeighborSummaryHeader summaryHeader;
+      packet->RemoveHeader (tHeader);
+      packet->RemoveHeader (summaryHeader);
+      summary = summaryHeader.GetSummary ();
+    }
+
+  for (uint32_t j = 0; j < m_vehicles.size (); j++)
+    {
+      if (j == i || !m_vehicles[j]->local || !IsActive (j) || !InRange (i, j))
+        {
+          continue;
+        }
+      UpdateKinematics (j);
+      m_vehicles[j]->table.AddEntry (sender->node->GetId (), position, velocity,
+                                     Simulator::Now (), beta, sender->trajectoryBegin);
+      m_vehicles[j]->table.SetNeighborAddress (sender->node->GetId (), sender->address);
+      if (!summary.IsEmpty ())
+        {
+          m_vehicles[j]->table.SetNeighborSummary (sender->node->GetId (), summary);
+        }
+      m_deliveryRecorder.RecordHello (Simulator::Now (), j, m_vehicles[j]->table.GetMyPosition (),
+                                      m_vehicles[j]->table.GetMyVelocity (), sender->node->GetId (),
+                                      position, velocity, beta, sender->trajectoryBegin);
+    }
+  if (m_txFeedback && sender->local)
+    {
+      ReportHelloFailures (i);
+    }
+}
+
+void
+KdtmExample::ReportHelloFailures (uint32_t i)
+{
+  Vehicle *sender = m_vehicles[i];
+  std::vector<uint32_t> missed;
+  std::map<uint32_t, PositionTableEntry> const & entries = sender->table.GetEntries ();
+  for (std::map<uint32_t, PositionTableEntry>::const_iterator e = entries.begin (); e != entries.end (); ++e)
+    {
+      std::map<uint32_t, uint32_t>::const_iterator j = m_vehicleIndex.find (e->first);
+      if (j != m_vehicleIndex.end () && (!IsActive (j->second) || !InRange (i, j->second)))
+        {
+          missed.push_back (j->second);
+        }
+    }
+
+  // The callback may evict the entries, they are reported after the walk
+  Callback<void, WifiMacHeader const &> txError = sender->table.GetTxErrorCallback ();
+  for (uint32_t k = 0; k < missed.size (); k++)
+    {
+      Vehicle *neighbor = m_vehicles[missed[k]];
+      WifiMacHeader header;
+      header.SetAddr1 (neighbor->address);
+      m_deliveryRecorder.RecordTxFailure (Simulator::Now (), i, neighbor->node->GetId ());
+      txError (header);
+    }
+}
+
+void
+KdtmExample::Sample ()
+{
+  UpdatePartitionExtent ();
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      if (!m_vehicles[i]->local || !IsActive (i))
+        {
+          continue;
+        }
+      UpdateKinematics (i);
+      m_deliveryRecorder.RecordSample (Simulator::Now (), i, m_vehicles[i]->table.GetMyPosition (),
+                                       m_vehicles[i]->table.GetMyVelocity ());
+      m_degreeSum += m_model->CalculateDegree (m_vehicles[i]->table, Simulator::Now ());
+      m_thresholdSum += m_model->CalculateThreshold (m_vehicles[i]->table, Simulator::Now ());
+      m_tableSizeSum += m_vehicles[i]->table.GetEntries ().size ();
+      m_samples++;
+      if (m_dump.IsOpen ())
+        {
+          // The table is printed in the ring, the thread writes it out
+          std::ostream & os = m_dump.GetStream ();
+          os << Simulator::Now ().GetSeconds () << " " << i << m_vehicles[i]->table << "\n";
+          os.flush ();
+        }
+    }
+  Simulator::Schedule (Seconds (m_helloInterval), &KdtmExample::Sample, this);
+}
+
+void
+KdtmExample::FailVehicles ()
+{
+  // Every rank draws the same vehicles, from a stream of its own so that
+  // the other draws of the run do not change
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  uint32_t failed = 0;
+  for (uint32_t i = 0; i < m_vehicles.size (); i++)
+    {
+      if (random->GetValue (0, 1) < m_failedVehicles)
+        {
+          m_vehicles[i]->failed = true;
+          m_vehicles[i]->flush.Cancel ();
+          failed++;
+        }
+    }
+  NS_LOG_INFO ("Radio of " << failed << " of " << m_vehicles.size () << " vehicles failed");
+}
+
+void
+KdtmExample::StartWarning ()
+{
+  if (m_vehicles.empty ())
+    {
+      return;
+    }
+
+  m_warningStart = Simulator::Now ();
+  m_lastReception = m_warningStart;
 
+  // The hazards split the road in equal parts, a single one is in the
+  // middle, away from the sparse edges left by the vehicles that drove out
+  // of it: the source of hazard k is the vehicle closest to its place.
+  for (uint32_t k = 0; k < m_warnings; k++)
+    {
+      uint32_t source = 0;
+      double place = m_roadBegin + (m_roadEnd - m_roadBegin) * (k + 1) / (m_warnings + 1);
+      for (uint32_t i = 1; i < m_vehicles.size (); i++)
+        {
+          if (IsActive (i)
+              && (!IsActive (source)
+                  || std::fabs (m_vehicles[i]->mobility->GetPosition ().x - place)
+                     < std::fabs (m_vehicles[source]->mobility->GetPosition ().x - place)))
+            {
+              source = i;
+            }
+        }
+
+      Vehicle *v = m_vehicles[source];
+      Vector position = v->mobility->GetPosition ();
+      uint32_t messageId = k + 1;
+
+      // Target area of the warning, each rank counts its vehicles
+      uint32_t targets = 0;
+      for (uint32_t j = 0; j < m_vehicles.size (); j++)
+        {
+          if (j != source && m_vehicles[j]->local && IsActive (j)
+              && CalculateDistance (m_vehicles[j]->mobility->GetPosition (), position) <= m_targetRadius)
+            {
+              m_vehicles[j]->targeted.insert (messageId);
+              targets++;
+            }
+        }
+      m_kpi.StartMessage (messageId, m_warningStart, targets);
+
+      if (!v->local)
+        {
+          continue;
+        }
+      uint32_t id = v->node->GetId ();
+
+      v->received.insert (messageId);
+      v->forwarded.insert (messageId);
+      m_reached++;
+
+      m_kpi.AddTransmission (messageId);
+      Broadcast (source, CreateWarning (id, id, 0, messageId, position));
+    }
+}
+
+void
+KdtmExample::Broadcast (uint32_t i, Ptr<Packet> packet)
+{
+  if (m_piggyback)
+    {
+      Vehicle *v = m_vehicles[i];
+      Vector velocity = v->mobility->GetVelocity ();
+      packet->AddHeader (NeighborStateHeader (velocity.x, velocity.y, v->trajectoryBegin,
+                                              1.0 / v->table.GetPoissonCoeff (),
+                                              v->mobility->GetPosition ()));
+      packet->AddHeader (TypeHeader (KDTM_NEIGHBOR_STATE));
+      v->advertised = true;
+      v->stateAdvertised = Simulator::Now ();
+    }
+  m_transmissions++;
+  m_warningBytes += packet->GetSize ();
+  m_warningAirtime += GetAirtime (packet->GetSize ());
+  for (uint32_t j = 0; j < m_vehicles.size (); j++)
+    {
+      if (j == i || !IsActive (j) || !InRange (i, j))
+        {
+          continue;
+        }
+      if (m_vehicles[j]->local)
+        {
+          Simulator::Schedule (Seconds (m_frameTime), &KdtmExample::ReceiveWarning,
+                               this, j, packet->Copy ());
+        }
+#ifdef NS3_MPI
+      else
+        {
+          MpiInterface::SendPacket (packet->Copy (), Simulator::Now () + Seconds (m_frameTime),
+                                    m_vehicles[j]->node->GetId (), 0);
+        }
+#endif
+    }
+}
+
+void
+KdtmExample::Rebroadcast (uint32_t i, Ptr<Packet> packet)
+{
+  if (m_batchWindow <= 0)
+    {
+      Broadcast (i, packet);
+      return;
+    }
+  Vehicle *v = m_vehicles[i];
+  if (v->pending.size () == WarningBatchHeader::MAX_WARNINGS)
+    {
+      v->flush.Cancel ();
+      FlushBatch (i);
+    }
+  if (v->pending.empty ())
+    {
+      v->flush = Simulator::Schedule (Seconds (m_batchWindow), &KdtmExample::FlushBatch, this, i);
+    }
+  v->pending.push_back (packet);
+  v->pendingSince.push_back (Simulator::Now ());
+}
+
+void
+KdtmExample::FlushBatch (uint32_t i)
+{
+  Vehicle *v = m_vehicles[i];
+  for (uint32_t k = 0; k < v->pendingSince.size (); k++)
+    {
+      m_batchDelaySum += (Simulator::Now () - v->pendingSince[k]).GetSeconds ();
+      m_batchDelays++;
+    }
+  Ptr<Packet> batch;
+  if (v->pending.size () > 1)
+    {
+      batch = AggregateWarnings (v->pending);
+    }
+  if (batch)
+    {
+      m_batchFrames++;
+      m_batchedWarnings += v->pending.size ();
+      Broadcast (i, batch);
+    }
+  else
+    {
+      // A single warning, or too many or too large ones for a batch header
+      for (uint32_t k = 0; k < v->pending.size (); k++)
+        {
+          Broadcast (i, v->pending[k]);
+        }
+    }
+  v->pending.clear ();
+  v->pendingSince.clear ();
+}
+
+void
+KdtmExample::ReceiveRemoteWarning (Ptr<Packet> packet)
+{
+  std::map<uint32_t, uint32_t>::const_iterator i = m_vehicleIndex.find (Simulator::GetContext ());
+  if (i != m_vehicleIndex.end ())
+    {
+      ReceiveWarning (i->second, packet);
+    }
+}
+
+void
+KdtmExample::ReceiveWarning (uint32_t i, Ptr<Packet> packet)
+{
+  if (m_vehicles[i]->failed)
+    {
+      return;
+    }
+  TypeHeader tHeader (KDTM_HELLO);
+  packet->PeekHeader (tHeader);
+  NeighborStateHeader state;
+  bool hasState = tHeader.IsValid () && tHeader.Get () == KDTM_NEIGHBOR_STATE;
+  if (hasState)
+    {
+      packet->RemoveHeader (tHeader);
+      packet->RemoveHeader (state);
+      packet->PeekHeader (tHeader);
+    }
+
+  if (tHeader.IsValid () && tHeader.Get () == KDTM_WARNING_BATCH)
+    {
+      // Each warning of the batch is received as if it came alone, the
+      // kinematics of the sender go with the first one
+      std::vector<Ptr<Packet> > warnings;
+      SplitWarnings (packet, warnings);
+      for (uint32_t k = 0; k < warnings.size (); k++)
+        {
+          ReceiveSingleWarning (i, warnings[k], hasState && k == 0 ? &state : 0);
+        }
+      return;
+    }
+  ReceiveSingleWarning (i, packet, hasState ? &state : 0);
+}
+
+void
+KdtmExample::ReceiveSingleWarning (uint32_t i, Ptr<Packet> packet, NeighborStateHeader const *state)
+{
+  Vehicle *v = m_vehicles[i];
+
+  // Kept with its headers to be forwarded with ForwardWarning
+  Ptr<Packet> received = packet->Copy ();
+  TypeHeader tHeader (KDTM_HELLO);
+  packet->RemoveHeader (tHeader);
+  if (!tHeader.IsValid () || (tHeader.Get () != KDTM_WARNING && tHeader.Get () != KDTM_WARNING_COMPACT))
+    {
+      return;
+    }
+  WarningHeader warning;
+  Vector senderPosition;
+  if (tHeader.Get () == KDTM_WARNING_COMPACT)
+    {
+      CompactWarningHeader compact;
+      packet->RemoveHeader (compact);
+      if (!compact.IsValid ())
+        {
+          return;
+        }
+      warning = WarningHeader (compact.GetSourceId (), compact.GetPrevHopId (), compact.GetHopCount (),
+                               compact.GetMessageId (), EncodePosition (compact.GetPositionx ()),
+                               EncodePosition (compact.GetPositiony ()));
+      senderPosition = Vector (compact.GetPositionx (), compact.GetPositiony (), 0);
+    }
+  else
+    {
+      packet->RemoveHeader (warning);
+      senderPosition = Vector (warning.GetPositionx (), warning.GetPositiony (), 0);
+    }
+
+  if (state)
+    {
+      // The previous hop is the sender, the warning completes its hello;
+      // the position of a full warning is in whole meters, the state has it
+      // to the decimeter
+      senderPosition = state->GetPosition ();
+      UpdateKinematics (i);
+      v->table.AddEntry (warning.GetPrevHopId (), senderPosition,
+                         Vector (state->GetSpeedx (), state->GetSpeedy (), 0),
+                         Simulator::Now (), state->GetBeta (), state->GetTrajectoryBegin ());
+      m_deliveryRecorder.RecordHello (Simulator::Now (), i, v->table.GetMyPosition (), v->table.GetMyVelocity (),
+                                      warning.GetPrevHopId (), senderPosition,
+                                      Vector (state->GetSpeedx (), state->GetSpeedy (), 0),
+                                      state->GetBeta (), state->GetTrajectoryBegin ());
+    }
+
+  Record (i, warning.GetMessageId (), warning.GetHopCount () + 1, warning.GetPrevHopId (),
+          KDTM_RECEPTION, 0);
+  if (v->received.insert (warning.GetMessageId ()).second)
+    {
+      m_reached++;
+      m_hopSum += warning.GetHopCount () + 1;
+      m_lastReception = Simulator::Now ();
+      m_kpi.AddDelivery (warning.GetMessageId (), Simulator::Now (), warning.GetHopCount () + 1,
+                         v->targeted.count (warning.GetMessageId ()) > 0);
+    }
+  if (v->forwarded.count (warning.GetMessageId ()))
+    {
+      return;
+    }
+
+  bool first = !v->queue.Exist (warning.GetMessageId ());
+  Time backOff = Seconds (m_random->GetValue (0, m_maxBackoff));
+  QueueEntry entry (Vector (warning.GetPositionx (), warning.GetPositiony (), 0),
+                    backOff,
+                    received,
+                    warning.GetSourceId (),
+                    warning.GetMessageId (),
+                    warning.GetPrevHopId (),
+                    warning.GetHopCount ());
+  v->queue.Add (entry);
+  m_deliveryRecorder.RecordWarning (Simulator::Now (), i, entry, backOff);
+  if (first)
+    {
+      Simulator::Schedule (backOff, &KdtmExample::BackOffExpired, this, i, warning.GetMessageId ());
+    }
+}
+
+void
+KdtmExample::BackOffExpired (uint32_t i, uint32_t messageId)
+{
+  Vehicle *v = m_vehicles[i];
+  if (v->failed)
+    {
+      return;
+    }
+  UpdateKinematics (i);
+
+  Vector position = v->table.GetMyPosition ();
+  QueueDecision decision = DecideRebroadcast (v->table, v->queue, *m_model, messageId, Simulator::Now (),
+                                              m_range);
+  v->queue.SetDecision (messageId, decision);
+  double threshold = decision.threshold;
+  m_deliveryRecorder.RecordExpiry (Simulator::Now (), i, position, v->table.GetMyVelocity (), messageId, decision);
+
+  v->forwarded.insert (messageId);
+  QueueEntry & entry = v->queue.GetEntry (messageId);
+  entry.SetForwarded (true);
+
+  NS_LOG_INFO ("Node " << v->node->GetId () << " dtm " << decision.distanceToMean
+               << " threshold " << threshold);
+
+  if (!decision.rebroadcast)
+    {
+      Record (i, messageId, entry.GetHopCount (), entry.GetPrevHopId (), KDTM_SUPPRESSED, threshold);
+      return;
+    }
+  // The vehicles heard already reached all the neighbors
+  if (m_twoHopSummary && !v->table.AddsCoverage (v->queue.GetPrevHops (messageId)))
+    {
+      m_pruned++;
+      Record (i, messageId, entry.GetHopCount (), entry.GetPrevHopId (), KDTM_SUPPRESSED, threshold);
+      return;
+    }
+  Record (i, messageId, entry.GetHopCount (), entry.GetPrevHopId (), KDTM_REBROADCAST, threshold);
+
+  uint32_t id = v->node->GetId ();
+  Ptr<Packet> packet;
+  if (m_compactWarnings)
+    {
+      packet = ForwardCompactWarning (entry.GetPacket (), id, entry.GetHopCount () + 1, position.x, position.y);
+    }
+  else
+    {
+      packet = ForwardWarning (entry.GetPacket (), id, entry.GetHopCount () + 1,
+                               EncodePosition (position.x), EncodePosition (position.y));
+    }
+  if (!packet)
+    {
+      // Entry restored from a snapshot without the received headers
+      packet = CreateWarning (entry.GetSourceId (), id, entry.GetHopCount () + 1, messageId, position);
+    }
+  m_kpi.AddTransmission (messageId);
+  Rebroadcast (i, packet);
+}
+
+void
+KdtmExample::Record (uint32_t i, uint32_t messageId, uint32_t hopCount, uint32_t prevHop,
+                     DisseminationDecision decision, double threshold)
+{
+  if (!m_recorder.IsOpen ())
+    {
+      return;
+    }
+  Vector position = m_vehicles[i]->mobility->GetPosition ();
+  DisseminationRecord record;
+  record.time = (Simulator::Now () + m_timeOrigin).GetSeconds ();
+  record.node = m_vehicles[i]->node->GetId ();
+  record.messageId = messageId;
+  record.hopCount = hopCount;
+  record.prevHop = prevHop;
+  record.x = position.x;
+  record.y = position.y;
+  record.decision = decision;
+  record.threshold = threshold;
+  m_recorder.Record (record);
+}
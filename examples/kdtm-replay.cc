@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Replays a delivery file written by kdtm-example --deliveries=<file> on the
+ * protocol core alone: the PositionTable and Queue of every node get the
+ * hellos, warnings, samples and backoff expiries of the simulation, without
+ * channel, mobility models or packets, as fast as they can take them.
+ *
+ * Each rebroadcast decision is checked against the recorded one, so the
+ * replay doubles as a regression test of the core.  The events are read in
+ * memory first and replayed "repeat" times:
+ *
+ *   kdtm-example --deliveries=deliveries.bin
+ *   kdtm-replay --input=deliveries.bin --repeat=10
+ *
+ * prints
+ *
+ *   kdtm-replay events=<n> decisions=<n> rebroadcasts=<n> mismatches=<n> seconds=<s> eventsPerSecond=<r>
+ *
+ * where seconds is the mean time of a replay.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/kdtm-replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+using namespace ns3::kdtm;
+
+/// Events scheduled at once
+static const uint32_t g_blockSize = 65536;
+
+static void
+Apply (DeliveryReplay *replay, DeliveryEvent const *event)
+{
+  replay->Apply (*event);
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string input;
+  uint32_t repeat = 1;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "Delivery file written by kdtm-example --deliveries", input);
+  cmd.AddValue ("repeat", "Number of replays", repeat);
+  cmd.Parse (argc, argv);
+
+  DeliveryReader reader;
+  if (input.empty () || !reader.Open (input))
+    {
+      NS_FATAL_ERROR ("Can not read --input=" << input);
+    }
+  std::vector<DeliveryEvent> events;
+  std::vector<DeliveryEvent> block;
+  while (reader.Read (block))
+    {
+      events.insert (events.end (), block.begin (), block.end ());
+    }
+
+  DeliveryReplay replay;
+  double seconds = 0;
+  for (uint32_t r = 0; r < repeat; r++)
+    {
+      if (!replay.Configure (reader.GetConfig ()))
+        {
+          NS_FATAL_ERROR ("Unknown kinetic model in " << input);
+        }
+
+      // The tables purge their entries at the simulator time: each event
+      // runs at its own time, a block of events at a time
+      std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+      for (size_t first = 0; first < events.size (); first += g_blockSize)
+        {
+          size_t last = std::min (events.size (), first + g_blockSize);
+          for (size_t k = first; k < last; k++)
+            {
+              Simulator::Schedule (NanoSeconds (events[k].time) - Simulator::Now (), &Apply, &replay, &events[k]);
+            }
+          Simulator::Run ();
+        }
+      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+      Simulator::Destroy ();
+      seconds += std::chrono::duration<double> (end - begin).count ();
+    }
+  seconds /= repeat > 0 ? repeat : 1;
+
+  std::cout << "kdtm-replay"
+            << " events=" << replay.GetNEvents ()
+            << " decisions=" << replay.GetNDecisions ()
+            << " rebroadcasts=" << replay.GetNRebroadcasts ()
+            << " mismatches=" << replay.GetNMismatches ()
+            << " seconds=" << seconds
+            << " eventsPerSecond=" << (seconds > 0 ? replay.GetNEvents () / seconds : 0)
+            << std::endl;
+  return replay.GetNMismatches () == 0 ? 0 : 1;
+}
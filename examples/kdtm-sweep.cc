@@ -0,0 +1,472 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Parameter sweep driver for the kDTM highway scenario.
+ *
+ * Every (run, density, alpha, range) combination is an independent job.
+ * Jobs are taken from a queue and executed as separate kdtm-example worker
+ * processes, at most "jobs" of them at the same time.  The standard output
+ * of each worker goes to <outDir>/<job>.out and, once the worker exited
+ * successfully, its kdtm-stats line is appended to <outDir>/checkpoint.txt.
+ * Restarting the sweep with the same outDir skips the jobs already present
+ * in the checkpoint, so an interrupted sweep resumes where it stopped.
+ *
+ * When all jobs are done the checkpoint is merged into
+ * <outDir>/aggregate.csv: one line per (density, alpha, range, metric) with
+ * the mean over the runs, the standard deviation and the half width of the
+ * 95% confidence interval (Student t distribution).
+ *
+ * Example:
+ *
+ *   kdtm-sweep --runs=1:30 --densities=10,20,40 --ranges=250,500 --jobs=64
+ */
+
+#include "ns3/core-module.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("KdtmSweep");
+
+/// One scenario execution
+struct SweepJob
+{
+  uint32_t run;
+  std::string density;
+  std::string alpha;
+  std::string range;
+
+  /// Unique name of the job, used as checkpoint key and output file name
+  std::string GetKey () const
+  {
+    return GetConfigKey () + "_run" + std::to_string (run);
+  }
+  /// Name shared by all runs of the same parameter combination
+  std::string GetConfigKey () const
+  {
+    return "density" + density + "_alpha" + alpha + "_range" + range;
+  }
+};
+
+/// kdtm-stats values of one job
+typedef std::map<std::string, double> SweepStats;
+
+class KdtmSweep
+{
+public:
+  KdtmSweep ();
+
+  bool Configure (int argc, char **argv);
+  /// Execute the pending jobs, return false if some of them failed
+  bool Run ();
+  /// Merge the checkpoint into the aggregated result file
+  void Aggregate ();
+
+private:
+  std::string m_program;
+  std::string m_runs;
+  std::string m_densities;
+  std::string m_alphas;
+  std::string m_ranges;
+  std::string m_extraArgs;
+  std::string m_outDir;
+  uint32_t m_jobs;
+
+  std::deque<SweepJob> m_pending;
+  std::map<std::string, SweepStats> m_done;
+
+  std::string GetCheckpointPath () const
+  {
+    return m_outDir + "/checkpoint.txt";
+  }
+
+  void LoadCheckpoint ();
+  void BuildJobs ();
+  pid_t Launch (SweepJob const & job);
+  bool Collect (SweepJob const & job, int status);
+
+  static std::vector<std::string> Split (std::string const & list, char separator);
+  static bool ParseStats (std::string const & line, SweepStats & stats);
+  static double StudentQuantile (uint32_t degreesOfFreedom);
+};
+
+int
+main (int argc, char *argv[])
+{
+  KdtmSweep sweep;
+  if (!sweep.Configure (argc, argv))
+    {
+      NS_FATAL_ERROR ("Configuration failed. Aborted.");
+    }
+
+  bool ok = sweep.Run ();
+  sweep.Aggregate ();
+  return ok ? 0 : 1;
+}
+
+//-----------------------------------------------------------------------------
+KdtmSweep::KdtmSweep ()
+  : m_runs ("1:10"),
+    m_densities ("20"),
+    m_alphas ("10"),
+    m_ranges ("250"),
+    m_outDir ("kdtm-sweep"),
+    m_jobs (0)
+{
+}
+
+bool
+KdtmSweep::Configure (int argc, char **argv)
+{
+  CommandLine cmd;
+  cmd.AddValue ("program", "Path of the kdtm-example binary", m_program);
+  cmd.AddValue ("runs", "Run numbers: first:last or a comma separated list", m_runs);
+  cmd.AddValue ("densities", "Comma separated vehicle densities", m_densities);
+  cmd.AddValue ("alphas", "Comma separated alpha values", m_alphas);
+  cmd.AddValue ("ranges", "Comma separated transmission ranges", m_ranges);
+  cmd.AddValue ("args", "Extra arguments given to every run", m_extraArgs);
+  cmd.AddValue ("outDir", "Directory of the outputs and of the checkpoint", m_outDir);
+  cmd.AddValue ("jobs", "Number of parallel workers (0: one per core)", m_jobs);
+  cmd.Parse (argc, argv);
+
+  if (m_program.empty ())
+    {
+      // ns-3 names the binaries after the example: the worker lives next to
+      // the sweep driver with "kdtm-sweep" replaced by "kdtm-example".
+      m_program = argv[0];
+      std::string::size_type pos = m_program.rfind ("kdtm-sweep");
+      if (pos == std::string::npos)
+        {
+          return false;
+        }
+      m_program.replace (pos, std::strlen ("kdtm-sweep"), "kdtm-example");
+    }
+  if (m_jobs == 0)
+    {
+      long cores = sysconf (_SC_NPROCESSORS_ONLN);
+      m_jobs = cores > 0 ? cores : 1;
+    }
+  if (mkdir (m_outDir.c_str (), 0755) != 0 && errno != EEXIST)
+    {
+      std::cerr << "Can not create " << m_outDir << ": " << std::strerror (errno) << std::endl;
+      return false;
+    }
+
+  LoadCheckpoint ();
+  BuildJobs ();
+  return true;
+}
+
+bool
+KdtmSweep::Run ()
+{
+  std::map<pid_t, SweepJob> running;
+  bool ok = true;
+
+  std::cout << m_pending.size () << " jobs to run, " << m_done.size ()
+            << " already in checkpoint, " << m_jobs << " workers" << std::endl;
+
+  while (!m_pending.empty () || !running.empty ())
+    {
+      while (!m_pending.empty () && running.size () < m_jobs)
+        {
+          SweepJob job = m_pending.front ();
+          m_pending.pop_front ();
+          pid_t pid = Launch (job);
+          if (pid < 0)
+            {
+              ok = false;
+              continue;
+            }
+          running[pid] = job;
+        }
+
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          break;
+        }
+      std::map<pid_t, SweepJob>::iterator i = running.find (pid);
+      if (i == running.end ())
+        {
+          continue;
+        }
+      ok = Collect (i->second, status) && ok;
+      running.erase (i);
+    }
+  return ok;
+}
+
+void
+KdtmSweep::Aggregate ()
+{
+  // configuration -> metric -> values over the runs
+  std::map<std::string, std::map<std::string, std::vector<double> > > samples;
+  for (std::map<std::string, SweepStats>::const_iterator i = m_done.begin (); i != m_done.end (); ++i)
+    {
+      std::string::size_type pos = i->first.rfind ("_run");
+      std::string config = i->first.substr (0, pos);
+      for (SweepStats::const_iterator j = i->second.begin (); j != i->second.end (); ++j)
+        {
+          samples[config][j->first].push_back (j->second);
+        }
+    }
+
+  std::string path = m_outDir + "/aggregate.csv";
+  std::ofstream os (path.c_str ());
+  os << "config,metric,runs,mean,stddev,ci95" << std::endl;
+  for (std::map<std::string, std::map<std::string, std::vector<double> > >::const_iterator c = samples.begin ();
+       c != samples.end (); ++c)
+    {
+      for (std::map<std::string, std::vector<double> >::const_iterator m = c->second.begin ();
+           m != c->second.end (); ++m)
+        {
+          std::vector<double> const & v = m->second;
+          uint32_t n = v.size ();
+          double mean = 0;
+          for (uint32_t k = 0; k < n; k++)
+            {
+              mean += v[k];
+            }
+          mean /= n;
+          double var = 0;
+          for (uint32_t k = 0; k < n; k++)
+            {
+              var += (v[k] - mean) * (v[k] - mean);
+            }
+          double stddev = n > 1 ? std::sqrt (var / (n - 1)) : 0;
+          double ci = n > 1 ? StudentQuantile (n - 1) * stddev / std::sqrt ((double) n) : 0;
+          os << c->first << "," << m->first << "," << n << ","
+             << mean << "," << stddev << "," << ci << std::endl;
+        }
+    }
+  std::cout << "Aggregated " << m_done.size () << " runs into " << path << std::endl;
+}
+
+void
+KdtmSweep::LoadCheckpoint ()
+{
+  std::ifstream is (GetCheckpointPath ().c_str ());
+  std::string line;
+  while (std::getline (is, line))
+    {
+      // <job key> kdtm-stats key=value ...
+      std::string::size_type pos = line.find (' ');
+      SweepStats stats;
+      if (pos == std::string::npos || !ParseStats (line.substr (pos + 1), stats))
+        {
+          continue;
+        }
+      m_done[line.substr (0, pos)] = stats;
+    }
+}
+
+void
+KdtmSweep::BuildJobs ()
+{
+  std::vector<uint32_t> runs;
+  std::string::size_type colon = m_runs.find (':');
+  if (colon != std::string::npos)
+    {
+      uint32_t first = std::stoul (m_runs.substr (0, colon));
+      uint32_t last = std::stoul (m_runs.substr (colon + 1));
+      for (uint32_t r = first; r <= last; r++)
+        {
+          runs.push_back (r);
+        }
+    }
+  else
+    {
+      std::vector<std::string> list = Split (m_runs, ',');
+      for (uint32_t k = 0; k < list.size (); k++)
+        {
+          runs.push_back (std::stoul (list[k]));
+        }
+    }
+
+  std::vector<std::string> densities = Split (m_densities, ',');
+  std::vector<std::string> alphas = Split (m_alphas, ',');
+  std::vector<std::string> ranges = Split (m_ranges, ',');
+
+  for (uint32_t d = 0; d < densities.size (); d++)
+    {
+      for (uint32_t a = 0; a < alphas.size (); a++)
+        {
+          for (uint32_t r = 0; r < ranges.size (); r++)
+            {
+              for (uint32_t k = 0; k < runs.size (); k++)
+                {
+                  SweepJob job;
+                  job.run = runs[k];
+                  job.density = densities[d];
+                  job.alpha = alphas[a];
+                  job.range = ranges[r];
+                  if (m_done.find (job.GetKey ()) == m_done.end ())
+                    {
+                      m_pending.push_back (job);
+                    }
+                }
+            }
+        }
+    }
+}
+
+pid_t
+KdtmSweep::Launch (SweepJob const & job)
+{
+  std::vector<std::string> args;
+  args.push_back (m_program);
+  args.push_back ("--run=" + std::to_string (job.run));
+  args.push_back ("--density=" + job.density);
+  args.push_back ("--alpha=" + job.alpha);
+  args.push_back ("--range=" + job.range);
+  std::vector<std::string> extra = Split (m_extraArgs, ' ');
+  args.insert (args.end (), extra.begin (), extra.end ());
+
+  std::string out = m_outDir + "/" + job.GetKey () + ".out";
+
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      std::cerr << "fork failed for " << job.GetKey () << ": " << std::strerror (errno) << std::endl;
+      return pid;
+    }
+  if (pid == 0)
+    {
+      int fd = open (out.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0)
+        {
+          _exit (127);
+        }
+      dup2 (fd, STDOUT_FILENO);
+      dup2 (fd, STDERR_FILENO);
+      close (fd);
+
+      std::vector<char *> argv;
+      for (uint32_t k = 0; k < args.size (); k++)
+        {
+          argv.push_back (const_cast<char *> (args[k].c_str ()));
+        }
+      argv.push_back (0);
+      execv (argv[0], &argv[0]);
+      _exit (127);
+    }
+  return pid;
+}
+
+bool
+KdtmSweep::Collect (SweepJob const & job, int status)
+{
+  std::string out = m_outDir + "/" + job.GetKey () + ".out";
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      std::cerr << job.GetKey () << " failed, see " << out << std::endl;
+      return false;
+    }
+
+  std::ifstream is (out.c_str ());
+  std::string line;
+  std::string statsLine;
+  SweepStats stats;
+  while (std::getline (is, line))
+    {
+      if (ParseStats (line, stats))
+        {
+          statsLine = line;
+        }
+    }
+  if (statsLine.empty ())
+    {
+      std::cerr << job.GetKey () << " has no kdtm-stats line, see " << out << std::endl;
+      return false;
+    }
+
+  // A whole line is appended and flushed at once so that an interrupted
+  // sweep never leaves a partial record behind.
+  std::ofstream checkpoint (GetCheckpointPath ().c_str (), std::ios::app);
+  checkpoint << job.GetKey () << " " << statsLine << std::endl;
+  m_done[job.GetKey ()] = stats;
+
+  std::cout << "[" << m_done.size () << "] " << job.GetKey () << " done" << std::endl;
+  return true;
+}
+
+std::vector<std::string>
+KdtmSweep::Split (std::string const & list, char separator)
+{
+  std::vector<std::string> items;
+  std::istringstream is (list);
+  std::string item;
+  while (std::getline (is, item, separator))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+bool
+KdtmSweep::ParseStats (std::string const & line, SweepStats & stats)
+{
+  std::istringstream is (line);
+  std::string word;
+  if (!(is >> word) || word != "kdtm-stats")
+    {
+      return false;
+    }
+  stats.clear ();
+  while (is >> word)
+    {
+      std::string::size_type eq = word.find ('=');
+      if (eq == std::string::npos)
+        {
+          continue;
+        }
+      stats[word.substr (0, eq)] = std::atof (word.substr (eq + 1).c_str ());
+    }
+  return true;
+}
+
+/// Two-sided 95% quantile of the Student t distribution
+double
+KdtmSweep::StudentQuantile (uint32_t degreesOfFreedom)
+{
+  static const double quantiles[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  if (degreesOfFreedom == 0)
+    {
+      return 0;
+    }
+  if (degreesOfFreedom <= 30)
+    {
+      return quantiles[degreesOfFreedom - 1];
+    }
+  return 1.960;
+}
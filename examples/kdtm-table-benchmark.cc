@@ -0,0 +1,147 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * Cost of the time conversions in the per-neighbor loops of PositionTable.
+ *
+ * A table of "neighbors" entries is filled once, then each loop is run
+ * "iterations" times and its mean time per neighbor is printed:
+ *
+ *  - degree/Time: the kinetic degree loop as it was with ns3::Time entries,
+ *    each term converting its window and trajectory begin with GetSeconds ()
+ *  - degree/ticks: the same loop on the integer nanosecond entries
+ *  - degree/table: PositionTable::CalculateDegree, on its sorted index
+ *  - windows/Time: storing solved link windows with Seconds ()
+ *  - windows/ticks: storing them as integer nanoseconds
+ *
+ * The sums are printed too, so that the loops can not be optimized away and
+ * can be compared.
+ *
+ *   kdtm-table-benchmark --neighbors=200 --iterations=10000
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/kdtm-ptable.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+using namespace ns3::kdtm;
+
+NS_LOG_COMPONENT_DEFINE ("KdtmTableBenchmark");
+
+/// Entry times as they were stored before TableTime
+struct TimeEntry
+{
+  Time from;
+  Time to;
+  Time tj;
+  double Betaj;
+};
+
+/// Runs f iterations times, prints the mean time per neighbor
+template <class F>
+static void
+Measure (char const *name, uint32_t iterations, uint32_t neighbors, F f)
+{
+  double sum = 0;
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  for (uint32_t k = 0; k < iterations; k++)
+    {
+      sum += f ();
+    }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+  double ns = std::chrono::duration<double, std::nano> (end - begin).count ();
+  std::cout << name << " " << ns / iterations / neighbors << " ns/neighbor (sum " << sum << ")" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t neighbors = 200;
+  uint32_t iterations = 10000;
+
+  CommandLine cmd;
+  cmd.AddValue ("neighbors", "Number of entries of the table", neighbors);
+  cmd.AddValue ("iterations", "Runs of each loop", iterations);
+  cmd.Parse (argc, argv);
+
+  // Neighbors on both sides of the node, entering and leaving its range
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  table.SetTrajectoryBegin (Seconds (-30));
+  table.UpdateMyKinematics (Seconds (10), Vector (0, 0, 0), Vector (25, 0, 0));
+  for (uint32_t j = 0; j < neighbors; j++)
+    {
+      double x = -1000.0 + 2000.0 * j / neighbors;
+      table.AddEntry (j, Vector (x, 4.0 * (j % 4), 0), Vector (20.0 + (j % 11), 0, 0), Seconds (10),
+                      1.0 / (100 + j % 50), Seconds (- (double) (j % 20)));
+    }
+
+  std::map<uint32_t, PositionTableEntry> const & entries = table.GetEntries ();
+  std::vector<TimeEntry> timeEntries;
+  std::vector<double> windows;
+  for (std::map<uint32_t, PositionTableEntry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      TimeEntry entry = { FromTableTime (i->second.from), FromTableTime (i->second.to),
+                          FromTableTime (i->second.tj), i->second.Betaj };
+      timeEntries.push_back (entry);
+      windows.push_back (TableTimeToSeconds (i->second.from));
+    }
+
+  Time now = Seconds (12);
+  Time trajectoryBegin = table.GetTrajectoryBegin ();
+  double Betai = 1.0 / table.GetPoissonCoeff ();
+  double alpha = table.GetAlpha ();
+  PoissonStability stability;
+  DoubleSigmoidDegree degree;
+
+  Measure ("degree/Time", iterations, neighbors, [&] () {
+    double t = now.GetSeconds ();
+    double sum = 0;
+    for (uint32_t j = 0; j < timeEntries.size (); j++)
+      {
+        TimeEntry const & e = timeEntries[j];
+        sum += stability (t, trajectoryBegin.GetSeconds (), Betai, e.tj.GetSeconds (), e.Betaj)
+          * degree (e.from.GetSeconds (), e.to.GetSeconds (), t, alpha);
+      }
+    return sum;
+  });
+
+  Measure ("degree/ticks", iterations, neighbors, [&] () {
+    double t = now.GetSeconds ();
+    double ti = trajectoryBegin.GetSeconds ();
+    double sum = 0;
+    std::map<uint32_t, PositionTableEntry>::const_iterator i = entries.begin ();
+    for (; i != entries.end (); i++)
+      {
+        sum += stability (t, ti, Betai, TableTimeToSeconds (i->second.tj), i->second.Betaj)
+          * degree (TableTimeToSeconds (i->second.from), TableTimeToSeconds (i->second.to), t, alpha);
+      }
+    return sum;
+  });
+
+  Measure ("degree/table", iterations, neighbors, [&] () {
+    return table.CalculateDegree (now);
+  });
+
+  std::vector<Time> timeWindows (windows.size ());
+  Measure ("windows/Time", iterations, neighbors, [&] () {
+    for (uint32_t j = 0; j < windows.size (); j++)
+      {
+        timeWindows[j] = Seconds (windows[j]);
+      }
+    return timeWindows.back ().GetSeconds ();
+  });
+
+  std::vector<TableTime> tickWindows (windows.size ());
+  Measure ("windows/ticks", iterations, neighbors, [&] () {
+    for (uint32_t j = 0; j < windows.size (); j++)
+      {
+        tickWindows[j] = SecondsToTableTime (windows[j]);
+      }
+    return TableTimeToSeconds (tickWindows.back ());
+  });
+
+  return 0;
+}
@@ -0,0 +1,275 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+/*
+ * One-time conversion of a mobility trace to the indexed binary format read
+ * by kdtm::MobilityTraceStreamer.
+ *
+ * Supported inputs:
+ *  - SUMO floating car data (sumo --fcd-output): <timestep time="t"> elements
+ *    containing <vehicle id="..." x="..." y="..." .../> elements.  Vehicle
+ *    ids are numbered in order of first appearance, the names are written to
+ *    <output>.ids, one per line.
+ *  - ns-2 movement files: "$node_(i) set X_ x" initial positions and
+ *    "$ns_ at t "$node_(i) setdest x y speed"" movements, vehicle i is node i.
+ *    The setdest of a node must appear in ascending time order.
+ *
+ * The input is read once, as a stream; memory use is proportional to the
+ * number of vehicles, not to the size of the trace.
+ *
+ *   kdtm-trace-convert --input=fcd.xml --output=fcd.kdtm
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/kdtm-trace.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+using namespace ns3::kdtm;
+
+NS_LOG_COMPONENT_DEFINE ("KdtmTraceConvert");
+
+/// Gets attribute name="value" of an XML tag, false if absent
+static bool
+GetAttribute (std::string const & tag, char const *name, std::string & value)
+{
+  std::string key = std::string (" ") + name + "=\"";
+  std::string::size_type begin = tag.find (key);
+  if (begin == std::string::npos)
+    {
+      return false;
+    }
+  begin += key.size ();
+  std::string::size_type end = tag.find ('"', begin);
+  if (end == std::string::npos)
+    {
+      return false;
+    }
+  value = tag.substr (begin, end - begin);
+  return true;
+}
+
+static bool
+ConvertSumo (std::istream & is, MobilityTraceWriter & writer, std::ostream & ids)
+{
+  std::map<std::string, uint32_t> vehicles;
+  double time = 0;
+  std::string tag;
+  std::string value;
+
+  // Every '>' ends a tag, whatever the line layout of the file
+  while (std::getline (is, tag, '>'))
+    {
+      std::string::size_type open = tag.find ('<');
+      if (open == std::string::npos)
+        {
+          continue;
+        }
+      tag.erase (0, open);
+      // Normalize the separators so that attributes are always preceded by a space
+      for (std::string::size_type k = 0; k < tag.size (); k++)
+        {
+          if (tag[k] == '\n' || tag[k] == '\t' || tag[k] == '\r')
+            {
+              tag[k] = ' ';
+            }
+        }
+
+      if (tag.compare (0, 9, "<timestep") == 0)
+        {
+          if (!GetAttribute (tag, "time", value))
+            {
+              return false;
+            }
+          time = std::atof (value.c_str ());
+        }
+      else if (tag.compare (0, 8, "<vehicle") == 0)
+        {
+          std::string id, x, y;
+          if (!GetAttribute (tag, "id", id) || !GetAttribute (tag, "x", x) || !GetAttribute (tag, "y", y))
+            {
+              return false;
+            }
+          std::map<std::string, uint32_t>::iterator i = vehicles.find (id);
+          if (i == vehicles.end ())
+            {
+              i = vehicles.insert (std::make_pair (id, (uint32_t) vehicles.size ())).first;
+              ids << id << std::endl;
+            }
+          writer.Add (i->second, time, std::atof (x.c_str ()), std::atof (y.c_str ()));
+        }
+    }
+  return true;
+}
+
+/// Movement state of an ns-2 node
+struct Ns2Node
+{
+  Ns2Node ()
+    : x (0), y (0), t (0),
+      targetX (0), targetY (0), arrival (0),
+      moving (false), written (-1)
+  {
+  }
+  double x, y, t;                   // start of the current leg
+  double targetX, targetY, arrival; // end of the current leg
+  bool moving;
+  double written;                   // time of the last record written
+};
+
+static void
+WriteNs2 (MobilityTraceWriter & writer, uint32_t id, Ns2Node & node, double t, double x, double y)
+{
+  if (t > node.written)
+    {
+      writer.Add (id, t, x, y);
+      node.written = t;
+    }
+}
+
+static bool
+ConvertNs2 (std::istream & is, MobilityTraceWriter & writer)
+{
+  std::vector<Ns2Node> nodes;
+  std::string line;
+  while (std::getline (is, line))
+    {
+      std::string::size_type begin = line.find_first_not_of (" \t");
+      if (begin == std::string::npos)
+        {
+          continue;
+        }
+      char const *s = line.c_str () + begin;
+      uint32_t id;
+      char axis;
+      double t, x, y, speed;
+
+      if (std::sscanf (s, "$node_(%u) set %c_ %lf", &id, &axis, &x) == 3)
+        {
+          if (id >= nodes.size ())
+            {
+              nodes.resize (id + 1);
+            }
+          if (axis == 'X')
+            {
+              nodes[id].x = nodes[id].targetX = x;
+            }
+          else if (axis == 'Y')
+            {
+              nodes[id].y = nodes[id].targetY = x;
+            }
+        }
+      else if (std::sscanf (s, "$ns_ at %lf \"$node_(%u) setdest %lf %lf %lf", &t, &id, &x, &y, &speed) == 5)
+        {
+          if (id >= nodes.size ())
+            {
+              nodes.resize (id + 1);
+            }
+          Ns2Node & node = nodes[id];
+
+          // Position at t on the current leg
+          double px = node.targetX;
+          double py = node.targetY;
+          if (node.moving && t < node.arrival)
+            {
+              double f = (t - node.t) / (node.arrival - node.t);
+              px = node.x + (node.targetX - node.x) * f;
+              py = node.y + (node.targetY - node.y) * f;
+            }
+
+          WriteNs2 (writer, id, node, 0, node.x, node.y);
+          if (node.moving && node.arrival < t)
+            {
+              WriteNs2 (writer, id, node, node.arrival, node.targetX, node.targetY);
+            }
+          WriteNs2 (writer, id, node, t, px, py);
+
+          double distance = std::sqrt ((x - px) * (x - px) + (y - py) * (y - py));
+          node.x = px;
+          node.y = py;
+          node.t = t;
+          node.targetX = x;
+          node.targetY = y;
+          node.moving = speed > 0 && distance > 0;
+          node.arrival = node.moving ? t + distance / speed : t;
+          if (!node.moving)
+            {
+              node.targetX = px;
+              node.targetY = py;
+            }
+        }
+    }
+
+  for (uint32_t id = 0; id < nodes.size (); id++)
+    {
+      Ns2Node & node = nodes[id];
+      WriteNs2 (writer, id, node, 0, node.x, node.y);
+      if (node.moving)
+        {
+          WriteNs2 (writer, id, node, node.arrival, node.targetX, node.targetY);
+        }
+    }
+  return true;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string input;
+  std::string output;
+  std::string format;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "SUMO FCD or ns-2 mobility file", input);
+  cmd.AddValue ("output", "Binary trace to write", output);
+  cmd.AddValue ("format", "sumo or ns2 (default: sumo for .xml files, ns2 otherwise)", format);
+  cmd.Parse (argc, argv);
+
+  if (input.empty () || output.empty ())
+    {
+      NS_FATAL_ERROR ("--input and --output are required");
+    }
+  if (format.empty ())
+    {
+      format = (input.size () > 4 && input.compare (input.size () - 4, 4, ".xml") == 0) ? "sumo" : "ns2";
+    }
+
+  std::ifstream is (input.c_str ());
+  if (!is)
+    {
+      NS_FATAL_ERROR ("Can not open " << input);
+    }
+  MobilityTraceWriter writer;
+  if (!writer.Open (output))
+    {
+      NS_FATAL_ERROR ("Can not create " << output);
+    }
+
+  bool ok;
+  if (format == "sumo")
+    {
+      std::ofstream ids ((output + ".ids").c_str ());
+      ok = ConvertSumo (is, writer, ids);
+    }
+  else if (format == "ns2")
+    {
+      ok = ConvertNs2 (is, writer);
+    }
+  else
+    {
+      NS_FATAL_ERROR ("Unknown format " << format);
+    }
+
+  if (!ok || !writer.Finish ())
+    {
+      NS_FATAL_ERROR ("Conversion of " << input << " failed");
+    }
+  std::cout << "Converted " << writer.GetNRecords () << " records to " << output << std::endl;
+  return 0;
+}
@@ -0,0 +1,232 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-codec.h"
+#include <cmath>
+#include <cstring>
+
+namespace ns3 {
+namespace kdtm {
+
+void
+PutU32 (uint8_t *b, uint32_t v)
+{
+  for (int k = 3; k >= 0; k--, v >>= 8)
+    {
+      b[k] = v & 0xff;
+    }
+}
+
+void
+PutU64 (uint8_t *b, uint64_t v)
+{
+  for (int k = 7; k >= 0; k--, v >>= 8)
+    {
+      b[k] = v & 0xff;
+    }
+}
+
+uint32_t
+GetU32 (uint8_t const *b)
+{
+  uint32_t v = 0;
+  for (int k = 0; k < 4; k++)
+    {
+      v = (v << 8) | b[k];
+    }
+  return v;
+}
+
+uint64_t
+GetU64 (uint8_t const *b)
+{
+  uint64_t v = 0;
+  for (int k = 0; k < 8; k++)
+    {
+      v = (v << 8) | b[k];
+    }
+  return v;
+}
+
+void
+EncodeHello (uint8_t *b, HelloFields const & fields)
+{
+  PutU32 (b, fields.id);
+  PutU64 (b + 4, fields.originPosx);
+  PutU64 (b + 12, fields.originPosy);
+  PutU64 (b + 20, fields.speedx);
+  PutU64 (b + 28, fields.speedy);
+  PutU64 (b + 36, fields.trajectoryBegin);
+  PutU64 (b + 44, fields.beta);
+}
+
+void
+DecodeHello (uint8_t const *b, HelloFields & fields)
+{
+  fields.id = GetU32 (b);
+  fields.originPosx = GetU64 (b + 4);
+  fields.originPosy = GetU64 (b + 12);
+  fields.speedx = GetU64 (b + 20);
+  fields.speedy = GetU64 (b + 28);
+  fields.trajectoryBegin = GetU64 (b + 36);
+  fields.beta = GetU64 (b + 44);
+}
+
+void
+EncodeWarning (uint8_t *b, WarningFields const & fields)
+{
+  PutU32 (b, fields.sourceId);
+  PutU32 (b + 4, fields.prevHopId);
+  PutU32 (b + 8, fields.hopCount);
+  PutU32 (b + 12, fields.messageId);
+  PutU64 (b + 16, fields.positionx);
+  PutU64 (b + 24, fields.positiony);
+}
+
+void
+DecodeWarning (uint8_t const *b, WarningFields & fields)
+{
+  fields.sourceId = GetU32 (b);
+  fields.prevHopId = GetU32 (b + 4);
+  fields.hopCount = GetU32 (b + 8);
+  fields.messageId = GetU32 (b + 12);
+  fields.positionx = GetU64 (b + 16);
+  fields.positiony = GetU64 (b + 24);
+}
+
+uint32_t
+EncodeVarint (uint8_t *b, uint32_t v)
+{
+  uint32_t n = 0;
+  while (v >= 0x80)
+    {
+      b[n++] = (v & 0x7f) | 0x80;
+      v >>= 7;
+    }
+  b[n++] = v;
+  return n;
+}
+
+bool
+DecodeVarint (uint8_t const *b, uint32_t size, uint32_t *pos, uint32_t *v)
+{
+  *v = 0;
+  for (uint32_t shift = 0; shift < 35 && *pos < size; shift += 7)
+    {
+      uint8_t byte = b[(*pos)++];
+      *v |= (uint32_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+uint32_t
+VarintSize (uint32_t v)
+{
+  uint32_t n = 1;
+  for (; v >= 0x80; v >>= 7)
+    {
+      n++;
+    }
+  return n;
+}
+
+int32_t
+EncodeCompactPosition (double position)
+{
+  double dm = std::floor (position * 10 + 0.5);
+  if (dm > 2147483647.0)
+    {
+      return 2147483647;
+    }
+  if (dm < -2147483648.0)
+    {
+      return -2147483647 - 1;
+    }
+  return (int32_t) dm;
+}
+
+uint32_t
+EncodeCompactWarning (uint8_t *b, CompactWarningFields const & fields)
+{
+  uint32_t n = EncodeVarint (b, fields.sourceId);
+  n += EncodeVarint (b + n, fields.prevHopId);
+  n += EncodeVarint (b + n, fields.messageId);
+  b[n++] = fields.hopCount;
+  PutU32 (b + n, (uint32_t) fields.positionx);
+  PutU32 (b + n + 4, (uint32_t) fields.positiony);
+  return n + 8;
+}
+
+uint32_t
+DecodeCompactWarning (uint8_t const *b, uint32_t size, CompactWarningFields & fields)
+{
+  uint32_t pos = 0;
+  if (!DecodeVarint (b, size, &pos, &fields.sourceId)
+      || !DecodeVarint (b, size, &pos, &fields.prevHopId)
+      || !DecodeVarint (b, size, &pos, &fields.messageId)
+      || pos + 9 > size)
+    {
+      return 0;
+    }
+  fields.hopCount = b[pos];
+  fields.positionx = (int32_t) GetU32 (b + pos + 1);
+  fields.positiony = (int32_t) GetU32 (b + pos + 5);
+  return pos + 9;
+}
+
+void
+EncodeNeighborState (uint8_t *b, NeighborStateFields const & fields)
+{
+  uint64_t beta;
+  std::memcpy (&beta, &fields.beta, sizeof (beta));
+  PutU32 (b, (uint32_t) fields.speedx);
+  PutU32 (b + 4, (uint32_t) fields.speedy);
+  PutU64 (b + 8, (uint64_t) fields.trajectoryBegin);
+  PutU64 (b + 16, beta);
+  PutU32 (b + 24, (uint32_t) fields.positionx);
+  PutU32 (b + 28, (uint32_t) fields.positiony);
+}
+
+void
+DecodeNeighborState (uint8_t const *b, NeighborStateFields & fields)
+{
+  fields.speedx = (int32_t) GetU32 (b);
+  fields.speedy = (int32_t) GetU32 (b + 4);
+  fields.trajectoryBegin = (int64_t) GetU64 (b + 8);
+  uint64_t beta = GetU64 (b + 16);
+  std::memcpy (&fields.beta, &beta, sizeof (beta));
+  fields.positionx = (int32_t) GetU32 (b + 24);
+  fields.positiony = (int32_t) GetU32 (b + 28);
+}
+
+uint32_t
+EncodeNeighborSummary (uint8_t *b, NeighborSummary const & summary)
+{
+  b[0] = summary.GetNWords ();
+  for (uint32_t k = 0; k < summary.GetNWords (); k++)
+    {
+      PutU64 (b + 1 + 8 * k, summary.GetWord (k));
+    }
+  return NeighborSummarySize (summary);
+}
+
+uint32_t
+DecodeNeighborSummary (uint8_t const *b, uint32_t size, NeighborSummary & summary)
+{
+  if (size < 1 || size < 1 + 8 * (uint32_t) b[0])
+    {
+      return 0;
+    }
+  summary = NeighborSummary (b[0]);
+  for (uint32_t k = 0; k < summary.GetNWords (); k++)
+    {
+      summary.SetWord (k, GetU64 (b + 1 + 8 * k));
+    }
+  return NeighborSummarySize (summary);
+}
+
+} // kdtm
+} // ns3
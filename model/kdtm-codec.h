@@ -0,0 +1,117 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_CODEC_H
+#define KDTM_CODEC_H
+
+#include <stdint.h>
+#include "kdtm-neighbor-summary.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtmCore
+ * \brief Wire format of the kDTM headers, to and from byte arrays
+ *
+ * The headers of kdtm-packet.h serialize through these functions; integers
+ * are in network byte order.  Each Decode function reads the bytes its
+ * Encode function wrote.
+ */
+
+/// Writes v at b in network byte order
+void PutU32 (uint8_t *b, uint32_t v);
+void PutU64 (uint8_t *b, uint64_t v);
+/// Reads a value written by PutU32
+uint32_t GetU32 (uint8_t const *b);
+uint64_t GetU64 (uint8_t const *b);
+
+/// Fields of a hello, the doubles in the bits of their uint64_t
+struct HelloFields
+{
+  uint32_t id;
+  uint64_t originPosx;
+  uint64_t originPosy;
+  uint64_t speedx;
+  uint64_t speedy;
+  uint64_t trajectoryBegin;
+  uint64_t beta;
+};
+
+static const uint32_t HELLO_SIZE = 52;
+
+void EncodeHello (uint8_t *b, HelloFields const & fields);
+void DecodeHello (uint8_t const *b, HelloFields & fields);
+
+/// Fields of a warning, the positions in the bits of their doubles
+struct WarningFields
+{
+  uint32_t sourceId;
+  uint32_t prevHopId;
+  uint32_t hopCount;
+  uint32_t messageId;
+  uint64_t positionx;
+  uint64_t positiony;
+};
+
+static const uint32_t WARNING_SIZE = 32;
+
+void EncodeWarning (uint8_t *b, WarningFields const & fields);
+void DecodeWarning (uint8_t const *b, WarningFields & fields);
+
+/// Fields of a compact warning, the positions in decimeters
+struct CompactWarningFields
+{
+  uint32_t sourceId;
+  uint32_t prevHopId;
+  uint32_t messageId;
+  uint8_t hopCount;
+  int32_t positionx;
+  int32_t positiony;
+};
+
+/// Largest compact warning, three varints of 5 bytes and 9 bytes
+static const uint32_t COMPACT_WARNING_MAX_SIZE = 24;
+
+/// Writes v as a varint at b, returns its size
+uint32_t EncodeVarint (uint8_t *b, uint32_t v);
+/// Reads a varint at b[*pos], false if it runs past size
+bool DecodeVarint (uint8_t const *b, uint32_t size, uint32_t *pos, uint32_t *v);
+uint32_t VarintSize (uint32_t v);
+/// Fixed-point decimeters of a position in m, saturated to int32
+int32_t EncodeCompactPosition (double position);
+
+/// Encodes a compact warning at b, returns the size
+uint32_t EncodeCompactWarning (uint8_t *b, CompactWarningFields const & fields);
+/// \return the size of the compact warning at b, 0 if it runs past size
+uint32_t DecodeCompactWarning (uint8_t const *b, uint32_t size, CompactWarningFields & fields);
+
+/// Kinematics of its previous hop carried by a warning
+struct NeighborStateFields
+{
+  int32_t speedx;            // mm/s
+  int32_t speedy;
+  int64_t trajectoryBegin;   // ns
+  double beta;
+  int32_t positionx;         // dm
+  int32_t positiony;
+};
+
+static const uint32_t NEIGHBOR_STATE_SIZE = 32;
+
+void EncodeNeighborState (uint8_t *b, NeighborStateFields const & fields);
+void DecodeNeighborState (uint8_t const *b, NeighborStateFields & fields);
+
+/// Size of an encoded summary, 1 + 8 bytes by word
+inline uint32_t
+NeighborSummarySize (NeighborSummary const & summary)
+{
+  return 1 + 8 * summary.GetNWords ();
+}
+
+/// Encodes a summary at b, returns its size
+uint32_t EncodeNeighborSummary (uint8_t *b, NeighborSummary const & summary);
+/// \return the size of the summary at b, 0 if it runs past size
+uint32_t DecodeNeighborSummary (uint8_t const *b, uint32_t size, NeighborSummary & summary);
+
+} // kdtm
+} // ns3
+#endif /* KDTM_CODEC_H */
@@ -0,0 +1,227 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_COPY_QUEUE_H
+#define KDTM_COPY_QUEUE_H
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <vector>
+#include "kdtm-core.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtmCore
+ * \brief Copy of a warning heard by the node, for CopyQueue
+ */
+class CopyEntry
+{
+public:
+  CopyEntry (CoreVector position = CoreVector (), uint32_t sourceId = 0, uint32_t messageId = 0,
+             uint32_t prevHopId = 0, uint32_t hopCount = 0, bool forwarded = false)
+    : m_position (position),
+      m_sourceId (sourceId),
+      m_messageId (messageId),
+      m_prevHopId (prevHopId),
+      m_hopCount (hopCount),
+      m_forwarded (forwarded)
+  {
+  }
+
+  CoreVector GetPosition () const {
+    return m_position;
+  }
+
+  uint32_t GetSourceId () const {
+    return m_sourceId;
+  }
+
+  uint32_t GetMessageId () const {
+    return m_messageId;
+  }
+
+  uint32_t GetPrevHopId () const {
+    return m_prevHopId;
+  }
+
+  uint32_t GetHopCount () const {
+    return m_hopCount;
+  }
+
+  bool GetForwarded () const {
+    return m_forwarded;
+  }
+
+  void SetForwarded (bool forwarded)
+  {
+    m_forwarded = forwarded;
+  }
+
+private:
+  CoreVector m_position;   // of the previous hop
+  uint32_t m_sourceId;
+  uint32_t m_messageId;
+  uint32_t m_prevHopId;
+  uint32_t m_hopCount;
+  bool m_forwarded;
+};
+
+/// Rebroadcast decision taken for a message, see CopyQueue::SetDecision
+struct CopyDecision
+{
+  double distanceToMean;  // to the mean position of the copies, in ranges
+  double threshold;
+  bool rebroadcast;
+  TableTime deadline;     // backoff expiry the decision was taken at
+};
+
+/**
+ * \ingroup kdtmCore
+ * \brief Copies of the warnings heard by a node, by message
+ *
+ * The sums of the positions of the copies are kept as they are added, the
+ * mean position costs a division.  Entry must have GetMessageId,
+ * GetPrevHopId, GetForwarded and a GetPosition with x and y; the ns-3 Queue
+ * is CopyQueue<QueueEntry, QueueDecision>.
+ */
+template <class Entry, class Decision = CopyDecision>
+class CopyQueue
+{
+public:
+  /// Add a copy, first of the copies of its message
+  void Add (Entry const & entry)
+  {
+    MessageCopies & copies = m_queue[entry.GetMessageId ()];
+    copies.sumx += entry.GetPosition ().x;
+    copies.sumy += entry.GetPosition ().y;
+    copies.decided = false;
+    copies.entries.push_front (entry);
+  }
+
+  /// Delete the copies of a message
+  void Purge (uint32_t messageId)
+  {
+    m_queue.erase (messageId);
+  }
+
+  /// Find if a copy of a message from a previous hop is in the queue
+  bool Find (uint32_t messageId, uint32_t prevId) const
+  {
+    typename std::map<uint32_t, MessageCopies>::const_iterator i = m_queue.find (messageId);
+    if (i != m_queue.end ())
+      {
+        typename std::list<Entry>::const_iterator j = i->second.entries.begin ();
+        for (; j != i->second.entries.end (); j++)
+          {
+            if (j->GetPrevHopId () == prevId)
+              {
+                return true;
+              }
+          }
+      }
+    return false;
+  }
+
+  /// Find if a message has copies
+  bool Exist (uint32_t messageId) const
+  {
+    return m_queue.find (messageId) != m_queue.end ();
+  }
+
+  /// Mean position of the copies of a message, (0, 0) without copies
+  CoreVector GetMeanPosition (uint32_t messageId) const
+  {
+    CoreVector mean;
+    typename std::map<uint32_t, MessageCopies>::const_iterator i = m_queue.find (messageId);
+    if (i != m_queue.end () && !(i->second.entries.empty ()))
+      {
+        mean.x = ((double) 1/i->second.entries.size ()) * i->second.sumx;
+        mean.y = ((double) 1/i->second.entries.size ()) * i->second.sumy;
+      }
+    return mean;
+  }
+
+  /// Previous hops of the copies of a message, the last one first
+  std::vector<uint32_t> GetPrevHops (uint32_t messageId) const
+  {
+    std::vector<uint32_t> prevHops;
+    typename std::map<uint32_t, MessageCopies>::const_iterator i = m_queue.find (messageId);
+    if (i != m_queue.end ())
+      {
+        typename std::list<Entry>::const_iterator j = i->second.entries.begin ();
+        for (; j != i->second.entries.end (); j++)
+          {
+            prevHops.push_back (j->GetPrevHopId ());
+          }
+      }
+    return prevHops;
+  }
+
+  /**
+   * \brief Decision cached for a message
+   * \return false if none was set or a copy was added since
+   */
+  bool GetDecision (uint32_t messageId, Decision & decision) const
+  {
+    typename std::map<uint32_t, MessageCopies>::const_iterator i = m_queue.find (messageId);
+    if (i == m_queue.end () || !i->second.decided)
+      {
+        return false;
+      }
+    decision = i->second.decision;
+    return true;
+  }
+
+  /// Caches the decision taken for a message with its current copies
+  void SetDecision (uint32_t messageId, Decision const & decision)
+  {
+    typename std::map<uint32_t, MessageCopies>::iterator i = m_queue.find (messageId);
+    if (i != m_queue.end ())
+      {
+        i->second.decision = decision;
+        i->second.decided = true;
+      }
+  }
+
+  /// Last copy of a message, which must exist
+  Entry & GetEntry (uint32_t messageId)
+  {
+    return m_queue.find (messageId)->second.entries.front ();
+  }
+
+  bool IsAlreadyForwarded (uint32_t messageId) const
+  {
+    typename std::map<uint32_t, MessageCopies>::const_iterator i = m_queue.find (messageId);
+    if (i != m_queue.end ())
+      {
+        return i->second.entries.front ().GetForwarded ();
+      }
+    return false;
+  }
+
+protected:
+  /// Copies of a message, the sums of their positions kept as they are
+  /// added, and the decision taken with them
+  struct MessageCopies
+  {
+    MessageCopies ()
+      : sumx (0),
+        sumy (0),
+        decided (false)
+    {
+    }
+    std::list<Entry> entries;
+    double sumx;
+    double sumy;
+    bool decided;
+    Decision decision;
+  };
+
+  /// Copies by message id
+  std::map<uint32_t, MessageCopies> m_queue;
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_COPY_QUEUE_H */
@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_CORE_H
+#define KDTM_CORE_H
+
+#include <stdint.h>
+#include <cmath>
+#include <iostream>
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \defgroup kdtmCore Protocol core
+ *
+ * The decision logic of kDTM, free of ns-3: NeighborTable (link windows,
+ * kinetic degree, TX failures), CopyQueue (copies of the warnings and
+ * rebroadcast decisions), the codec of the headers (kdtm-codec.h), the
+ * policies (kdtm-policies.h), NeighborSummary and SolveLinkWindows.  They
+ * only include the standard library and each other, so that they build
+ * alone, with any optimization, in a benchmark or on a vehicle:
+ *
+ *   g++ -O3 -c kdtm-neighbor-table.cc kdtm-codec.cc kdtm-link-solver.cc kdtm-neighbor-summary.cc
+ *
+ * The core takes time from a CoreClock and the positions of nodes it knows
+ * better than by their hellos from a PositionSource.  PositionTable, Queue
+ * and the headers of kdtm-packet.h are the ns-3 adapters of the core.
+ */
+
+/**
+ * \ingroup kdtmCore
+ * \brief Time of the core, in nanoseconds
+ *
+ * Times are stored as plain integers: the per-neighbor loops subtract
+ * integers and scale the difference instead of calling Time::GetSeconds.
+ */
+typedef int64_t TableTime;
+
+inline double
+TableTimeToSeconds (TableTime time)
+{
+  return time * 1e-9;
+}
+
+/// Saturates at the limits of TableTime, about 292 years
+inline TableTime
+SecondsToTableTime (double seconds)
+{
+  double ns = std::floor (seconds * 1e9 + 0.5);
+  if (ns >= 9223372036854775807.0)
+    {
+      return INT64_MAX;
+    }
+  if (ns <= -9223372036854775807.0)
+    {
+      return INT64_MIN;
+    }
+  return (TableTime) ns;
+}
+
+/**
+ * \ingroup kdtmCore
+ * \brief Position or velocity in the core, as ns3::Vector
+ */
+struct CoreVector
+{
+  CoreVector (double x = 0, double y = 0, double z = 0)
+    : x (x), y (y), z (z)
+  {
+  }
+
+  double x, y, z;
+};
+
+/// Distance of two points, as ns3::CalculateDistance
+inline double
+CoreDistance (CoreVector const & a, CoreVector const & b)
+{
+  double dx = a.x - b.x;
+  double dy = a.y - b.y;
+  double dz = a.z - b.z;
+  return std::sqrt (dx * dx + dy * dy + dz * dz);
+}
+
+/**
+ * \ingroup kdtmCore
+ * \brief Current time of the core
+ */
+class CoreClock
+{
+public:
+  virtual ~CoreClock ()
+  {
+  }
+
+  virtual TableTime Now () const = 0;
+};
+
+/**
+ * \ingroup kdtmCore
+ * \brief Clock set by hand, for benchmarks and replays
+ */
+class ManualClock : public CoreClock
+{
+public:
+  ManualClock (TableTime now = 0)
+    : m_now (now)
+  {
+  }
+
+  virtual TableTime Now () const
+  {
+    return m_now;
+  }
+
+  void Set (TableTime now)
+  {
+    m_now = now;
+  }
+
+private:
+  TableTime m_now;
+};
+
+/**
+ * \ingroup kdtmCore
+ * \brief Positions of the nodes known otherwise than by their hellos, by
+ * the mobility of a simulator or the GNSS of a vehicle
+ */
+class PositionSource
+{
+public:
+  virtual ~PositionSource ()
+  {
+  }
+
+  /// \return false if the position of the node is not known
+  virtual bool GetPosition (uint32_t id, CoreVector & position) const = 0;
+};
+
+/**
+ * \ingroup kdtmCore
+ * \brief Writes a value of fixed size to a snapshot, in host byte order
+ * (see kdtm-snapshot.h)
+ */
+template <typename T>
+void
+SnapshotWrite (std::ostream & os, T const & value)
+{
+  os.write (reinterpret_cast<char const *> (&value), sizeof (T));
+}
+
+/// \return false at the end of the stream
+template <typename T>
+bool
+SnapshotRead (std::istream & is, T & value)
+{
+  return (bool) is.read (reinterpret_cast<char *> (&value), sizeof (T));
+}
+
+} // kdtm
+} // ns3
+#endif /* KDTM_CORE_H */
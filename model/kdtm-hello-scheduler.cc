@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-hello-scheduler.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmHelloScheduler");
+
+namespace ns3 {
+namespace kdtm {
+
+/// Orders the hellos of a slot by deadline only, stable_sort keeps the
+/// scheduling order of equal deadlines
+static bool
+EarlierDeadline (std::pair<Time, uint32_t> const & a, std::pair<Time, uint32_t> const & b)
+{
+  return a.first < b.first;
+}
+
+HelloScheduler::HelloScheduler ()
+  : m_slot (MilliSeconds (1)),
+    m_eventSlot (0),
+    m_nEvents (0),
+    m_nHellos (0)
+{
+}
+
+HelloScheduler::~HelloScheduler ()
+{
+  m_event.Cancel ();
+}
+
+void
+HelloScheduler::SetSlot (Time slot)
+{
+  NS_ASSERT (slot.IsStrictlyPositive ());
+  NS_ASSERT (m_slots.empty ());
+  m_slot = slot;
+}
+
+void
+HelloScheduler::Schedule (uint32_t node, Time deadline)
+{
+  // Slot k holds the deadlines of ](k - 1) slot, k slot]
+  int64_t ticks = deadline.GetTimeStep ();
+  int64_t width = m_slot.GetTimeStep ();
+  int64_t slot = ticks > 0 ? (ticks + width - 1) / width : ticks / width;
+  m_slots[slot].push_back (std::make_pair (deadline, node));
+  Arm ();
+}
+
+void
+HelloScheduler::Clear ()
+{
+  m_event.Cancel ();
+  m_slots.clear ();
+}
+
+void
+HelloScheduler::Arm ()
+{
+  if (m_slots.empty ())
+    {
+      return;
+    }
+  int64_t first = m_slots.begin ()->first;
+  if (m_event.IsRunning () && m_eventSlot <= first)
+    {
+      return;
+    }
+  // A hello due before the pending event, or the first one
+  m_event.Cancel ();
+  m_eventSlot = first;
+  Time end = TimeStep (first * m_slot.GetTimeStep ());
+  Time now = Simulator::Now ();
+  m_event = Simulator::Schedule (end > now ? end - now : Time (0), &HelloScheduler::Serve, this);
+}
+
+void
+HelloScheduler::Serve ()
+{
+  m_nEvents++;
+  std::vector<Hello> hellos;
+  hellos.swap (m_slots.begin ()->second);
+  m_slots.erase (m_slots.begin ());
+  std::stable_sort (hellos.begin (), hellos.end (), &EarlierDeadline);
+
+  Time now = Simulator::Now ();
+  for (uint32_t k = 0; k < hellos.size (); k++)
+    {
+      m_deadline = hellos[k].first;
+      m_lateness += now - m_deadline;
+      m_nHellos++;
+      m_send (hellos[k].second);
+    }
+  NS_LOG_LOGIC ("Slot of " << hellos.size () << " hellos at " << now.GetSeconds ());
+  Arm ();
+}
+
+} // kdtm
+} // ns3
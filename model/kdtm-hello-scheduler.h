@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_HELLO_SCHEDULER_H
+#define KDTM_HELLO_SCHEDULER_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "ns3/nstime.h"
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Hellos of many nodes served by slot, with one simulator event
+ *
+ * Instead of a simulator event per node and per hello, the deadlines are
+ * kept by slot and the simulator only holds the event of the first slot.
+ * A hello is sent at the end of the slot of its deadline, at most a slot
+ * late; the nodes keep the phase of their deadlines as long as they compute
+ * the next one from GetDeadline rather than from the current time.  The
+ * hellos of a slot are sent in the order of their deadlines.
+ */
+class HelloScheduler
+{
+public:
+  /// c-tor
+  HelloScheduler ();
+  ~HelloScheduler ();
+
+  /// Set the function sending the hello of a node
+  void SetCallback (Callback<void, uint32_t> send)
+  {
+    m_send = send;
+  }
+
+  Time GetSlot () const {
+    return m_slot;
+  }
+
+  /// Set the width of the slots, 1 ms by default
+  void SetSlot (Time slot);
+
+  /**
+   * \brief Schedules a hello of a node
+   * \param deadline absolute time the hello is due, sent at the end of its slot
+   */
+  void Schedule (uint32_t node, Time deadline);
+
+  /// Deadline of the hello being sent
+  Time GetDeadline () const {
+    return m_deadline;
+  }
+
+  /// Cancels all the hellos
+  void Clear ();
+
+  /// Number of simulator events run
+  uint64_t GetNEvents () const {
+    return m_nEvents;
+  }
+
+  /// Number of hellos sent
+  uint64_t GetNHellos () const {
+    return m_nHellos;
+  }
+
+  /// Sum of the delays of the hellos after their deadline
+  Time GetLateness () const {
+    return m_lateness;
+  }
+
+private:
+  /// Deadline and node of a hello
+  typedef std::pair<Time, uint32_t> Hello;
+
+  Time m_slot;
+  Callback<void, uint32_t> m_send;
+  /// Hellos by slot index, the slot k ends at k * m_slot
+  std::map<int64_t, std::vector<Hello> > m_slots;
+  EventId m_event;
+  int64_t m_eventSlot;
+  Time m_deadline;
+  uint64_t m_nEvents;
+  uint64_t m_nHellos;
+  Time m_lateness;
+
+  /// Schedules the event of the first slot if it is not
+  void Arm ();
+  /// Sends the hellos of the first slot
+  void Serve ();
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_HELLO_SCHEDULER_H */
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-kinetic-degree.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmKineticDegree");
+
+namespace ns3 {
+namespace kdtm {
+
+KineticDegreeCurve::KineticDegreeCurve ()
+  : m_horizon (Seconds (1)),
+    m_step (MilliSeconds (20)),
+    m_version (0)
+{
+}
+
+void
+KineticDegreeCurve::Build (PositionTable & table, Ptr<KineticModel> model, Time now)
+{
+  NS_ASSERT (model);
+  m_model = model;
+  m_times.clear ();
+  m_degrees.clear ();
+
+  int64_t begin = now.GetNanoSeconds ();
+  int64_t end = (now + m_horizon).GetNanoSeconds ();
+  int64_t step = std::max (m_step.GetNanoSeconds (), (int64_t) 1);
+  for (int64_t t = begin; t < end; t += step)
+    {
+      m_times.push_back (t);
+    }
+  m_times.push_back (end);
+
+  // A neighbor enters or leaves with a jump of the degree, sample both sides
+  std::map<uint32_t, PositionTableEntry> const & entries = table.GetEntries ();
+  for (std::map<uint32_t, PositionTableEntry>::const_iterator i = entries.begin (); i != entries.end (); i++)
+    {
+      TableTime events[2] = { i->second.from, i->second.to };
+      for (int k = 0; k < 2; k++)
+        {
+          if (begin < events[k] && events[k] <= end)
+            {
+              m_times.push_back (events[k] - 1);
+              m_times.push_back (events[k]);
+            }
+        }
+    }
+  std::sort (m_times.begin (), m_times.end ());
+  m_times.erase (std::unique (m_times.begin (), m_times.end ()), m_times.end ());
+
+  m_degrees.reserve (m_times.size ());
+  for (uint32_t k = 0; k < m_times.size (); k++)
+    {
+      m_degrees.push_back (model->CalculateDegree (table, NanoSeconds (m_times[k])));
+    }
+  m_version = table.GetVersion ();
+  NS_LOG_DEBUG ("Kinetic degree of " << entries.size () << " neighbors sampled at "
+                << m_times.size () << " times");
+}
+
+bool
+KineticDegreeCurve::IsValid (PositionTable const & table, Time time) const
+{
+  int64_t t = time.GetNanoSeconds ();
+  return !m_times.empty ()
+    && m_version == table.GetVersion ()
+    && m_times.front () <= t && t <= m_times.back ();
+}
+
+double
+KineticDegreeCurve::GetDegree (Time time) const
+{
+  NS_ASSERT (!m_times.empty ());
+  int64_t t = time.GetNanoSeconds ();
+  std::vector<int64_t>::const_iterator i = std::upper_bound (m_times.begin (), m_times.end (), t);
+  if (i == m_times.begin ())
+    {
+      return m_degrees.front ();
+    }
+  if (i == m_times.end ())
+    {
+      return m_degrees.back ();
+    }
+  uint32_t k = i - m_times.begin ();
+  double f = double (t - m_times[k - 1]) / double (m_times[k] - m_times[k - 1]);
+  return m_degrees[k - 1] + f * (m_degrees[k] - m_degrees[k - 1]);
+}
+
+double
+KineticDegreeCurve::GetThreshold (Time time) const
+{
+  return m_model->GetThreshold (GetDegree (time));
+}
+
+bool
+KineticDegreeCurve::FindThresholdBelow (double level, Time from, Time & time) const
+{
+  NS_ASSERT (!m_times.empty ());
+  if (GetThreshold (from) < level)
+    {
+      time = from;
+      return true;
+    }
+  std::vector<int64_t>::const_iterator i = std::upper_bound (m_times.begin (), m_times.end (),
+                                                              from.GetNanoSeconds ());
+  for (uint32_t k = i - m_times.begin (); k < m_times.size (); k++)
+    {
+      if (m_model->GetThreshold (m_degrees[k]) < level)
+        {
+          time = NanoSeconds (m_times[k]);
+          return true;
+        }
+    }
+  return false;
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,110 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_KINETIC_DEGREE_H
+#define KDTM_KINETIC_DEGREE_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+#include "kdtm-ptable.h"
+#include "kdtm-kinetic-model.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Kinetic degree of a table over a look-ahead horizon
+ *
+ * Between two updates of a table the kinetic degree only depends on time:
+ * the link windows are fixed, neighbors enter at the beginning of their
+ * window and leave at its end.  The curve samples the degree on a regular
+ * grid over [now, now + horizon] and at the enter and exit events of the
+ * neighbors, on both sides of each event, and interpolates linearly between
+ * the samples.  The degree and the threshold at any time of the horizon are
+ * then found in O(log m) for m samples, without going over the neighbors.
+ *
+ * The curve is valid as long as the table has the version it was built from
+ * (see PositionTable::GetVersion): every update of a neighbor, of the own
+ * kinematics or of the parameters of the degree invalidates it, the expiry
+ * of a window does not.
+ *
+ * Build evaluates the degree at up to horizon / step + 1 + 2 n times for n
+ * neighbors, O(n^2) per version of the table: the curve only pays off when
+ * a version is queried more often than that.  kdtm-example does not use it,
+ * its tables change with most hellos.
+ */
+class KineticDegreeCurve
+{
+public:
+  /// c-tor
+  KineticDegreeCurve ();
+
+  /**
+   * \brief Samples the degree of a table from now to now + horizon
+   */
+  void Build (PositionTable & table, Ptr<KineticModel> model, Time now);
+
+  /**
+   * \return true if the curve was built from the current version of the
+   * table and time is in its horizon
+   */
+  bool IsValid (PositionTable const & table, Time time) const;
+
+  /**
+   * \brief Interpolated kinetic degree at time, time is clamped to the horizon
+   */
+  double GetDegree (Time time) const;
+
+  /**
+   * \brief Rebroadcast threshold of the interpolated degree at time
+   */
+  double GetThreshold (Time time) const;
+
+  /**
+   * \brief Finds when the threshold falls below a level
+   *
+   * For a caller which sets a timer from the predicted thresholds instead
+   * of polling the table.  The time found is the first sample after from whose
+   * threshold is below level, it is late by at most one step.
+   * \param time first sample time below level, unchanged if not found
+   * \return false if the threshold stays above level until the end of the
+   * horizon
+   */
+  bool FindThresholdBelow (double level, Time from, Time & time) const;
+
+  Time GetHorizon () const {
+    return m_horizon;
+  }
+
+  void SetHorizon (Time horizon)
+  {
+    m_horizon = horizon;
+  }
+
+  Time GetStep () const {
+    return m_step;
+  }
+
+  void SetStep (Time step)
+  {
+    m_step = step;
+  }
+
+  /// Number of samples of the last Build
+  uint32_t GetNSamples () const {
+    return m_times.size ();
+  }
+
+private:
+  Time m_horizon;
+  Time m_step;
+  Ptr<KineticModel> m_model;
+  uint64_t m_version;
+  std::vector<int64_t> m_times;   // ns, ascending
+  std::vector<double> m_degrees;
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_KINETIC_DEGREE_H */
@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-kinetic-model.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE ("KdtmKineticModel");
+
+namespace ns3 {
+namespace kdtm {
+
+KineticModel::~KineticModel ()
+{
+}
+
+/// Last step of CreateKineticModel, the threshold model
+template <class StabilityPolicy, class DegreePolicy>
+static Ptr<KineticModel>
+CreateWithThreshold (std::string threshold)
+{
+  if (threshold == "exponential")
+    {
+      return Create<PolicyKineticModel<StabilityPolicy, DegreePolicy, ExponentialThreshold> > ();
+    }
+  if (threshold == "constant")
+    {
+      return Create<PolicyKineticModel<StabilityPolicy, DegreePolicy, ConstantThreshold> > ();
+    }
+  NS_LOG_ERROR ("Unknown threshold model " << threshold);
+  return 0;
+}
+
+/// Second step of CreateKineticModel, the link degree model
+template <class StabilityPolicy>
+static Ptr<KineticModel>
+CreateWithDegree (std::string degree, std::string threshold)
+{
+  if (degree == "sigmoid")
+    {
+      return CreateWithThreshold<StabilityPolicy, DoubleSigmoidDegree> (threshold);
+    }
+  if (degree == "window")
+    {
+      return CreateWithThreshold<StabilityPolicy, WindowDegree> (threshold);
+    }
+  NS_LOG_ERROR ("Unknown link degree model " << degree);
+  return 0;
+}
+
+Ptr<KineticModel>
+CreateKineticModel (std::string stability, std::string degree, std::string threshold)
+{
+  if (stability == "poisson")
+    {
+      return CreateWithDegree<PoissonStability> (degree, threshold);
+    }
+  if (stability == "unit")
+    {
+      return CreateWithDegree<UnitStability> (degree, threshold);
+    }
+  NS_LOG_ERROR ("Unknown stability model " << stability);
+  return 0;
+}
+
+} // kdtm
+} // ns3
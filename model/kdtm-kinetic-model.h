@@ -0,0 +1,84 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_KINETIC_MODEL_H
+#define KDTM_KINETIC_MODEL_H
+
+#include <string>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "kdtm-ptable.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Kinetic degree and threshold models chosen at run time
+ *
+ * Type-erased counterpart of BasicPositionTable: one virtual call per
+ * computation selects the models, the loop over the neighbors is compiled
+ * for them.  The same model can be shared by the tables of all the nodes.
+ */
+class KineticModel : public SimpleRefCount<KineticModel>
+{
+public:
+  virtual ~KineticModel ();
+
+  /// Kinetic degree of a table at time
+  virtual double CalculateDegree (PositionTable & table, Time time) const = 0;
+  /// Rebroadcast threshold of a table at time
+  virtual double CalculateThreshold (PositionTable & table, Time time) const = 0;
+  /// Rebroadcast threshold of a kinetic degree
+  virtual double GetThreshold (double kineticDegree) const = 0;
+};
+
+/**
+ * \ingroup kdtm
+ * \brief KineticModel of a combination of policies
+ */
+template <class StabilityPolicy, class DegreePolicy, class ThresholdPolicy>
+class PolicyKineticModel : public KineticModel
+{
+public:
+  PolicyKineticModel (StabilityPolicy stability = StabilityPolicy (),
+                      DegreePolicy degree = DegreePolicy (),
+                      ThresholdPolicy threshold = ThresholdPolicy ())
+    : m_stability (stability),
+      m_degree (degree),
+      m_threshold (threshold)
+  {
+  }
+
+  virtual double CalculateDegree (PositionTable & table, Time time) const
+  {
+    return table.CalculateDegreeWith (time, m_stability, m_degree);
+  }
+
+  virtual double CalculateThreshold (PositionTable & table, Time time) const
+  {
+    return m_threshold (table.CalculateDegreeWith (time, m_stability, m_degree));
+  }
+
+  virtual double GetThreshold (double kineticDegree) const
+  {
+    return m_threshold (kineticDegree);
+  }
+
+private:
+  StabilityPolicy m_stability;
+  DegreePolicy m_degree;
+  ThresholdPolicy m_threshold;
+};
+
+/**
+ * \brief Creates the model of a combination of the policies of kdtmPolicies
+ * \param stability "poisson" (PoissonStability) or "unit" (UnitStability)
+ * \param degree "sigmoid" (DoubleSigmoidDegree) or "window" (WindowDegree)
+ * \param threshold "exponential" (ExponentialThreshold) or "constant"
+ * (ConstantThreshold)
+ * \return the model, 0 if a name is unknown
+ */
+Ptr<KineticModel> CreateKineticModel (std::string stability, std::string degree, std::string threshold);
+
+} // kdtm
+} // ns3
+#endif /* KDTM_KINETIC_MODEL_H */
@@ -0,0 +1,237 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-kpi.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmKpi");
+
+namespace ns3 {
+namespace kdtm {
+
+//-----------------------------------------------------------------------------
+// LogHistogram
+//-----------------------------------------------------------------------------
+LogHistogram::LogHistogram (double min, double max, uint32_t bucketsPerOctave)
+  : m_min (min),
+    m_bucketsPerOctave (bucketsPerOctave > 0 ? bucketsPerOctave : 1),
+    m_count (0),
+    m_sum (0),
+    m_minValue (0),
+    m_maxValue (0)
+{
+  NS_ASSERT (min > 0 && max > min);
+  // Bucket 0, the buckets up to max and the one above it
+  uint32_t n = (uint32_t) std::ceil (std::log2 (max / min) * m_bucketsPerOctave);
+  m_counts.resize (n + 2, 0);
+}
+
+void
+LogHistogram::Add (double value)
+{
+  uint32_t k = 0;
+  if (value > m_min)
+    {
+      double bucket = std::ceil (std::log2 (value / m_min) * m_bucketsPerOctave);
+      k = (uint32_t) std::min (bucket, (double) m_counts.size () - 1);
+    }
+  m_counts[k]++;
+  m_minValue = m_count ? std::min (m_minValue, value) : value;
+  m_maxValue = m_count ? std::max (m_maxValue, value) : value;
+  m_count++;
+  m_sum += value;
+}
+
+void
+LogHistogram::Merge (LogHistogram const & other)
+{
+  NS_ASSERT (other.m_counts.size () == m_counts.size ());
+  if (other.m_count == 0)
+    {
+      return;
+    }
+  for (uint32_t k = 0; k < m_counts.size (); k++)
+    {
+      m_counts[k] += other.m_counts[k];
+    }
+  m_minValue = m_count ? std::min (m_minValue, other.m_minValue) : other.m_minValue;
+  m_maxValue = m_count ? std::max (m_maxValue, other.m_maxValue) : other.m_maxValue;
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+}
+
+double
+LogHistogram::GetBucketBound (uint32_t k) const
+{
+  if (k + 1 >= m_counts.size ())
+    {
+      return std::numeric_limits<double>::infinity ();
+    }
+  return m_min * std::pow (2.0, (double) k / m_bucketsPerOctave);
+}
+
+double
+LogHistogram::GetQuantile (double q) const
+{
+  if (m_count == 0)
+    {
+      return 0;
+    }
+  uint64_t rank = (uint64_t) std::ceil (std::max (0.0, std::min (q, 1.0)) * m_count);
+  rank = std::max<uint64_t> (rank, 1);
+  uint64_t seen = 0;
+  uint32_t k = 0;
+  for (; k < m_counts.size (); k++)
+    {
+      seen += m_counts[k];
+      if (seen >= rank)
+        {
+          break;
+        }
+    }
+  return std::max (m_minValue, std::min (GetBucketBound (k), m_maxValue));
+}
+
+void
+LogHistogram::Restore (std::vector<uint64_t> const & counts, double sum, double min, double max)
+{
+  NS_ASSERT (counts.size () == m_counts.size ());
+  m_counts = counts;
+  m_count = 0;
+  for (uint32_t k = 0; k < m_counts.size (); k++)
+    {
+      m_count += m_counts[k];
+    }
+  m_sum = sum;
+  m_minValue = min;
+  m_maxValue = max;
+}
+
+//-----------------------------------------------------------------------------
+// DisseminationKpi
+//-----------------------------------------------------------------------------
+MessageKpi::MessageKpi ()
+  : start (Seconds (0)),
+    targets (0),
+    reachedTargets (0),
+    transmissions (0),
+    latency (1e-4, 1e3),
+    hops (1, 1024)
+{
+}
+
+DisseminationKpi::DisseminationKpi ()
+  : m_nTargets (0),
+    m_nReachedTargets (0),
+    m_nTransmissions (0)
+{
+}
+
+MessageKpi &
+DisseminationKpi::GetOrCreate (uint32_t messageId)
+{
+  return m_messages[messageId];
+}
+
+void
+DisseminationKpi::StartMessage (uint32_t messageId, Time start, uint32_t targets)
+{
+  MessageKpi & message = GetOrCreate (messageId);
+  message.start = start;
+  message.targets = targets;
+  m_nTargets += targets;
+}
+
+void
+DisseminationKpi::AddDelivery (uint32_t messageId, Time time, uint32_t hopCount, bool inTarget)
+{
+  MessageKpi & message = GetOrCreate (messageId);
+  double latency = (time - message.start).GetSeconds ();
+  message.latency.Add (latency);
+  message.hops.Add (hopCount);
+  m_run.latency.Add (latency);
+  m_run.hops.Add (hopCount);
+  if (inTarget)
+    {
+      message.reachedTargets++;
+      m_nReachedTargets++;
+    }
+}
+
+void
+DisseminationKpi::AddTransmission (uint32_t messageId)
+{
+  GetOrCreate (messageId).transmissions++;
+  m_nTransmissions++;
+}
+
+MessageKpi const *
+DisseminationKpi::GetMessage (uint32_t messageId) const
+{
+  std::map<uint32_t, MessageKpi>::const_iterator i = m_messages.find (messageId);
+  return i == m_messages.end () ? 0 : &i->second;
+}
+
+double
+DisseminationKpi::GetCoverage () const
+{
+  return m_nTargets ? (double) m_nReachedTargets / m_nTargets : 0;
+}
+
+double
+DisseminationKpi::GetTransmissionsPerDelivery () const
+{
+  return GetNDeliveries () ? (double) m_nTransmissions / GetNDeliveries () : 0;
+}
+
+void
+DisseminationKpi::RestoreRun (LogHistogram const & latency, LogHistogram const & hops, uint64_t targets,
+                              uint64_t reachedTargets, uint64_t transmissions)
+{
+  m_run.latency = latency;
+  m_run.hops = hops;
+  m_nTargets = targets;
+  m_nReachedTargets = reachedTargets;
+  m_nTransmissions = transmissions;
+}
+
+/// Writes the columns of DisseminationKpi::Write after the message
+static void
+WriteKpi (std::ostream & os, uint64_t targets, uint64_t reachedTargets, uint64_t transmissions,
+          LogHistogram const & latency, LogHistogram const & hops)
+{
+  uint64_t delivered = latency.GetCount ();
+  os << " " << delivered
+     << " " << (targets ? (double) reachedTargets / targets : 0)
+     << " " << transmissions
+     << " " << (delivered ? (double) transmissions / delivered : 0)
+     << " " << latency.GetQuantile (0.5)
+     << " " << latency.GetQuantile (0.95)
+     << " " << latency.GetMax ()
+     << " " << hops.GetQuantile (0.5)
+     << " " << hops.GetQuantile (0.95)
+     << " " << hops.GetMax ()
+     << std::endl;
+}
+
+void
+DisseminationKpi::Write (std::ostream & os) const
+{
+  os << "message delivered coverage transmissions txPerDelivery latencyP50 latencyP95 latencyMax"
+     << " hopsP50 hopsP95 hopsMax" << std::endl;
+  std::map<uint32_t, MessageKpi>::const_iterator i = m_messages.begin ();
+  for (; i != m_messages.end (); i++)
+    {
+      MessageKpi const & message = i->second;
+      os << i->first;
+      WriteKpi (os, message.targets, message.reachedTargets, message.transmissions,
+                message.latency, message.hops);
+    }
+  os << "run";
+  WriteKpi (os, m_nTargets, m_nReachedTargets, m_nTransmissions, m_run.latency, m_run.hops);
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_KPI_H
+#define KDTM_KPI_H
+
+#include <stdint.h>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "ns3/nstime.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Histogram of positive values in logarithmic buckets
+ *
+ * Bucket 0 counts the values up to min, bucket k > 0 those of
+ * ]min 2^((k-1)/b), min 2^(k/b)] for b buckets per octave, the last one
+ * everything above max.  The memory is fixed by the bounds; quantiles are
+ * the upper bounds of their buckets, within 2^(1/b) - 1 (9% for b = 8) of
+ * the exact value.  Count, sum, min and max are exact.
+ */
+class LogHistogram
+{
+public:
+  /// c-tor
+  LogHistogram (double min = 1e-4, double max = 1e3, uint32_t bucketsPerOctave = 8);
+
+  void Add (double value);
+
+  /// Adds the values of a histogram of the same bounds
+  void Merge (LogHistogram const & other);
+
+  uint64_t GetCount () const {
+    return m_count;
+  }
+
+  double GetSum () const {
+    return m_sum;
+  }
+
+  double GetMean () const {
+    return m_count ? m_sum / m_count : 0;
+  }
+
+  /// Smallest value, 0 if none
+  double GetMin () const {
+    return m_count ? m_minValue : 0;
+  }
+
+  /// Largest value, 0 if none
+  double GetMax () const {
+    return m_count ? m_maxValue : 0;
+  }
+
+  /// Smallest bucket bound with a fraction q of the values at or below it,
+  /// clamped to the values seen; 0 if none
+  double GetQuantile (double q) const;
+
+  uint32_t GetNBuckets () const {
+    return m_counts.size ();
+  }
+
+  uint64_t GetBucketCount (uint32_t k) const {
+    return m_counts[k];
+  }
+
+  /// Upper bound of bucket k, infinity for the last one
+  double GetBucketBound (uint32_t k) const;
+
+  /**
+   * \brief Replaces the values by those counted elsewhere, e.g. the sums of
+   * the buckets of the histograms of several processes
+   */
+  void Restore (std::vector<uint64_t> const & counts, double sum, double min, double max);
+
+private:
+  double m_min;
+  uint32_t m_bucketsPerOctave;
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count;
+  double m_sum;
+  double m_minValue;
+  double m_maxValue;
+};
+
+/**
+ * \ingroup kdtm
+ * \brief End-to-end figures of the dissemination of a warning
+ */
+struct MessageKpi
+{
+  MessageKpi ();
+
+  Time start;              // time the warning was raised
+  uint32_t targets;        // nodes of the target area, source excluded
+  uint32_t reachedTargets;
+  uint32_t transmissions;  // of the source and the forwarders
+  LogHistogram latency;    // s, of the first reception at each node
+  LogHistogram hops;       // of the first reception at each node
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Dissemination KPIs computed as the warnings go
+ *
+ * Nothing is kept per reception: each message has its histograms of the
+ * latency and hop count of the first reception at each node, its counts
+ * of transmissions and of the nodes of its target area it reached, and the
+ * run the sum of them.  The memory grows with the number of messages only.
+ */
+class DisseminationKpi
+{
+public:
+  /// c-tor
+  DisseminationKpi ();
+
+  /**
+   * \brief A warning was raised
+   * \param targets number of nodes of its target area, source excluded
+   */
+  void StartMessage (uint32_t messageId, Time start, uint32_t targets);
+
+  /**
+   * \brief First reception of a warning by a node other than its source
+   * \param inTarget whether the node is in the target area
+   */
+  void AddDelivery (uint32_t messageId, Time time, uint32_t hopCount, bool inTarget);
+
+  /// The source or a forwarder sent a copy of a warning
+  void AddTransmission (uint32_t messageId);
+
+  /// \return the KPIs of a message, 0 if unknown
+  MessageKpi const * GetMessage (uint32_t messageId) const;
+
+  /// Latencies of all the messages, s
+  LogHistogram const & GetLatency () const {
+    return m_run.latency;
+  }
+
+  LogHistogram const & GetHops () const {
+    return m_run.hops;
+  }
+
+  uint64_t GetNDeliveries () const {
+    return m_run.latency.GetCount ();
+  }
+
+  uint64_t GetNTransmissions () const {
+    return m_nTransmissions;
+  }
+
+  /// Reached nodes of the target areas over their nodes, 0 without target
+  double GetCoverage () const;
+
+  /// Transmissions per node reached
+  double GetTransmissionsPerDelivery () const;
+
+  /**
+   * \brief Replaces the run figures, e.g. by the sums of several processes
+   */
+  void RestoreRun (LogHistogram const & latency, LogHistogram const & hops, uint64_t targets,
+                   uint64_t reachedTargets, uint64_t transmissions);
+
+  uint64_t GetNTargets () const {
+    return m_nTargets;
+  }
+
+  uint64_t GetNReachedTargets () const {
+    return m_nReachedTargets;
+  }
+
+  /**
+   * \brief Writes a line per message and a line for the run
+   *
+   * \verbatim
+     message delivered coverage transmissions txPerDelivery latencyP50 latencyP95 latencyMax hopsP50 hopsP95 hopsMax
+     \endverbatim
+   * with "run" as message of the last line.
+   */
+  void Write (std::ostream & os) const;
+
+private:
+  std::map<uint32_t, MessageKpi> m_messages;
+  MessageKpi m_run;        // histograms of all the messages
+  uint64_t m_nTargets;
+  uint64_t m_nReachedTargets;
+  uint64_t m_nTransmissions;
+
+  MessageKpi & GetOrCreate (uint32_t messageId);
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_KPI_H */
@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-link-solver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+namespace kdtm {
+
+void
+SolveLinkWindows (uint32_t n,
+                  double const * __restrict dx, double const * __restrict dy,
+                  double const * __restrict dvx, double const * __restrict dvy,
+                  double range, double time, double infinity,
+                  double * __restrict from, double * __restrict to)
+{
+  double range2 = range * range;
+  for (uint32_t k = 0; k < n; k++)
+    {
+      double a = dvx[k] * dvx[k] + dvy[k] * dvy[k];
+      double b = 2 * (dx[k] * dvx[k] + dy[k] * dvy[k]);
+      double c = dx[k] * dx[k] + dy[k] * dy[k] - range2;
+      double delta = b * b - 4 * a * c;
+
+      bool crossing = (a > 0) & (delta >= 0);
+      double root = std::sqrt (delta > 0 ? delta : 0);
+      double q = -0.5 * (b + std::copysign (root, b));
+      // Divisions are done on every lane, by safe values
+      double safeA = crossing ? a : 1;
+      double safeQ = q != 0 ? q : 1;
+      double r1 = q / safeA;
+      double r2 = c / safeQ;
+      // q = 0 only if b = 0 and delta = 0, the double root is then 0 = q / a
+      r2 = q != 0 ? r2 : r1;
+
+      double first = r1 < r2 ? r1 : r2;
+      double last = r1 < r2 ? r2 : r1;
+      first = crossing ? first : 0;
+      // Roots beyond the simulation are the infinity of a permanent link
+      last = std::min (crossing ? last : infinity, infinity);
+      first = std::min (first, infinity);
+      first = time + first < 0 ? -time : first;
+
+      from[k] = time + first;
+      to[k] = time + last;
+    }
+}
+
+void
+DeadReckon (uint32_t n,
+            double const * __restrict x, double const * __restrict y,
+            double const * __restrict vx, double const * __restrict vy,
+            double const * __restrict t,
+            double time, double * __restrict px, double * __restrict py)
+{
+  for (uint32_t k = 0; k < n; k++)
+    {
+      double dt = time - t[k];
+      px[k] = x[k] + vx[k] * dt;
+      py[k] = y[k] + vy[k] * dt;
+    }
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,60 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_LINK_SOLVER_H
+#define KDTM_LINK_SOLVER_H
+
+#include <stdint.h>
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Solves the link windows of n neighbors at once
+ *
+ * For neighbor k, (dx, dy) is the position of the node relative to the
+ * neighbor and (dvx, dvy) its relative velocity at time.  The link holds
+ * while the distance is below range, i.e. while
+ *
+ *   A t^2 + B t + C <= 0,  A = dv.dv,  B = 2 d.dv,  C = d.d - range^2
+ *
+ * and [from[k], to[k]] receives the absolute times of the two roots, with
+ * the semantics of PositionTable::AddEntry:
+ *  - equal velocities (A = 0) or no crossing (negative discriminant): the
+ *    link is taken as permanent, [time, time + infinity];
+ *  - otherwise the smaller root is from and the larger one to, both may
+ *    be in the past (the neighbor left) or in the future (it comes), and
+ *    both are capped at time + infinity (nearly parallel neighbors);
+ *  - from is never before the simulation start (0).
+ *
+ * The loop has no data dependent branch and uses the root formula free of
+ * cancellation: q = -(B + sign (B) sqrt (delta)) / 2, roots q / A and C / q.
+ * GCC only vectorizes it when it may assume that floating point operations
+ * do not trap, e.g. with CXXFLAGS="-O3 -fno-trapping-math -fno-math-errno";
+ * it is otherwise compiled as straight-line scalar code.
+ *
+ * The arrays may not overlap.  The function does not depend on ns-3, it can
+ * be used on any structure of arrays of kinematics.
+ */
+void SolveLinkWindows (uint32_t n,
+                       double const *dx, double const *dy,
+                       double const *dvx, double const *dvy,
+                       double range, double time, double infinity,
+                       double *from, double *to);
+
+/**
+ * \ingroup kdtm
+ * \brief Extrapolates the positions of n neighbors to time
+ *
+ * Neighbor k was at (x, y) with velocity (vx, vy) at t[k], times in
+ * seconds; (px, py) receives its position at time, x + vx (time - t[k]).
+ * The loop has no branch and vectorizes at -O3.  The arrays may not
+ * overlap.
+ */
+void DeadReckon (uint32_t n,
+                 double const *x, double const *y,
+                 double const *vx, double const *vy, double const *t,
+                 double time, double *px, double *py);
+
+} // kdtm
+} // ns3
+#endif /* KDTM_LINK_SOLVER_H */
@@ -0,0 +1,80 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-neighbor-summary.h"
+#include <algorithm>
+
+namespace ns3 {
+namespace kdtm {
+
+/// 64-bit finalizer of SplitMix64: every bit of id reaches every bit
+static uint64_t
+Mix (uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+const uint32_t NeighborSummary::N_HASHES;
+const uint32_t NeighborSummary::MAX_WORDS;
+
+NeighborSummary::NeighborSummary ()
+{
+}
+
+NeighborSummary::NeighborSummary (uint32_t nWords)
+  : m_words (std::min (nWords, MAX_WORDS), 0)
+{
+}
+
+uint32_t
+NeighborSummary::GetNWords (uint32_t nIds, uint32_t bitsPerId)
+{
+  uint64_t bits = (uint64_t) nIds * bitsPerId;
+  return std::max<uint64_t> (1, std::min<uint64_t> ((bits + 63) / 64, MAX_WORDS));
+}
+
+void
+NeighborSummary::Add (uint32_t id)
+{
+  uint32_t bits = 64 * m_words.size ();
+  if (bits == 0)
+    {
+      return;
+    }
+  // Bits h1 + k h2 of the two halves of the hash, h2 odd
+  uint64_t h = Mix (id);
+  uint32_t h1 = h & 0xffffffff;
+  uint32_t h2 = (h >> 32) | 1;
+  for (uint32_t k = 0; k < N_HASHES; k++)
+    {
+      uint32_t bit = (h1 + k * h2) % bits;
+      m_words[bit / 64] |= (uint64_t) 1 << (bit % 64);
+    }
+}
+
+bool
+NeighborSummary::MayContain (uint32_t id) const
+{
+  uint32_t bits = 64 * m_words.size ();
+  if (bits == 0)
+    {
+      return false;
+    }
+  uint64_t h = Mix (id);
+  uint32_t h1 = h & 0xffffffff;
+  uint32_t h2 = (h >> 32) | 1;
+  for (uint32_t k = 0; k < N_HASHES; k++)
+    {
+      uint32_t bit = (h1 + k * h2) % bits;
+      if (!(m_words[bit / 64] & ((uint64_t) 1 << (bit % 64))))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_NEIGHBOR_SUMMARY_H
+#define KDTM_NEIGHBOR_SUMMARY_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Bloom filter of the neighbor ids of a node
+ *
+ * A node advertises the neighbors of its PositionTable in a summary of a
+ * few 64-bit words; its neighbors keep it with its entry to know who it
+ * reaches.  Each id sets N_HASHES bits, so an id added is always found and
+ * an id not added is found with a probability of about
+ * (1 - exp (-N_HASHES n / bits))^N_HASHES for n ids: with 8 bits per id,
+ * 3%.  An empty summary (no word) contains nothing.
+ */
+class NeighborSummary
+{
+public:
+  /// Ids hashed in each summary
+  static const uint32_t N_HASHES = 3;
+  /// Largest summary, in words
+  static const uint32_t MAX_WORDS = 255;
+
+  /// c-tor, empty summary
+  NeighborSummary ();
+  /// Summary of nWords words, at most MAX_WORDS, with no id
+  explicit NeighborSummary (uint32_t nWords);
+
+  /// Words of a summary of nIds ids with bitsPerId bits each, at least one
+  static uint32_t GetNWords (uint32_t nIds, uint32_t bitsPerId);
+
+  void Add (uint32_t id);
+
+  /// \return false if id was not added, true if it was or on a false positive
+  bool MayContain (uint32_t id) const;
+
+  bool IsEmpty () const {
+    return m_words.empty ();
+  }
+
+  uint32_t GetNWords () const {
+    return m_words.size ();
+  }
+
+  uint64_t GetWord (uint32_t k) const {
+    return m_words[k];
+  }
+
+  void SetWord (uint32_t k, uint64_t word)
+  {
+    m_words[k] = word;
+  }
+
+  bool operator== (NeighborSummary const & other) const
+  {
+    return m_words == other.m_words;
+  }
+
+private:
+  std::vector<uint64_t> m_words;
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_NEIGHBOR_SUMMARY_H */
@@ -0,0 +1,656 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-neighbor-table.h"
+#include "kdtm-link-solver.h"
+#include <algorithm>
+#include <cmath>
+#include <list>
+
+// Duration of a link which never breaks, must be > to simulation time
+static const double g_linkInfinity = 500.0;
+
+namespace ns3 {
+namespace kdtm {
+
+NeighborTable::NeighborTable (double maxRange, CoreVector position, CoreVector velocity)
+  : m_clock (0),
+    m_positionSource (0),
+    m_entryLifeTime (SecondsToTableTime (25)), //FIXME fix parameter to hello message timer
+    m_txFailureLimit (3),
+    m_nTxFailures (0),
+    m_nEvictions (0),
+    m_myPosition (position),
+    m_myVelocity (velocity),
+    m_checkedPosition (position),
+    m_checkedVelocity (velocity),
+    m_checkedTime (0),
+    m_positionTolerance (1.0),
+    m_velocityTolerance (0.1),
+    m_maxRange (maxRange),
+    m_alpha (10.0),
+    m_poissonCoeff (std::make_pair (1, 300.0)),
+    m_trajectoryBegin (0),
+    m_version (0),
+    m_nUpdates (0),
+    m_nFastUpdates (0),
+    m_degreeEpsilon (0),
+    m_degreeIndexMaxTj (0),
+    m_degreeIndexVersion (-1)
+{
+  m_positionIndex.version = -1;
+  m_positionIndex.size = 0;
+}
+
+void
+NeighborTable::AddEntry (uint32_t id, CoreVector position, CoreVector velocity, TableTime now,
+                         double Betaj, TableTime tj)
+{
+  std::pair<std::map<uint32_t, NeighborEntry>::iterator, bool> i = m_table.insert (std::make_pair (id, NeighborEntry ()));
+  NeighborEntry & entry = i.first->second;
+  if (i.second)
+    {
+      // Nothing cached yet, a relative position out of reach forces the computation
+      entry.relPosition = CoreVector (1e30, 1e30, 0);
+      entry.reference = now;
+    }
+  else
+    {
+      m_nUpdates++;
+      // Periodic hello of a neighbor keeping its trend: the entry still
+      // predicts it, compared to the kinematics the entry is anchored on so
+      // that small drifts do not add up from hello to hello
+      double dt = TableTimeToSeconds (now - entry.time);
+      CoreVector predicted (entry.position.x + entry.velocity.x * dt,
+                            entry.position.y + entry.velocity.y * dt, 0);
+      if (entry.Betaj == Betaj && entry.tj == tj
+          && CoreDistance (predicted, position) <= m_positionTolerance
+          && CoreDistance (entry.velocity, velocity) <= m_velocityTolerance)
+        {
+          entry.heard = now;
+          entry.txFailures = 0;
+          m_nFastUpdates++;
+          return;
+        }
+    }
+
+  entry.position = position;
+  entry.velocity = velocity;
+  entry.time = now;
+  entry.heard = now;
+  entry.Betaj = Betaj;
+  entry.tj = tj;
+  entry.txFailures = 0;
+  UpdateLinkWindow (entry, now, position);
+  m_version++;
+}
+
+uint32_t
+NeighborTable::UpdateMyKinematics (TableTime now, CoreVector position, CoreVector velocity)
+{
+  m_myPosition = position;
+  m_myVelocity = velocity;
+
+  double dt = TableTimeToSeconds (now - m_checkedTime);
+  CoreVector expected (m_checkedPosition.x + m_checkedVelocity.x * dt,
+                       m_checkedPosition.y + m_checkedVelocity.y * dt, 0);
+  if (CoreDistance (expected, position) <= m_positionTolerance
+      && CoreDistance (m_checkedVelocity, velocity) <= m_velocityTolerance)
+    {
+      return 0;
+    }
+
+  m_checkedPosition = position;
+  m_checkedVelocity = velocity;
+  m_checkedTime = now;
+
+  // Gather the relative kinematics of the windows to recompute and solve
+  // them in one batch
+  m_batch.entries.clear ();
+  m_batch.dx.clear ();
+  m_batch.dy.clear ();
+  m_batch.dvx.clear ();
+  m_batch.dvy.clear ();
+  for (std::map<uint32_t, NeighborEntry>::iterator i = m_table.begin (); i != m_table.end (); i++)
+    {
+      NeighborEntry & entry = i->second;
+      double elapsed = TableTimeToSeconds (now - entry.time);
+      CoreVector relPosition (entry.position.x + entry.velocity.x * elapsed - position.x,
+                              entry.position.y + entry.velocity.y * elapsed - position.y, 0);
+      CoreVector relVelocity (entry.velocity.x - velocity.x, entry.velocity.y - velocity.y, 0);
+      if (!HasDrifted (entry, now, relPosition, relVelocity))
+        {
+          continue;
+        }
+      entry.relPosition = relPosition;
+      entry.relVelocity = relVelocity;
+      entry.reference = now;
+      m_batch.entries.push_back (&entry);
+      m_batch.dx.push_back (- relPosition.x);
+      m_batch.dy.push_back (- relPosition.y);
+      m_batch.dvx.push_back (- relVelocity.x);
+      m_batch.dvy.push_back (- relVelocity.y);
+    }
+
+  uint32_t n = m_batch.entries.size ();
+  if (n > 0)
+    {
+      m_batch.from.resize (n);
+      m_batch.to.resize (n);
+      SolveLinkWindows (n, &m_batch.dx[0], &m_batch.dy[0], &m_batch.dvx[0], &m_batch.dvy[0],
+                        m_maxRange, TableTimeToSeconds (now), g_linkInfinity,
+                        &m_batch.from[0], &m_batch.to[0]);
+      for (uint32_t k = 0; k < n; k++)
+        {
+          m_batch.entries[k]->from = SecondsToTableTime (m_batch.from[k]);
+          m_batch.entries[k]->to = SecondsToTableTime (m_batch.to[k]);
+        }
+      m_version++;
+    }
+  return n;
+}
+
+std::pair<TableTime, TableTime>
+NeighborTable::GetLinkWindow (uint32_t id) const
+{
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.find (id);
+  if (i == m_table.end ())
+    {
+      return std::make_pair (0, 0);
+    }
+  return std::make_pair (i->second.from, i->second.to);
+}
+
+void
+NeighborTable::DeleteEntry (uint32_t id)
+{
+  std::map<uint32_t, NeighborEntry>::iterator i = m_table.find (id);
+  if (i != m_table.end ())
+    {
+      m_table.erase (i);
+      m_version++;
+    }
+}
+
+CoreVector
+NeighborTable::GetPosition (uint32_t id) const
+{
+  CoreVector position;
+  if (m_positionSource && m_positionSource->GetPosition (id, position))
+    {
+      return position;
+    }
+
+  if (m_clock)
+    {
+      return GetPosition (id, m_clock->Now ());
+    }
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.find (id);
+  if (i != m_table.end ())
+    {
+      return GetPosition (id, i->second.heard);
+    }
+  return GetInvalidPosition ();
+}
+
+CoreVector
+NeighborTable::GetPosition (uint32_t id, TableTime time) const
+{
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.find (id);
+  if (i == m_table.end ())
+    {
+      return GetInvalidPosition ();
+    }
+  // As DeadReckon, for the same positions as GetPositions
+  NeighborEntry const & entry = i->second;
+  double dt = TableTimeToSeconds (time) - TableTimeToSeconds (entry.time);
+  return CoreVector (entry.position.x + entry.velocity.x * dt,
+                     entry.position.y + entry.velocity.y * dt, entry.position.z);
+}
+
+uint32_t
+NeighborTable::GetPositions (TableTime time, std::vector<uint32_t> & ids,
+                             std::vector<double> & x, std::vector<double> & y)
+{
+  UpdatePositionIndex ();
+  PositionIndex const & index = m_positionIndex;
+  uint32_t n = index.ids.size ();
+  ids = index.ids;
+  x.resize (n);
+  y.resize (n);
+  if (n > 0)
+    {
+      DeadReckon (n, &index.x[0], &index.y[0], &index.vx[0], &index.vy[0], &index.t[0],
+                  TableTimeToSeconds (time), &x[0], &y[0]);
+    }
+  return n;
+}
+
+bool
+NeighborTable::IsNeighbor (uint32_t id) const
+{
+  return m_table.find (id) != m_table.end ();
+}
+
+TableTime
+NeighborTable::GetEntryUpdateTime (uint32_t id) const
+{
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.find (id);
+  return i->second.to;
+}
+
+void
+NeighborTable::Purge ()
+{
+  if (m_table.empty () || !m_clock)
+    {
+      return;
+    }
+
+  std::list<uint32_t> toErase;
+  TableTime now = m_clock->Now ();
+  for (std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin (); i != m_table.end (); i++)
+    {
+      if (i->second.to <= now)
+        {
+          toErase.push_front (i->first);
+        }
+    }
+
+  for (std::list<uint32_t>::const_iterator it = toErase.begin (); it != toErase.end (); ++it)
+    {
+      // Not DeleteEntry: the end of the window was predicted, the version
+      // of the table does not change
+      m_table.erase (*it);
+    }
+}
+
+void
+NeighborTable::Clear ()
+{
+  m_table.clear ();
+  m_version++;
+}
+
+bool
+NeighborTable::ReportTxFailure (uint32_t id)
+{
+  std::map<uint32_t, NeighborEntry>::iterator i = m_table.find (id);
+  if (i == m_table.end ())
+    {
+      return false;
+    }
+  m_nTxFailures++;
+  i->second.txFailures++;
+  if (m_txFailureLimit == 0 || i->second.txFailures < m_txFailureLimit)
+    {
+      return false;
+    }
+  DeleteEntry (id);
+  m_nEvictions++;
+  return true;
+}
+
+void
+NeighborTable::ReportTxSuccess (uint32_t id)
+{
+  std::map<uint32_t, NeighborEntry>::iterator i = m_table.find (id);
+  if (i != m_table.end ())
+    {
+      i->second.txFailures = 0;
+    }
+}
+
+bool
+NeighborTable::IsSuspect (uint32_t id) const
+{
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.find (id);
+  return i != m_table.end () && i->second.txFailures > 0;
+}
+
+void
+NeighborTable::SetNeighborSummary (uint32_t id, NeighborSummary const & summary)
+{
+  std::map<uint32_t, NeighborEntry>::iterator i = m_table.find (id);
+  if (i != m_table.end ())
+    {
+      i->second.summary = summary;
+    }
+}
+
+NeighborSummary
+NeighborTable::CreateNeighborSummary (uint32_t bitsPerNeighbor)
+{
+  Purge ();
+  NeighborSummary summary (NeighborSummary::GetNWords (m_table.size (), bitsPerNeighbor));
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin ();
+  for (; i != m_table.end (); i++)
+    {
+      summary.Add (i->first);
+    }
+  return summary;
+}
+
+bool
+NeighborTable::AddsCoverage (std::vector<uint32_t> const & transmitters)
+{
+  Purge ();
+  std::vector<NeighborSummary const *> summaries;
+  for (uint32_t k = 0; k < transmitters.size (); k++)
+    {
+      std::map<uint32_t, NeighborEntry>::const_iterator t = m_table.find (transmitters[k]);
+      if (t != m_table.end () && !t->second.summary.IsEmpty ())
+        {
+          summaries.push_back (&t->second.summary);
+        }
+    }
+
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin ();
+  for (; i != m_table.end (); i++)
+    {
+      bool covered = std::find (transmitters.begin (), transmitters.end (), i->first) != transmitters.end ();
+      for (uint32_t k = 0; !covered && k < summaries.size (); k++)
+        {
+          covered = summaries[k]->MayContain (i->first);
+        }
+      if (!covered)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+double
+NeighborTable::CalculateDegree (double t)
+{
+  return CalculateDegreeWith (t, PoissonStability (), DoubleSigmoidDegree ());
+}
+
+double
+NeighborTable::CalculateDegree (double t, double & errorBound)
+{
+  return CalculateDegreeWith (t, PoissonStability (), DoubleSigmoidDegree (), errorBound);
+}
+
+double
+NeighborTable::CalculateThreshold (double t)
+{
+  return ExponentialThreshold () (CalculateDegree (t));
+}
+
+void
+NeighborTable::UpdateDegreeIndex ()
+{
+  if (m_degreeIndexVersion == m_version)
+    {
+      return;
+    }
+  m_degreeIndex.clear ();
+  m_degreeIndexMaxTj = - std::numeric_limits<double>::infinity ();
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin ();
+  for (; i != m_table.end (); i++)
+    {
+      DegreeTerm term;
+      term.from = TableTimeToSeconds (i->second.from);
+      term.to = TableTimeToSeconds (i->second.to);
+      term.tj = TableTimeToSeconds (i->second.tj);
+      term.Betaj = i->second.Betaj;
+      m_degreeIndex.push_back (term);
+      m_degreeIndexMaxTj = std::max (m_degreeIndexMaxTj, term.tj);
+    }
+  // Equal windows stay in the order of the ids
+  std::stable_sort (m_degreeIndex.begin (), m_degreeIndex.end ());
+  m_degreeIndexVersion = m_version;
+}
+
+void
+NeighborTable::UpdatePositionIndex ()
+{
+  PositionIndex & index = m_positionIndex;
+  if (index.version == m_version && index.size == m_table.size ())
+    {
+      return;
+    }
+  index.ids.clear ();
+  index.x.clear ();
+  index.y.clear ();
+  index.vx.clear ();
+  index.vy.clear ();
+  index.t.clear ();
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin ();
+  for (; i != m_table.end (); i++)
+    {
+      index.ids.push_back (i->first);
+      index.x.push_back (i->second.position.x);
+      index.y.push_back (i->second.position.y);
+      index.vx.push_back (i->second.velocity.x);
+      index.vy.push_back (i->second.velocity.y);
+      index.t.push_back (TableTimeToSeconds (i->second.time));
+    }
+  index.version = m_version;
+  index.size = m_table.size ();
+}
+
+void
+NeighborTable::Print (std::ostream & os)
+{
+  Purge ();
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin ();
+  for (; i != m_table.end (); i++)
+    {
+      os << "\n id : " << i->first
+         << " time arrived " << TableTimeToSeconds (i->second.from)
+         << " time before leave " << TableTimeToSeconds (i->second.to);
+    }
+}
+
+void
+NeighborTable::Save (std::ostream & os) const
+{
+  SnapshotWrite (os, m_entryLifeTime);
+  SnapshotWrite (os, m_myPosition);
+  SnapshotWrite (os, m_myVelocity);
+  SnapshotWrite (os, m_maxRange);
+  SnapshotWrite (os, m_alpha);
+  SnapshotWrite (os, m_poissonCoeff.first);
+  SnapshotWrite (os, m_poissonCoeff.second);
+  SnapshotWrite (os, m_trajectoryBegin);
+  SnapshotWrite (os, m_checkedPosition);
+  SnapshotWrite (os, m_checkedVelocity);
+  SnapshotWrite (os, m_checkedTime);
+  SnapshotWrite (os, m_positionTolerance);
+  SnapshotWrite (os, m_velocityTolerance);
+
+  uint32_t n = m_table.size ();
+  SnapshotWrite (os, n);
+  std::map<uint32_t, NeighborEntry>::const_iterator i = m_table.begin ();
+  for (; i != m_table.end (); i++)
+    {
+      NeighborEntry const & entry = i->second;
+      SnapshotWrite (os, i->first);
+      SnapshotWrite (os, entry.position);
+      SnapshotWrite (os, entry.velocity);
+      SnapshotWrite (os, entry.time);
+      SnapshotWrite (os, entry.heard);
+      SnapshotWrite (os, entry.from);
+      SnapshotWrite (os, entry.to);
+      SnapshotWrite (os, entry.Betaj);
+      SnapshotWrite (os, entry.tj);
+      SnapshotWrite (os, entry.relPosition);
+      SnapshotWrite (os, entry.relVelocity);
+      SnapshotWrite (os, entry.reference);
+    }
+}
+
+bool
+NeighborTable::Load (std::istream & is, TableTime shift)
+{
+  m_table.clear ();
+  m_version++;
+  uint32_t n;
+  if (!(SnapshotRead (is, m_entryLifeTime)
+        && SnapshotRead (is, m_myPosition)
+        && SnapshotRead (is, m_myVelocity)
+        && SnapshotRead (is, m_maxRange)
+        && SnapshotRead (is, m_alpha)
+        && SnapshotRead (is, m_poissonCoeff.first)
+        && SnapshotRead (is, m_poissonCoeff.second)
+        && SnapshotRead (is, m_trajectoryBegin)
+        && SnapshotRead (is, m_checkedPosition)
+        && SnapshotRead (is, m_checkedVelocity)
+        && SnapshotRead (is, m_checkedTime)
+        && SnapshotRead (is, m_positionTolerance)
+        && SnapshotRead (is, m_velocityTolerance)
+        && SnapshotRead (is, n)))
+    {
+      return false;
+    }
+  m_trajectoryBegin += shift;
+  m_checkedTime += shift;
+
+  for (uint32_t k = 0; k < n; k++)
+    {
+      uint32_t id;
+      NeighborEntry entry;
+      if (!(SnapshotRead (is, id)
+            && SnapshotRead (is, entry.position)
+            && SnapshotRead (is, entry.velocity)
+            && SnapshotRead (is, entry.time)
+            && SnapshotRead (is, entry.heard)
+            && SnapshotRead (is, entry.from)
+            && SnapshotRead (is, entry.to)
+            && SnapshotRead (is, entry.Betaj)
+            && SnapshotRead (is, entry.tj)
+            && SnapshotRead (is, entry.relPosition)
+            && SnapshotRead (is, entry.relVelocity)
+            && SnapshotRead (is, entry.reference)))
+        {
+          m_table.clear ();
+          return false;
+        }
+      entry.time += shift;
+      entry.heard += shift;
+      entry.from += shift;
+      entry.to += shift;
+      entry.tj += shift;
+      entry.reference += shift;
+      entry.txFailures = 0;
+      m_table.insert (std::make_pair (id, entry));
+    }
+  return true;
+}
+
+/// Calculate element Aij of equation Pij(t) = Aij*t^2 + Bij*t + Cij
+double
+NeighborTable::CalculateAij (CoreVector velocity) const
+{
+  double dvx = m_myVelocity.x - velocity.x;
+  double dvy = m_myVelocity.y - velocity.y;
+  return dvx * dvx + dvy * dvy;
+}
+
+/// Calculate element Bij of equation Pij(t) = Aij*t^2 + Bij*t + Cij
+double
+NeighborTable::CalculateBij (CoreVector position, CoreVector velocity) const
+{
+  return 2 * (m_myPosition.x - position.x) * (m_myVelocity.x - velocity.x)
+       + 2 * (m_myPosition.y - position.y) * (m_myVelocity.y - velocity.y);
+}
+
+/// Calculate element Cij of equation Pij(t) = Aij*t^2 + Bij*t + Cij
+double
+NeighborTable::CalculateCij (CoreVector position) const
+{
+  double dx = m_myPosition.x - position.x;
+  double dy = m_myPosition.y - position.y;
+  return dx * dx + dy * dy;
+}
+
+bool
+NeighborTable::HasDrifted (NeighborEntry const & entry, TableTime time,
+                           CoreVector relPosition, CoreVector relVelocity) const
+{
+  // Where the cached relative kinematics put the neighbor now
+  double dt = TableTimeToSeconds (time - entry.reference);
+  CoreVector predicted (entry.relPosition.x + entry.relVelocity.x * dt,
+                        entry.relPosition.y + entry.relVelocity.y * dt, 0);
+  return CoreDistance (predicted, relPosition) > m_positionTolerance
+         || CoreDistance (entry.relVelocity, relVelocity) > m_velocityTolerance;
+}
+
+bool
+NeighborTable::UpdateLinkWindow (NeighborEntry & entry, TableTime time, CoreVector position)
+{
+  CoreVector relPosition (position.x - m_myPosition.x, position.y - m_myPosition.y, 0);
+  CoreVector relVelocity (entry.velocity.x - m_myVelocity.x, entry.velocity.y - m_myVelocity.y, 0);
+
+  if (!HasDrifted (entry, time, relPosition, relVelocity))
+    {
+      return false;
+    }
+
+  std::pair<TableTime, TableTime> times_from_to = CalculateTimeFromTo (time, position, entry.velocity);
+  entry.from = times_from_to.first;
+  entry.to = times_from_to.second;
+  entry.relPosition = relPosition;
+  entry.relVelocity = relVelocity;
+  entry.reference = time;
+  return true;
+}
+
+/// Calculate neighbors time in and out. Solve the equation Pij(t) = 0
+std::pair<TableTime, TableTime>
+NeighborTable::CalculateTimeFromTo (TableTime time, CoreVector position, CoreVector velocity) const
+{
+  double now = TableTimeToSeconds (time);
+  double Aij = CalculateAij (velocity);
+  double Bij = CalculateBij (position, velocity);
+  double Cij = CalculateCij (position);
+
+  double from = 0;
+  double to = 0;
+
+  double infinity = g_linkInfinity;
+
+  // Same velocities (Bij is then 0 too): the distance does not change
+  if (Aij == 0)
+    {
+      return std::make_pair (time, time + SecondsToTableTime (infinity));
+    }
+
+  double delta = Bij * Bij - 4 * Aij * (Cij - m_maxRange * m_maxRange);
+
+  if (delta > 0)
+    {
+      // Aij > 0: the first root is the smaller one, both are in the
+      // future when the neighbor is not in range yet
+      double root = sqrt (delta);
+      from = (- Bij - root) / (2 * Aij);
+      to = (- Bij + root) / (2 * Aij);
+    }
+  if (delta == 0)
+    {
+      from = - Bij / (2 * Aij);
+      to = - Bij / (2 * Aij);
+    }
+  if (delta < 0)
+    {
+      from = 0;
+      to = infinity;
+    }
+
+  // As SolveLinkWindows, the roots of nearly parallel neighbors are capped
+  from = std::min (from, infinity);
+  to = std::min (to, infinity);
+
+  if (now + from < 0)
+    {
+      from = - now;
+    }
+
+  return std::make_pair (SecondsToTableTime (now + from),
+                         SecondsToTableTime (now + to));
+}
+
+} // kdtm
+} // ns3
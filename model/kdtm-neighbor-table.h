@@ -0,0 +1,448 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_NEIGHBOR_TABLE_H
+#define KDTM_NEIGHBOR_TABLE_H
+
+#include <stdint.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+#include "kdtm-core.h"
+#include "kdtm-policies.h"
+#include "kdtm-neighbor-summary.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtmCore
+ * \brief Neighbor of a NeighborTable
+ *
+ * The link window [from, to] is predicted from the relative kinematics of
+ * the two nodes; they are kept to tell whether a new hello or a change of
+ * the own kinematics moves the prediction.
+ */
+struct NeighborEntry
+{
+  CoreVector position;  // advertised by the last hello
+  CoreVector velocity;
+  TableTime time;       // time of the hello position and velocity are from
+  TableTime heard;      // time of the last hello
+  TableTime from;       // predicted time the link appears
+  TableTime to;         // predicted time the link breaks
+  double Betaj;
+  TableTime tj;
+  CoreVector relPosition;  // neighbor relative to the node when the window was computed
+  CoreVector relVelocity;
+  TableTime reference;  // time the window was computed
+  uint32_t txFailures;  // consecutive frames to the neighbor not acknowledged
+  NeighborSummary summary;  // neighbors of the neighbor, empty if not advertised
+};
+
+/**
+ * \ingroup kdtmCore
+ * \brief Neighbors of a node, their link windows and the kinetic degree
+ *
+ * The protocol core of PositionTable.  Times of events are TableTime, the
+ * time the degree is computed at is in seconds, as the windows it is
+ * compared to.  The entries whose window ended are purged at the time of
+ * the clock (SetClock); without a clock only DeleteEntry removes them.
+ *
+ * Link windows are cached: a hello or an own kinematics update only
+ * recomputes the window of a neighbor when the relative position drifted
+ * from its prediction by more than the position tolerance or the relative
+ * velocity changed by more than the velocity tolerance.
+ */
+class NeighborTable
+{
+public:
+  /// c-tor
+  NeighborTable (double maxRange = 0, CoreVector position = CoreVector (),
+                 CoreVector velocity = CoreVector ());
+
+  CoreClock const * GetClock () const {
+    return m_clock;
+  }
+
+  /// Set the clock the entries are purged at, not owned
+  void SetClock (CoreClock const *clock)
+  {
+    m_clock = clock;
+  }
+
+  /// Set the source of the positions GetPosition prefers to the hellos, not owned
+  void SetPositionSource (PositionSource const *source)
+  {
+    m_positionSource = source;
+  }
+
+  /**
+   * \brief Adds entry in the table or updates the entry already present
+   *
+   * The own kinematics must be those at time.  A hello of a known neighbor
+   * which moves as its entry predicts (within the position and velocity
+   * tolerances) with the same Betaj and tj only refreshes the time it was
+   * heard: the kinematics of the entry, its link window and the version of
+   * the table are kept.
+   */
+  void AddEntry (uint32_t id, CoreVector position, CoreVector velocity, TableTime time,
+                 double Betaj, TableTime tj);
+
+  /// Number of hellos of neighbors already in the table
+  uint64_t GetNUpdates () const {
+    return m_nUpdates;
+  }
+
+  /// Number of those hellos which only refreshed the entry
+  uint64_t GetNFastUpdates () const {
+    return m_nFastUpdates;
+  }
+
+  void DeleteEntry (uint32_t id);
+
+  /**
+   * \brief Updates the own kinematics
+   *
+   * When the node drifted from the kinematics the link windows were last
+   * checked with, the windows of all the neighbors are checked in one pass
+   * and those which moved are recomputed with the neighbor positions
+   * extrapolated to time.
+   * \return number of windows recomputed
+   */
+  uint32_t UpdateMyKinematics (TableTime time, CoreVector position, CoreVector velocity);
+
+  /// \return predicted link window of a neighbor, (0, 0) if unknown
+  std::pair<TableTime, TableTime> GetLinkWindow (uint32_t id) const;
+
+  /**
+   * \brief Position of a node now, from the position source if it knows
+   * it, else by dead reckoning (see GetPosition (id, time))
+   *
+   * Without a clock, the position at the last hello of the node.
+   * \return GetInvalidPosition () if the node is unknown
+   */
+  CoreVector GetPosition (uint32_t id) const;
+
+  /**
+   * \brief Position of a neighbor at time, extrapolated from the position
+   * and velocity of its entry
+   *
+   * The position source is not read.  A neighbor is found in the map of the
+   * table, the cost does not depend on the number of nodes.
+   * \return GetInvalidPosition () if the node is not in the table
+   */
+  CoreVector GetPosition (uint32_t id, TableTime time) const;
+
+  /**
+   * \brief Positions of all the neighbors at time, by dead reckoning
+   *
+   * The kinematics of the neighbors are kept as arrays, rebuilt when the
+   * table changes, and extrapolated in one loop (DeadReckon).  The
+   * positions are those of GetPosition (id, time).  Neighbors whose window
+   * ended are included until Purge.
+   * \param ids set to the ids of the neighbors, ascending
+   * \param x set to the positions of the neighbors, as ids
+   * \return number of neighbors
+   */
+  uint32_t GetPositions (TableTime time, std::vector<uint32_t> & ids,
+                         std::vector<double> & x, std::vector<double> & y);
+
+  static CoreVector GetInvalidPosition ()
+  {
+    return CoreVector (-1, -1, 0);
+  }
+
+  bool IsNeighbor (uint32_t id) const;
+
+  /// End of the link window of a neighbor, which must be in the table
+  TableTime GetEntryUpdateTime (uint32_t id) const;
+
+  /// Removes the entries whose window ended at the time of the clock
+  void Purge ();
+
+  void Clear ();
+
+  /// \see PositionTable::ReportTxFailure
+  bool ReportTxFailure (uint32_t id);
+  void ReportTxSuccess (uint32_t id);
+  bool IsSuspect (uint32_t id) const;
+
+  uint32_t GetTxFailureLimit () const {
+    return m_txFailureLimit;
+  }
+
+  void SetTxFailureLimit (uint32_t limit)
+  {
+    m_txFailureLimit = limit;
+  }
+
+  uint64_t GetNTxFailures () const {
+    return m_nTxFailures;
+  }
+
+  uint64_t GetNEvictions () const {
+    return m_nEvictions;
+  }
+
+  /// \see PositionTable::SetNeighborSummary
+  void SetNeighborSummary (uint32_t id, NeighborSummary const & summary);
+  NeighborSummary CreateNeighborSummary (uint32_t bitsPerNeighbor = 8);
+  /// \see PositionTable::AddsCoverage
+  bool AddsCoverage (std::vector<uint32_t> const & transmitters);
+
+  /// Kinetic degree with PoissonStability and DoubleSigmoidDegree at t (s)
+  double CalculateDegree (double t);
+  double CalculateDegree (double t, double & errorBound);
+  /// ExponentialThreshold of CalculateDegree
+  double CalculateThreshold (double t);
+
+  /// Kinetic degree with the given policies at t (s)
+  template <class StabilityPolicy, class DegreePolicy>
+  double CalculateDegreeWith (double t, StabilityPolicy const & stability, DegreePolicy const & degree);
+
+  /// \see PositionTable::CalculateDegreeWith
+  template <class StabilityPolicy, class DegreePolicy>
+  double CalculateDegreeWith (double t, StabilityPolicy const & stability, DegreePolicy const & degree,
+                              double & errorBound);
+
+  double GetMaxRange () const {
+    return m_maxRange;
+  }
+
+  void SetMaxRange (double maxRange)
+  {
+    m_maxRange = maxRange;
+    m_version++;
+  }
+
+  CoreVector GetMyPosition () const {
+    return m_myPosition;
+  }
+
+  void SetMyPosition (CoreVector position)
+  {
+    m_myPosition = position;
+  }
+
+  CoreVector GetMyVelocity () const {
+    return m_myVelocity;
+  }
+
+  void SetMyVelocity (CoreVector velocity)
+  {
+    m_myVelocity = velocity;
+  }
+
+  double GetPositionTolerance () const {
+    return m_positionTolerance;
+  }
+
+  void SetPositionTolerance (double tolerance)
+  {
+    m_positionTolerance = tolerance;
+  }
+
+  double GetVelocityTolerance () const {
+    return m_velocityTolerance;
+  }
+
+  void SetVelocityTolerance (double tolerance)
+  {
+    m_velocityTolerance = tolerance;
+  }
+
+  double GetPoissonCoeff () const {
+    return m_poissonCoeff.second;
+  }
+
+  void SetPoissonCoeff (double time)
+  {
+    m_poissonCoeff.second = (m_poissonCoeff.first * m_poissonCoeff.second + time) / (m_poissonCoeff.first + 1);
+    m_poissonCoeff.first++;
+    m_version++;
+  }
+
+  TableTime GetTrajectoryBegin () const {
+    return m_trajectoryBegin;
+  }
+
+  void SetTrajectoryBegin (TableTime time)
+  {
+    m_trajectoryBegin = time;
+    m_version++;
+  }
+
+  double GetAlpha () const {
+    return m_alpha;
+  }
+
+  void SetAlpha (double alpha)
+  {
+    m_alpha = alpha;
+    m_version++;
+  }
+
+  /// \see PositionTable::GetVersion
+  uint64_t GetVersion () const {
+    return m_version;
+  }
+
+  std::map<uint32_t, NeighborEntry> const & GetEntries () const {
+    return m_table;
+  }
+
+  double GetDegreeEpsilon () const {
+    return m_degreeEpsilon;
+  }
+
+  void SetDegreeEpsilon (double epsilon)
+  {
+    m_degreeEpsilon = epsilon;
+  }
+
+  /// Link windows of the entries, purged first
+  void Print (std::ostream & os);
+
+  /// \see PositionTable::Save
+  void Save (std::ostream & os) const;
+  /// \see PositionTable::Load
+  bool Load (std::istream & is, TableTime shift);
+
+private:
+  CoreClock const *m_clock;
+  PositionSource const *m_positionSource;
+  TableTime m_entryLifeTime;
+  //  map: node Id, entry
+  std::map<uint32_t, NeighborEntry> m_table;
+  uint32_t m_txFailureLimit;
+  uint64_t m_nTxFailures;
+  uint64_t m_nEvictions;
+
+  CoreVector m_myPosition;
+  CoreVector m_myVelocity;
+
+  /// Own kinematics the link windows were last checked with
+  //\{
+  CoreVector m_checkedPosition;
+  CoreVector m_checkedVelocity;
+  TableTime m_checkedTime;
+  //\}
+
+  double m_positionTolerance;
+  double m_velocityTolerance;
+
+  /// Link windows recomputed by UpdateMyKinematics, kept to reuse the storage
+  struct LinkWindowBatch
+  {
+    std::vector<NeighborEntry *> entries;
+    std::vector<double> dx, dy, dvx, dvy;  // node relative to the neighbor
+    std::vector<double> from, to;
+  } m_batch;
+
+  double m_maxRange;
+  double m_alpha;
+  std::pair<uint32_t, double> m_poissonCoeff;
+  TableTime m_trajectoryBegin;
+  uint64_t m_version;
+  uint64_t m_nUpdates;
+  uint64_t m_nFastUpdates;
+  double m_degreeEpsilon;
+
+  /// Terms of the kinetic degree, ascending beginning of window
+  struct DegreeTerm
+  {
+    double from, to, tj, Betaj;
+
+    bool operator< (DegreeTerm const & other) const
+    {
+      return from < other.from;
+    }
+  };
+  std::vector<DegreeTerm> m_degreeIndex;
+  double m_degreeIndexMaxTj;
+  uint64_t m_degreeIndexVersion;
+
+  /// Rebuilds m_degreeIndex if the table changed since it was built
+  void UpdateDegreeIndex ();
+
+  /// Kinematics of the entries as arrays, ascending id, for GetPositions
+  struct PositionIndex
+  {
+    std::vector<uint32_t> ids;
+    std::vector<double> x, y, vx, vy, t;
+    uint64_t version;
+    uint32_t size;   // a purge does not change the version
+  } m_positionIndex;
+
+  /// Rebuilds m_positionIndex if the table changed since it was built
+  void UpdatePositionIndex ();
+
+  /// Calucale link power equation Pij(t) = Aij*t^2 + Bij*t + Cij
+  double CalculateAij (CoreVector velocity) const;
+  double CalculateBij (CoreVector position, CoreVector velocity) const;
+  double CalculateCij (CoreVector position) const;
+
+  /// Calculate time tij(to) and tij(from)
+  std::pair<TableTime, TableTime> CalculateTimeFromTo (TableTime time, CoreVector position,
+                                                       CoreVector velocity) const;
+
+  /// \return true if the cached window of an entry no longer matches the
+  /// relative kinematics of the neighbor at time
+  bool HasDrifted (NeighborEntry const & entry, TableTime time,
+                   CoreVector relPosition, CoreVector relVelocity) const;
+
+  /**
+   * Recomputes the link window of an entry at time, from the neighbor
+   * position at that time, unless the cached window still holds.
+   * \return true if the window was recomputed
+   */
+  bool UpdateLinkWindow (NeighborEntry & entry, TableTime time, CoreVector position);
+};
+
+template <class StabilityPolicy, class DegreePolicy>
+double
+NeighborTable::CalculateDegreeWith (double t, StabilityPolicy const & stability, DegreePolicy const & degree)
+{
+  double errorBound;
+  return CalculateDegreeWith (t, stability, degree, errorBound);
+}
+
+template <class StabilityPolicy, class DegreePolicy>
+double
+NeighborTable::CalculateDegreeWith (double t, StabilityPolicy const & stability, DegreePolicy const & degree,
+                                    double & errorBound)
+{
+  Purge ();
+  UpdateDegreeIndex ();
+  double Betai = 1.0 / m_poissonCoeff.second;
+  double ti = TableTimeToSeconds (m_trajectoryBegin);
+
+  // Windows beginning after t + reach contribute at most epsilon each
+  double last = t + degree.Reach (m_degreeEpsilon, m_alpha);
+  if (m_degreeEpsilon <= 0 || t < ti || t < m_degreeIndexMaxTj)
+    {
+      last = std::numeric_limits<double>::infinity ();
+    }
+
+  double kinetic_degree = 0;
+  uint32_t k = 0;
+  uint32_t n = m_degreeIndex.size ();
+  for (; k < n && m_degreeIndex[k].from <= last; k++)
+    {
+      DegreeTerm const & term = m_degreeIndex[k];
+      // Neighbors are purged at the end of their window
+      if (term.to <= t)
+        {
+          continue;
+        }
+      kinetic_degree += stability (t, ti, Betai, term.tj, term.Betaj)
+        * degree (term.from, term.to, t, m_alpha);
+    }
+  errorBound = (n - k) * m_degreeEpsilon;
+  return kinetic_degree;
+}
+
+} // kdtm
+} // ns3
+#endif /* KDTM_NEIGHBOR_TABLE_H */
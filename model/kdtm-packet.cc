@@ -4,6 +4,7 @@
 #include "ns3/address-utils.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("KdtmPacket");
 
@@ -61,6 +62,10 @@ TypeHeader::Deserialize (Buffer::Iterator start)
 		{
 		case KDTM_HELLO:
 		case KDTM_WARNING:
+		case KDTM_WARNING_COMPACT:
+		case KDTM_WARNING_BATCH:
+		case KDTM_NEIGHBOR_STATE:
+		case KDTM_NEIGHBOR_SUMMARY:
 			{
 				m_type = (MessageType) type;
 				break;
@@ -88,6 +93,26 @@ TypeHeader::Print(std::ostream &os) const
 				os << "POSITION";
 				break;
 			}
+		case KDTM_WARNING_COMPACT:
+			{
+				os << "COMPACT_POSITION";
+				break;
+			}
+		case KDTM_WARNING_BATCH:
+			{
+				os << "POSITION_BATCH";
+				break;
+			}
+		case KDTM_NEIGHBOR_STATE:
+			{
+				os << "NEIGHBOR_STATE";
+				break;
+			}
+		case KDTM_NEIGHBOR_SUMMARY:
+			{
+				os << "NEIGHBOR_SUMMARY";
+				break;
+			}
 		default:
 			os << "UNKNOWN_TYPE";
 		}
@@ -147,7 +172,7 @@ HelloHeader::GetInstanceTypeId () const
 uint32_t
 HelloHeader::GetSerializedSize () const
 {
-  return 52;
+  return HELLO_SIZE;
 }
 
 void
@@ -161,13 +186,11 @@ HelloHeader::Serialize (Buffer::Iterator i) const
    							<< " Trajectory Begin Time " << m_trajectoryBegin
   							<< " Beta " << m_beta);
 
-  i.WriteHtonU32 (m_id);
-  i.WriteHtonU64 (m_originPosx);
-  i.WriteHtonU64 (m_originPosy);
-  i.WriteHtonU64 (m_speedx);
-  i.WriteHtonU64 (m_speedy);
-  i.WriteHtonU64 (m_trajectoryBegin);
-  i.WriteHtonU64 (m_beta);
+  HelloFields fields = { m_id, m_originPosx, m_originPosy, m_speedx, m_speedy,
+                         m_trajectoryBegin, m_beta };
+  uint8_t b[HELLO_SIZE];
+  EncodeHello (b, fields);
+  i.Write (b, HELLO_SIZE);
 }
 
 uint32_t
@@ -176,13 +199,17 @@ HelloHeader::Deserialize (Buffer::Iterator start)
 
   Buffer::Iterator i = start;
 
-  m_id = i.ReadNtohU32 ();
-  m_originPosx = i.ReadNtohU64 ();
-  m_originPosy = i.ReadNtohU64 ();
-  m_speedx = i.ReadNtohU64 ();
-  m_speedy = i.ReadNtohU64 ();
-  m_trajectoryBegin = i.ReadNtohU64 ();
-  m_beta = i.ReadNtohU64 ();
+  uint8_t b[HELLO_SIZE];
+  i.Read (b, HELLO_SIZE);
+  HelloFields fields;
+  DecodeHello (b, fields);
+  m_id = fields.id;
+  m_originPosx = fields.originPosx;
+  m_originPosy = fields.originPosy;
+  m_speedx = fields.speedx;
+  m_speedy = fields.speedy;
+  m_trajectoryBegin = fields.trajectoryBegin;
+  m_beta = fields.beta;
 
   NS_LOG_DEBUG ("Deserialize Id " << m_id 
   							<< " X " << m_originPosx 
@@ -264,7 +291,7 @@ WarningHeader::GetInstanceTypeId () const
 uint32_t 
 WarningHeader::GetSerializedSize () const
 {
-	return 32;
+	return WARNING_SIZE;
 }
 
 void 
@@ -272,12 +299,10 @@ WarningHeader::Serialize (Buffer::Iterator start) const
 {
 	NS_LOG_DEBUG ("Serialize Id " << m_sourceId << " MessageId " << m_messageId);
 
-  start.WriteHtonU32 (m_sourceId);
-  start.WriteHtonU32 (m_prevHopId);
-  start.WriteHtonU32 (m_hopCount);
-  start.WriteHtonU32 (m_messageId);
-  start.WriteHtonU64 (m_positionx);
-  start.WriteHtonU64 (m_positiony);
+  WarningFields fields = { m_sourceId, m_prevHopId, m_hopCount, m_messageId, m_positionx, m_positiony };
+  uint8_t b[WARNING_SIZE];
+  EncodeWarning (b, fields);
+  start.Write (b, WARNING_SIZE);
 }
 
 uint32_t 
@@ -285,12 +310,16 @@ WarningHeader::Deserialize (Buffer::Iterator start)
 {
 	Buffer::Iterator i = start;
 
-  m_sourceId = i.ReadNtohU32 ();
-  m_prevHopId = i.ReadNtohU32 ();
-	m_hopCount = i.ReadNtohU32 ();
-  m_messageId = i.ReadNtohU32 ();
-  m_positionx = i.ReadNtohU64 ();
-  m_positiony = i.ReadNtohU64 ();
+  uint8_t b[WARNING_SIZE];
+  i.Read (b, WARNING_SIZE);
+  WarningFields fields;
+  DecodeWarning (b, fields);
+  m_sourceId = fields.sourceId;
+  m_prevHopId = fields.prevHopId;
+  m_hopCount = fields.hopCount;
+  m_messageId = fields.messageId;
+  m_positionx = fields.positionx;
+  m_positiony = fields.positiony;
 
   NS_LOG_DEBUG ("Deserialize Id " << m_sourceId << " MessageId " << m_messageId);
 
@@ -306,5 +335,423 @@ WarningHeader::Print (std::ostream &os) const
 }
 
 
+//-----------------------------------------------------------------------------
+// CompactWarningHeader
+//-----------------------------------------------------------------------------
+
+CompactWarningHeader::CompactWarningHeader (uint32_t sourceId, uint32_t prevHopId, uint32_t hopCount,
+		uint32_t messageId, double positionx, double positiony)
+	: m_sourceId (sourceId),
+		m_prevHopId (prevHopId),
+		m_hopCount (hopCount > 255 ? 255 : hopCount),
+		m_messageId (messageId),
+		m_positionx (EncodeCompactPosition (positionx)),
+		m_positiony (EncodeCompactPosition (positiony)),
+		m_valid (true)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (CompactWarningHeader);
+
+TypeId
+CompactWarningHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::kdtm::CompactWarningHeader")
+    .SetParent<Header> ()
+    .AddConstructor<CompactWarningHeader> ()
+  ;
+  return tid;
+}
+
+TypeId 
+CompactWarningHeader::GetInstanceTypeId () const
+{
+	return GetTypeId ();
+}
+
+void
+CompactWarningHeader::SetPositionx (double positionx)
+{
+	m_positionx = EncodeCompactPosition (positionx);
+}
+
+void
+CompactWarningHeader::SetPositiony (double positiony)
+{
+	m_positiony = EncodeCompactPosition (positiony);
+}
+
+uint32_t 
+CompactWarningHeader::GetSerializedSize () const
+{
+	return VarintSize (m_sourceId) + VarintSize (m_prevHopId) + VarintSize (m_messageId) + 9;
+}
+
+void 
+CompactWarningHeader::Serialize (Buffer::Iterator start) const
+{
+	CompactWarningFields fields = { m_sourceId, m_prevHopId, m_messageId, m_hopCount,
+			m_positionx, m_positiony };
+	uint8_t b[MAX_SIZE];
+	uint32_t n = EncodeCompactWarning (b, fields);
+	start.Write (b, n);
+}
+
+uint32_t 
+CompactWarningHeader::Deserialize (Buffer::Iterator start)
+{
+	// The three varints byte by byte, then the hop count and the positions
+	Buffer::Iterator i = start;
+	uint8_t b[MAX_SIZE];
+	uint32_t n = 0;
+	for (int k = 0; k < 3; k++)
+		{
+			for (uint32_t shift = 0; shift < 35; shift += 7)
+				{
+					b[n] = i.ReadU8 ();
+					if (!(b[n++] & 0x80))
+						{
+							break;
+						}
+				}
+		}
+	i.Read (b + n, 9);
+	CompactWarningFields fields = CompactWarningFields ();
+	m_valid = DecodeCompactWarning (b, n + 9, fields) != 0;
+	if (!m_valid)
+		{
+			// A varint of more than 5 bytes, the fields are left as they were
+			return i.GetDistanceFrom (start);
+		}
+	m_sourceId = fields.sourceId;
+	m_prevHopId = fields.prevHopId;
+	m_messageId = fields.messageId;
+	m_hopCount = fields.hopCount;
+	m_positionx = fields.positionx;
+	m_positiony = fields.positiony;
+
+	return i.GetDistanceFrom (start);
+}
+
+void 
+CompactWarningHeader::Print (std::ostream &os) const
+{
+	os << " Id " << m_sourceId << " MessageId " << m_messageId;
+}
+
+//-----------------------------------------------------------------------------
+// WarningBatchHeader
+//-----------------------------------------------------------------------------
+WarningBatchHeader::WarningBatchHeader ()
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (WarningBatchHeader);
+
+TypeId
+WarningBatchHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::kdtm::WarningBatchHeader")
+    .SetParent<Header> ()
+    .AddConstructor<WarningBatchHeader> ()
+  ;
+  return tid;
+}
+
+TypeId 
+WarningBatchHeader::GetInstanceTypeId () const
+{
+	return GetTypeId ();
+}
+
+bool
+WarningBatchHeader::AddWarning (uint32_t size)
+{
+	if (m_sizes.size () >= MAX_WARNINGS || size > MAX_WARNING_SIZE)
+		{
+			return false;
+		}
+	m_sizes.push_back (size);
+	return true;
+}
+
+uint32_t 
+WarningBatchHeader::GetSerializedSize () const
+{
+	return 1 + m_sizes.size ();
+}
+
+void 
+WarningBatchHeader::Serialize (Buffer::Iterator start) const
+{
+	start.WriteU8 (m_sizes.size ());
+	for (uint32_t k = 0; k < m_sizes.size (); k++)
+		{
+			start.WriteU8 (m_sizes[k]);
+		}
+}
+
+uint32_t 
+WarningBatchHeader::Deserialize (Buffer::Iterator start)
+{
+	Buffer::Iterator i = start;
+	m_sizes.resize (i.ReadU8 ());
+	for (uint32_t k = 0; k < m_sizes.size (); k++)
+		{
+			m_sizes[k] = i.ReadU8 ();
+		}
+	return i.GetDistanceFrom (start);
+}
+
+void 
+WarningBatchHeader::Print (std::ostream &os) const
+{
+	os << " Warnings " << m_sizes.size ();
+}
+
+//-----------------------------------------------------------------------------
+// NeighborStateHeader
+//-----------------------------------------------------------------------------
+NeighborStateHeader::NeighborStateHeader (double speedx, double speedy, Time trajectoryBegin, double beta,
+		Vector position)
+	: m_speedx ((int32_t) std::floor (speedx * 1000 + 0.5)),
+		m_speedy ((int32_t) std::floor (speedy * 1000 + 0.5)),
+		m_trajectoryBegin (trajectoryBegin.GetNanoSeconds ()),
+		m_beta (beta),
+		m_positionx (EncodeCompactPosition (position.x)),
+		m_positiony (EncodeCompactPosition (position.y))
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (NeighborStateHeader);
+
+TypeId
+NeighborStateHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::kdtm::NeighborStateHeader")
+    .SetParent<Header> ()
+    .AddConstructor<NeighborStateHeader> ()
+  ;
+  return tid;
+}
+
+TypeId 
+NeighborStateHeader::GetInstanceTypeId () const
+{
+	return GetTypeId ();
+}
+
+uint32_t 
+NeighborStateHeader::GetSerializedSize () const
+{
+	return NEIGHBOR_STATE_SIZE;
+}
+
+void 
+NeighborStateHeader::Serialize (Buffer::Iterator start) const
+{
+	NeighborStateFields fields = { m_speedx, m_speedy, m_trajectoryBegin, m_beta, m_positionx, m_positiony };
+	uint8_t b[NEIGHBOR_STATE_SIZE];
+	EncodeNeighborState (b, fields);
+	start.Write (b, NEIGHBOR_STATE_SIZE);
+}
+
+uint32_t 
+NeighborStateHeader::Deserialize (Buffer::Iterator start)
+{
+	Buffer::Iterator i = start;
+	uint8_t b[NEIGHBOR_STATE_SIZE];
+	i.Read (b, NEIGHBOR_STATE_SIZE);
+	NeighborStateFields fields;
+	DecodeNeighborState (b, fields);
+	m_speedx = fields.speedx;
+	m_speedy = fields.speedy;
+	m_trajectoryBegin = fields.trajectoryBegin;
+	m_beta = fields.beta;
+	m_positionx = fields.positionx;
+	m_positiony = fields.positiony;
+
+	uint32_t dist = i.GetDistanceFrom (start);
+	NS_ASSERT (dist == GetSerializedSize ());
+	return dist;
+}
+
+void 
+NeighborStateHeader::Print (std::ostream &os) const
+{
+	os << " Speed X " << GetSpeedx ()
+		 << " Speed Y " << GetSpeedy ()
+		 << " Trajectory Begin Time " << m_trajectoryBegin
+		 << " Beta " << m_beta
+		 << " X " << GetPosition ().x
+		 << " Y " << GetPosition ().y;
+}
+
+//-----------------------------------------------------------------------------
+// NeighborSummaryHeader
+//-----------------------------------------------------------------------------
+NeighborSummaryHeader::NeighborSummaryHeader (NeighborSummary const & summary)
+	: m_summary (summary)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED (NeighborSummaryHeader);
+
+TypeId
+NeighborSummaryHeader::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::kdtm::NeighborSummaryHeader")
+    .SetParent<Header> ()
+    .AddConstructor<NeighborSummaryHeader> ()
+  ;
+  return tid;
+}
+
+TypeId 
+NeighborSummaryHeader::GetInstanceTypeId () const
+{
+	return GetTypeId ();
+}
+
+uint32_t 
+NeighborSummaryHeader::GetSerializedSize () const
+{
+	return NeighborSummarySize (m_summary);
+}
+
+void 
+NeighborSummaryHeader::Serialize (Buffer::Iterator start) const
+{
+	std::vector<uint8_t> b (NeighborSummarySize (m_summary));
+	EncodeNeighborSummary (&b[0], m_summary);
+	start.Write (&b[0], b.size ());
+}
+
+uint32_t 
+NeighborSummaryHeader::Deserialize (Buffer::Iterator start)
+{
+	Buffer::Iterator i = start;
+	std::vector<uint8_t> b (1 + 8 * NeighborSummary::MAX_WORDS);
+	b[0] = i.ReadU8 ();
+	i.Read (&b[1], 8 * b[0]);
+	DecodeNeighborSummary (&b[0], b.size (), m_summary);
+	return i.GetDistanceFrom (start);
+}
+
+void 
+NeighborSummaryHeader::Print (std::ostream &os) const
+{
+	os << " Summary words " << m_summary.GetNWords ();
+}
+
+Ptr<Packet>
+AggregateWarnings (std::vector<Ptr<Packet> > const & warnings)
+{
+	WarningBatchHeader batch;
+	Ptr<Packet> packet = Create<Packet> ();
+	for (uint32_t k = 0; k < warnings.size (); k++)
+		{
+			if (!batch.AddWarning (warnings[k]->GetSize ()))
+				{
+					return 0;
+				}
+			packet->AddAtEnd (warnings[k]);
+		}
+	packet->AddHeader (batch);
+	packet->AddHeader (TypeHeader (KDTM_WARNING_BATCH));
+	return packet;
+}
+
+bool
+SplitWarnings (Ptr<const Packet> packet, std::vector<Ptr<Packet> > & warnings)
+{
+	warnings.clear ();
+	Ptr<Packet> copy = packet->Copy ();
+	TypeHeader type (KDTM_HELLO);
+	if (copy->GetSize () < 2 || copy->RemoveHeader (type) == 0
+		|| !type.IsValid () || type.Get () != KDTM_WARNING_BATCH)
+		{
+			return false;
+		}
+	WarningBatchHeader batch;
+	copy->RemoveHeader (batch);
+
+	uint32_t offset = 0;
+	for (uint32_t k = 0; k < batch.GetNWarnings (); k++)
+		{
+			uint32_t size = batch.GetWarningSize (k);
+			if (offset + size > copy->GetSize ())
+				{
+					warnings.clear ();
+					return false;
+				}
+			warnings.push_back (copy->CreateFragment (offset, size));
+			offset += size;
+		}
+	return true;
+}
+
+Ptr<Packet>
+ForwardWarning (Ptr<const Packet> packet, uint32_t prevHopId, uint32_t hopCount,
+		uint64_t positionx, uint64_t positiony)
+{
+	static const uint32_t typeSize = 1;
+	uint8_t headers[typeSize + WARNING_SIZE];
+	if (packet->CopyData (headers, sizeof (headers)) != sizeof (headers)
+		|| headers[0] != KDTM_WARNING)
+		{
+			return 0;
+		}
+
+	uint8_t *warning = headers + typeSize;
+	PutU32 (warning + WarningHeader::PREV_HOP_OFFSET, prevHopId);
+	PutU32 (warning + WarningHeader::HOP_COUNT_OFFSET, hopCount);
+	PutU64 (warning + WarningHeader::POSITIONX_OFFSET, positionx);
+	PutU64 (warning + WarningHeader::POSITIONY_OFFSET, positiony);
+
+	Ptr<Packet> forward = Create<Packet> (headers, sizeof (headers));
+	if (packet->GetSize () > sizeof (headers))
+		{
+			// The payload is shared with the received packet
+			forward->AddAtEnd (packet->CreateFragment (sizeof (headers), packet->GetSize () - sizeof (headers)));
+		}
+	return forward;
+}
+
+Ptr<Packet>
+ForwardCompactWarning (Ptr<const Packet> packet, uint32_t prevHopId, uint32_t hopCount,
+		double positionx, double positiony)
+{
+	static const uint32_t typeSize = 1;
+	uint8_t headers[typeSize + CompactWarningHeader::MAX_SIZE];
+	uint32_t size = packet->CopyData (headers, sizeof (headers));
+	CompactWarningFields fields = CompactWarningFields ();
+	if (size <= typeSize || headers[0] != KDTM_WARNING_COMPACT)
+		{
+			return 0;
+		}
+	uint32_t received = DecodeCompactWarning (headers + typeSize, size - typeSize, fields);
+	if (received == 0)
+		{
+			return 0;
+		}
+	received += typeSize;
+
+	uint8_t forward[typeSize + CompactWarningHeader::MAX_SIZE];
+	forward[0] = KDTM_WARNING_COMPACT;
+	fields.prevHopId = prevHopId;
+	fields.hopCount = hopCount > 255 ? 255 : hopCount;
+	fields.positionx = EncodeCompactPosition (positionx);
+	fields.positiony = EncodeCompactPosition (positiony);
+	uint32_t n = typeSize + EncodeCompactWarning (forward + typeSize, fields);
+
+	Ptr<Packet> p = Create<Packet> (forward, n);
+	if (packet->GetSize () > received)
+		{
+			p->AddAtEnd (packet->CreateFragment (received, packet->GetSize () - received));
+		}
+	return p;
+}
+
 }
 }
\ No newline at end of file
@@ -9,7 +9,12 @@
 #include "ns3/enum.h"
 //#include "ns3/ipv4-address.h"
 #include <map>
+#include <vector>
 #include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "ns3/packet.h"
+#include "kdtm-neighbor-summary.h"
+#include "kdtm-codec.h"
 
 namespace ns3 
 {
@@ -20,7 +25,11 @@ namespace kdtm
 enum MessageType
 {
 	KDTM_HELLO = 1,
-	KDTM_WARNING = 2
+	KDTM_WARNING = 2,
+	KDTM_WARNING_COMPACT = 3, // CompactWarningHeader follows
+	KDTM_WARNING_BATCH = 4,   // WarningBatchHeader and its warnings follow
+	KDTM_NEIGHBOR_STATE = 5,  // NeighborStateHeader and a warning frame follow
+	KDTM_NEIGHBOR_SUMMARY = 6 // NeighborSummaryHeader and a hello frame follow
 };
 
 /**
@@ -245,6 +254,14 @@ public:
 		return m_positiony;
 	}	
 
+	///\name Offsets of the fields a forwarder changes, in network byte order
+	//\{
+	static const uint32_t PREV_HOP_OFFSET = 4;
+	static const uint32_t HOP_COUNT_OFFSET = 8;
+	static const uint32_t POSITIONX_OFFSET = 16;
+	static const uint32_t POSITIONY_OFFSET = 24;
+	//\}
+
 private:
 	uint32_t m_sourceId;	
 	uint32_t m_prevHopId;
@@ -254,6 +271,310 @@ private:
 	uint64_t m_positiony;
 };
 
+/**
+* \ingroup kdtm
+* \brief   Compact Warning Message Format, sent with type KDTM_WARNING_COMPACT
+  \verbatim
+  sourceId   varint, 1 to 5 bytes
+  prevHopId  varint
+  messageId  varint
+  hopCount   uint8, saturates at 255
+  positionx  int32, decimeters
+  positiony  int32, decimeters
+  \endverbatim
+*
+* Varints hold 7 bits per byte, least significant first, the high bit set on
+* all bytes but the last.  The header takes 12 to 24 bytes instead of the 32
+* of WarningHeader; positions keep a 0.1 m resolution over +-214 km.
+*/
+class CompactWarningHeader : public Header 
+{
+public:
+	/// c-tor
+	CompactWarningHeader (uint32_t sourceId = 0, 
+		uint32_t prevHopId = 0,
+		uint32_t hopCount = 0,
+		uint32_t messageId = 0,
+		double positionx = 0,
+		double positiony = 0);
+
+	///\name Header serialization/deserialization
+	//\{
+	static TypeId GetTypeId ();
+	TypeId GetInstanceTypeId () const;
+	uint32_t GetSerializedSize () const;
+	void Serialize (Buffer::Iterator start) const;
+	uint32_t Deserialize (Buffer::Iterator start);
+	void Print (std::ostream &os) const;
+	//\}
+
+	void SetSourceId (uint32_t sourceId) 
+	{
+		m_sourceId = sourceId;
+	}
+	uint32_t GetSourceId () const
+	{
+		return m_sourceId;
+	}
+	void SetPrevHopId (uint32_t prevHopId) 
+	{
+		m_prevHopId = prevHopId;
+	}
+	uint32_t GetPrevHopId () const
+	{
+		return m_prevHopId;
+	}
+	void SetHopCount (uint32_t hopCount) 
+	{
+		m_hopCount = hopCount > 255 ? 255 : hopCount;
+	}
+	uint32_t GetHopCount () const
+	{
+		return m_hopCount;
+	}
+	void SetMessageId (uint32_t messageId) 
+	{
+		m_messageId = messageId;
+	}
+	uint32_t GetMessageId () const
+	{
+		return m_messageId;
+	}
+	/// Position in m, rounded to the resolution of the header
+	void SetPositionx (double positionx);
+	double GetPositionx () const
+	{
+		return m_positionx * 0.1;
+	}
+	void SetPositiony (double positiony);
+	double GetPositiony () const
+	{
+		return m_positiony * 0.1;
+	}
+	/// False if the last Deserialize read a malformed varint
+	bool IsValid () const
+	{
+		return m_valid;
+	}
+
+	/// Largest serialized size
+	static const uint32_t MAX_SIZE = COMPACT_WARNING_MAX_SIZE;
+
+private:
+	uint32_t m_sourceId;
+	uint32_t m_prevHopId;
+	uint8_t m_hopCount;
+	uint32_t m_messageId;
+	int32_t m_positionx;  // dm
+	int32_t m_positiony;
+	bool m_valid;
+};
+
+/**
+* \ingroup kdtm
+* \brief   Warning Batch Message Format, sent with type KDTM_WARNING_BATCH
+  \verbatim
+  count      uint8, number of warnings
+  sizes      uint8 x count, size of each warning
+  \endverbatim
+*
+* The warnings follow, each one a complete warning frame (TypeHeader and
+* WarningHeader or CompactWarningHeader), see AggregateWarnings.
+*/
+class WarningBatchHeader : public Header 
+{
+public:
+	/// c-tor
+	WarningBatchHeader ();
+
+	///\name Header serialization/deserialization
+	//\{
+	static TypeId GetTypeId ();
+	TypeId GetInstanceTypeId () const;
+	uint32_t GetSerializedSize () const;
+	void Serialize (Buffer::Iterator start) const;
+	uint32_t Deserialize (Buffer::Iterator start);
+	void Print (std::ostream &os) const;
+	//\}
+
+	/// Adds a warning of size bytes, false if the batch is full
+	bool AddWarning (uint32_t size);
+
+	uint32_t GetNWarnings () const
+	{
+		return m_sizes.size ();
+	}
+	uint32_t GetWarningSize (uint32_t k) const
+	{
+		return m_sizes[k];
+	}
+
+	/// Largest number of warnings, and size of a warning, of a batch
+	static const uint32_t MAX_WARNINGS = 255;
+	static const uint32_t MAX_WARNING_SIZE = 255;
+
+private:
+	std::vector<uint8_t> m_sizes;
+};
+
+/**
+* \ingroup kdtm
+* \brief   Neighbor State Message Format, sent with type KDTM_NEIGHBOR_STATE
+  \verbatim
+  speedx           int32, mm/s
+  speedy           int32, mm/s
+  trajectoryBegin  int64, ns
+  beta             IEEE 754 double
+  positionx        int32, dm
+  positiony        int32, dm
+  \endverbatim
+*
+* The kinematics of a HelloHeader, put in front of a warning frame
+* (KDTM_WARNING, KDTM_WARNING_COMPACT or KDTM_WARNING_BATCH) by its sender.
+* The previous hop of the first warning of the frame completes them into a
+* hello.  The position is carried here, to the decimeter, because the one of
+* a full WarningHeader is in whole meters.  The trajectory begin and beta
+* are kept exactly, so that the entry of the sender is not seen as changed
+* from one hello to the next warning.
+*/
+class NeighborStateHeader : public Header 
+{
+public:
+	/// c-tor
+	NeighborStateHeader (double speedx = 0,
+		double speedy = 0,
+		Time trajectoryBegin = Time (0),
+		double beta = 0,
+		Vector position = Vector (0, 0, 0));
+
+	///\name Header serialization/deserialization
+	//\{
+	static TypeId GetTypeId ();
+	TypeId GetInstanceTypeId () const;
+	uint32_t GetSerializedSize () const;
+	void Serialize (Buffer::Iterator start) const;
+	uint32_t Deserialize (Buffer::Iterator start);
+	void Print (std::ostream &os) const;
+	//\}
+
+	/// Speed, m/s
+	double GetSpeedx () const
+	{
+		return m_speedx / 1000.0;
+	}
+	double GetSpeedy () const
+	{
+		return m_speedy / 1000.0;
+	}
+	Time GetTrajectoryBegin () const
+	{
+		return NanoSeconds (m_trajectoryBegin);
+	}
+	double GetBeta () const
+	{
+		return m_beta;
+	}
+	/// Position of the sender, 0.1 m resolution
+	Vector GetPosition () const
+	{
+		return Vector (m_positionx * 0.1, m_positiony * 0.1, 0);
+	}
+
+private:
+	int32_t m_speedx;
+	int32_t m_speedy;
+	int64_t m_trajectoryBegin;
+	double m_beta;
+	int32_t m_positionx;  // dm
+	int32_t m_positiony;
+};
+
+/**
+* \ingroup kdtm
+* \brief   Neighbor Summary Message Format, sent with type KDTM_NEIGHBOR_SUMMARY
+  \verbatim
+  nWords           uint8
+  words            uint64 x nWords
+  \endverbatim
+*
+* The NeighborSummary of the neighbors of the sender, put in front of its
+* hello frame.  Receivers keep it with the entry of the sender in their
+* PositionTable (SetNeighborSummary).
+*/
+class NeighborSummaryHeader : public Header 
+{
+public:
+	/// c-tor
+	NeighborSummaryHeader (NeighborSummary const & summary = NeighborSummary ());
+
+	///\name Header serialization/deserialization
+	//\{
+	static TypeId GetTypeId ();
+	TypeId GetInstanceTypeId () const;
+	uint32_t GetSerializedSize () const;
+	void Serialize (Buffer::Iterator start) const;
+	uint32_t Deserialize (Buffer::Iterator start);
+	void Print (std::ostream &os) const;
+	//\}
+
+	NeighborSummary const & GetSummary () const
+	{
+		return m_summary;
+	}
+
+private:
+	NeighborSummary m_summary;
+};
+
+/**
+* \ingroup kdtm
+* \brief Frame carrying several warnings
+*
+* \param warnings warning frames, at most WarningBatchHeader::MAX_WARNINGS
+* \return the batch, 0 if a warning is too large
+*/
+Ptr<Packet> AggregateWarnings (std::vector<Ptr<Packet> > const & warnings);
+
+/**
+* \ingroup kdtm
+* \brief Warning frames of a batch, as they were aggregated
+*
+* \param packet batch as received, starting with its TypeHeader
+* \param warnings replaced by the warnings of the batch
+* \return false if packet is not a batch or is truncated
+*/
+bool SplitWarnings (Ptr<const Packet> packet, std::vector<Ptr<Packet> > & warnings);
+
+/**
+* \ingroup kdtm
+* \brief Copy of a warning to rebroadcast
+*
+* Same bytes as removing the TypeHeader and WarningHeader of the received
+* warning, setting prevHopId, hopCount and the position and adding them
+* back, without deserializing and serializing the headers: the received
+* headers are copied in a single buffer and the four fields are patched at
+* their offsets.  The packet has no header metadata.
+*
+* \param packet warning as received, starting with its TypeHeader
+* \return the warning to send, 0 if packet is not a warning
+*/
+Ptr<Packet> ForwardWarning (Ptr<const Packet> packet, uint32_t prevHopId, uint32_t hopCount,
+		uint64_t positionx, uint64_t positiony);
+
+/**
+* \ingroup kdtm
+* \brief ForwardWarning for a compact warning
+*
+* The varint fields have no fixed offsets: the received headers are
+* decoded and encoded again in a local buffer, still without Header
+* objects.
+*
+* \param positionx position of the forwarder, m
+* \return the warning to send, 0 if packet is not a compact warning
+*/
+Ptr<Packet> ForwardCompactWarning (Ptr<const Packet> packet, uint32_t prevHopId, uint32_t hopCount,
+		double positionx, double positiony);
+
 }
 }
 
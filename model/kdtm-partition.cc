@@ -0,0 +1,81 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-partition.h"
+#include "ns3/log.h"
+#include <limits>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmPartition");
+
+namespace ns3 {
+namespace kdtm {
+
+SpatialPartition::SpatialPartition ()
+  : m_xMin (0),
+    m_xMax (0),
+    m_nRanks (1),
+    m_haloWidth (0)
+{
+  ResetExtent ();
+}
+
+SpatialPartition::SpatialPartition (double xMin, double xMax, uint32_t nRanks, double haloWidth)
+  : m_xMin (xMin),
+    m_xMax (xMax),
+    m_nRanks (nRanks > 0 ? nRanks : 1),
+    m_haloWidth (haloWidth)
+{
+  NS_LOG_INFO (" Kdtm partition of [" << xMin << ", " << xMax << "] in " << m_nRanks << " strips");
+  ResetExtent ();
+}
+
+uint32_t
+SpatialPartition::GetOwner (Vector position) const
+{
+  if (position.x <= m_xMin || m_xMax <= m_xMin)
+    {
+      return 0;
+    }
+  uint32_t rank = (uint32_t) ((position.x - m_xMin) / (m_xMax - m_xMin) * m_nRanks);
+  return rank < m_nRanks ? rank : m_nRanks - 1;
+}
+
+double
+SpatialPartition::GetStripBegin (uint32_t rank) const
+{
+  return m_xMin + (m_xMax - m_xMin) * rank / m_nRanks;
+}
+
+double
+SpatialPartition::GetStripEnd (uint32_t rank) const
+{
+  return m_xMin + (m_xMax - m_xMin) * (rank + 1) / m_nRanks;
+}
+
+void
+SpatialPartition::ResetExtent ()
+{
+  m_extentMin = std::numeric_limits<double>::max ();
+  m_extentMax = - std::numeric_limits<double>::max ();
+}
+
+void
+SpatialPartition::ExtendExtent (Vector position)
+{
+  if (position.x < m_extentMin)
+    {
+      m_extentMin = position.x;
+    }
+  if (position.x > m_extentMax)
+    {
+      m_extentMax = position.x;
+    }
+}
+
+bool
+SpatialPartition::IsInHalo (Vector position) const
+{
+  return m_extentMin - m_haloWidth <= position.x && position.x <= m_extentMax + m_haloWidth;
+}
+
+} // kdtm
+} // ns3
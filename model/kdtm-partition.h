@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_PARTITION_H
+#define KDTM_PARTITION_H
+
+#include <stdint.h>
+#include "ns3/vector.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/*
+ * \ingroup kdtm
+ * \brief Spatial partition of a road network across distributed simulation ranks
+ *
+ * The road is cut in strips of equal length along the x axis, strip i is
+ * simulated by rank i.  A vehicle is owned by the rank of the strip it is in
+ * when the scenario is built.
+ *
+ * Since vehicles move, the vehicles owned by a rank spread over time.  Each
+ * rank keeps the extent of the positions of its own vehicles; a remote
+ * vehicle inside this extent enlarged by the halo width is a ghost: its
+ * beacons must be delivered to the local vehicles even though its protocol
+ * state lives on another rank.
+ */
+class SpatialPartition
+{
+public:
+  /// c-tor
+  SpatialPartition ();
+  SpatialPartition (double xMin, double xMax, uint32_t nRanks, double haloWidth);
+
+  /**
+   * \brief Gets the rank owning a position
+   * \param position position to locate
+   * \return rank of the strip containing the position, positions out of
+   * the road belong to the first or last strip
+   */
+  uint32_t GetOwner (Vector position) const;
+
+  /// \return first abscissa of the strip of a rank
+  double GetStripBegin (uint32_t rank) const;
+
+  /// \return last abscissa of the strip of a rank
+  double GetStripEnd (uint32_t rank) const;
+
+  /**
+   * \brief Forgets the extent of the local vehicles
+   */
+  void ResetExtent ();
+
+  /**
+   * \brief Enlarges the extent of the local vehicles to contain a position
+   */
+  void ExtendExtent (Vector position);
+
+  /**
+   * \brief Checks if a position is close enough to the local vehicles for
+   * its beacons to be heard by them
+   * \param position position of a vehicle
+   * \return true if the position is inside the local extent enlarged by the
+   * halo width
+   */
+  bool IsInHalo (Vector position) const;
+
+  uint32_t GetNRanks () const {
+    return m_nRanks;
+  }
+
+  double GetHaloWidth () const {
+    return m_haloWidth;
+  }
+
+  void SetHaloWidth (double haloWidth)
+  {
+    m_haloWidth = haloWidth;
+  }
+
+private:
+  double m_xMin;
+  double m_xMax;
+  uint32_t m_nRanks;
+  double m_haloWidth;
+
+  double m_extentMin;
+  double m_extentMax;
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_PARTITION_H */
@@ -0,0 +1,146 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_POLICIES_H
+#define KDTM_POLICIES_H
+
+#include <cmath>
+#include <limits>
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \defgroup kdtmPolicies Kinetic degree models
+ *
+ * Policies of BasicPositionTable.  The kinetic degree of a node is
+ *
+ *   k(t) = sum over the neighbors j of stability (t, ti, Betai, tj, Betaj)
+ *                                    * degree (t_from, t_to, t, alpha)
+ *
+ * and the rebroadcast threshold is threshold (k(t)).  A stability policy
+ * weights a link by the probability that none of its ends changed its
+ * trajectory since the window was predicted, a degree policy gives the
+ * membership of t in the predicted link window [t_from, t_to], a threshold
+ * policy maps the kinetic degree to the distance-to-mean threshold.  The
+ * models are plain function objects so that the compiler inlines them in
+ * the degree loop.
+ *
+ * A degree policy also gives its Reach (epsilon, alpha): the time before
+ * t_from from which its value is at most epsilon, used to skip the
+ * negligible neighbors (PositionTable::SetDegreeEpsilon).  A stability
+ * policy must not exceed 1 after the trajectory beginnings ti and tj.
+ */
+
+/**
+ * \ingroup kdtmPolicies
+ * \brief Trajectory changes are Poisson processes of rates Betai and Betaj
+ *
+ * pij(t) = exp (-(Betai + Betaj) * (t - (ti*Betai + tj*Betaj) / (Betai + Betaj)))
+ */
+struct PoissonStability
+{
+  double operator() (double t, double ti, double Betai, double tj, double Betaj) const
+  {
+    if (Betaj == 0.0 && Betai == 0.0)
+      {
+        return 1;
+      }
+    return std::exp (-(Betai + Betaj) * (t - ((ti * Betai + tj * Betaj) / (Betai + Betaj))));
+  }
+};
+
+/**
+ * \ingroup kdtmPolicies
+ * \brief Predicted links always hold, the degree is purely geometric
+ */
+struct UnitStability
+{
+  double operator() (double /* t */, double /* ti */, double /* Betai */, double /* tj */,
+                     double /* Betaj */) const
+  {
+    return 1;
+  }
+};
+
+/**
+ * \ingroup kdtmPolicies
+ * \brief Double sigmoid of steepness alpha around the link window
+ */
+struct DoubleSigmoidDegree
+{
+  double operator() (double from, double to, double t, double alpha) const
+  {
+    return (1.0 / (1.0 + std::exp (- alpha * (t - from)))) * (1.0 / (1.0 + std::exp (alpha * (t - to))));
+  }
+
+  /// Time before the window after which the degree is at most epsilon:
+  /// the rising sigmoid alone is below epsilon there
+  double Reach (double epsilon, double alpha) const
+  {
+    if (epsilon <= 0 || alpha <= 0)
+      {
+        return std::numeric_limits<double>::infinity ();
+      }
+    return epsilon >= 0.5 ? 0 : std::log (1.0 / epsilon - 1.0) / alpha;
+  }
+};
+
+/**
+ * \ingroup kdtmPolicies
+ * \brief 1 inside the link window, 0 outside: the limit of the double
+ * sigmoid for an infinite alpha
+ */
+struct WindowDegree
+{
+  double operator() (double from, double to, double t, double /* alpha */) const
+  {
+    return (from <= t && t <= to) ? 1 : 0;
+  }
+
+  double Reach (double /* epsilon */, double /* alpha */) const
+  {
+    return 0;
+  }
+};
+
+/**
+ * \ingroup kdtmPolicies
+ * \brief Threshold a - b * exp (-c * k), 0.80 - 0.95 * exp (-0.06 * k) by default
+ */
+struct ExponentialThreshold
+{
+  ExponentialThreshold (double a = 0.80, double b = 0.95, double c = 0.06)
+    : a (a), b (b), c (c)
+  {
+  }
+
+  double operator() (double kineticDegree) const
+  {
+    return a - b * std::exp (- c * kineticDegree);
+  }
+
+  double a, b, c;
+};
+
+/**
+ * \ingroup kdtmPolicies
+ * \brief Fixed distance-to-mean threshold, whatever the degree
+ */
+struct ConstantThreshold
+{
+  ConstantThreshold (double value = 0.3)
+    : value (value)
+  {
+  }
+
+  double operator() (double /* kineticDegree */) const
+  {
+    return value;
+  }
+
+  double value;
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_POLICIES_H */
@@ -1,8 +1,6 @@
 #include "kdtm-ptable.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
-#include <algorithm>
-#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("KdtmTable");
 
@@ -10,167 +8,138 @@ NS_LOG_COMPONENT_DEFINE ("KdtmTable");
 namespace ns3 {
 namespace kdtm {
 
+TableTime
+SimulatorClock::Now () const
+{
+  return ToTableTime (Simulator::Now ());
+}
+
+SimulatorClock const *
+SimulatorClock::Get ()
+{
+  static SimulatorClock clock;
+  return &clock;
+}
+
+bool
+MobilityPositionSource::GetPosition (uint32_t id, CoreVector & position) const
+{
+  // node ids are indexes in the NodeList
+  if (id < NodeList::GetNNodes ())
+    {
+      Ptr<Node> node = NodeList::GetNode (id);
+      if (node->GetSystemId () == m_systemId)
+        {
+          position = ToCoreVector (node->GetObject<MobilityModel> ()->GetPosition ());
+          return true;
+        }
+    }
+  return false;
+}
+
 /*
   kdtm position table
 */
 PositionTable::PositionTable ()
 {
+  m_core.SetClock (SimulatorClock::Get ());
 }
 
 PositionTable::PositionTable (double maxRange, Vector position, Vector velocity)
+  : m_core (maxRange, ToCoreVector (position), ToCoreVector (velocity))
 {
   NS_LOG_INFO (" Kdtm table constructor ");
 
+  m_core.SetClock (SimulatorClock::Get ());
   m_txErrorCallback = MakeCallback (&PositionTable::ProcessTxError, this);
-  m_entryLifeTime = Seconds (25); //FIXME fix parameter to hello message timer
-  
-  m_maxRange = maxRange;
-
-  m_myPosition = position;
-  m_myVelocity = velocity;
-
-  m_poissonCoeff = std::make_pair(1,300.0);
-
-  m_alpha = 10.0;
 }
 
-/**
- * \brief Adds entry in position table and delete earlier entry if already present
- */
-void 
-PositionTable::AddEntry (uint32_t id, Vector position, Vector velocity, Time time, double Betaj, Time tj)
+void
+PositionTable::UpdateMyKinematics (Time time, Vector position, Vector velocity)
 {
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time> >::iterator i = m_table.find (id);
-  if (i != m_table.end () || id == (i->first))
+  uint32_t n = m_core.UpdateMyKinematics (ToTableTime (time), ToCoreVector (position),
+                                          ToCoreVector (velocity));
+  if (n > 0)
     {
-      m_table.erase (id);
+      NS_LOG_INFO (" Own kinematics changed, " << n << " of " << m_core.GetEntries ().size ()
+                   << " link windows recomputed");
     }
-
-  std::pair<Time, Time> times_from_to = CalculateTimeFromTo (time, position, velocity);
-
-  m_table.insert (std::make_pair (id, 
-                        std::make_tuple (position, 
-                          velocity, 
-                          times_from_to.first, 
-                          times_from_to.second,
-                          Betaj,
-                          tj)));
-
 }
 
 /**
- * \brief Deletes entry in position table
+ * \brief clears all entries
  */
 void 
-PositionTable::DeleteEntry (uint32_t id)
+PositionTable::Clear ()
 {
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time> >::iterator i = m_table.find (id);
-  if (i != m_table.end ())
-    {
-        m_table.erase (id);
-    }
+  m_core.Clear ();
+  m_addresses.clear ();
 }
 
-/**
- * \brief Gets position from position table
- * \param id uint32_t to get position from
- * \return Position of that id or NULL if not known
- */
-Vector 
-PositionTable::GetPosition (uint32_t id)
+void
+PositionTable::SetNeighborAddress (uint32_t id, Mac48Address address)
 {
-
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+  m_addresses[address] = id;
+  if (m_addresses.size () > 2 * m_core.GetEntries ().size () + 1)
     {
-      Ptr<Node> node = *i;
-      if (node->GetId () == id)
-        {
-          return node->GetObject<MobilityModel> ()->GetPosition ();
-        }
+      PurgeAddresses ();
     }
-  return PositionTable::GetInvalidPosition ();
-
 }
 
-/**
- * \brief Checks if a node is a neighbour
- * \param id uint32_t of the node to check
- * \return True if the node is neighbour, false otherwise
- */
-bool
-PositionTable::isNeighbour (uint32_t id)
+void
+PositionTable::PurgeAddresses ()
 {
-
- std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time> >::iterator i = m_table.find (id);
-  if (i != m_table.end () || id == (i->first))
+  std::map<Mac48Address, uint32_t>::iterator i = m_addresses.begin ();
+  while (i != m_addresses.end ())
     {
-      return true;
+      if (m_core.IsNeighbor (i->second))
+        {
+          i++;
+        }
+      else
+        {
+          m_addresses.erase (i++);
+        }
     }
-
-  return false;
-}
-
-Time 
-PositionTable::GetEntryUpdateTime (uint32_t id)
-{
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time> >::iterator i = m_table.find (id);
-  return std::get<3> (i->second);
 }
 
 /**
- * \brief remove entries with expired lifetime
+ * \ProcessTxError
  */
 void 
-PositionTable::Purge ()
+PositionTable::ProcessTxError (WifiMacHeader const & hdr)
 {
-
-  if(m_table.empty ())
+  // Broadcasts are not acknowledged, a failure is to a single receiver
+  Mac48Address address = hdr.GetAddr1 ();
+  std::map<Mac48Address, uint32_t>::iterator i = m_addresses.find (address);
+  if (address.IsGroup () || i == m_addresses.end ())
     {
       return;
     }
-
-  std::list<uint32_t> toErase;
-
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time> >::iterator i = m_table.begin ();
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time> >::iterator listEnd = m_table.end ();
-  
-  for (; !(i == listEnd); i++)
+  // The neighbor left the table, its address is of no more use
+  if (!m_core.IsNeighbor (i->second))
     {
-
-      if (GetEntryUpdateTime (i->first) <= Simulator::Now ())
-        {
-          toErase.insert (toErase.begin (), i->first);
-
-        }
-    }
-  toErase.unique ();
-
-  std::list<uint32_t>::iterator end = toErase.end ();
-
-  for (std::list<uint32_t>::iterator it = toErase.begin (); it != end; ++it)
-    {
-
-      //m_table.erase (*it);
-      PositionTable::DeleteEntry (*it);
+      m_addresses.erase (i);
+      return;
     }
+  ReportTxFailure (i->second);
 }
 
-/**
- * \brief clears all entries
- */
-void 
-PositionTable::Clear ()
-{
-  m_table.clear ();
-}
-
-/**
- * \ProcessTxError
- */
-void 
-PositionTable::ProcessTxError (WifiMacHeader const & hdr) /// FIXME complete this function
+bool
+PositionTable::ReportTxFailure (uint32_t id)
 {
+  uint64_t failures = m_core.GetNTxFailures ();
+  bool evicted = m_core.ReportTxFailure (id);
+  if (evicted)
+    {
+      NS_LOG_INFO (" Neighbor " << id << " evicted after " << m_core.GetTxFailureLimit () << " TX failures");
+    }
+  else if (m_core.GetNTxFailures () != failures)
+    {
+      NS_LOG_INFO (" Neighbor " << id << " suspect after "
+                   << m_core.GetEntries ().find (id)->second.txFailures << " TX failures");
+    }
+  return evicted;
 }
 
 /**
@@ -188,205 +157,30 @@ PositionTable::HasPosition (uint32_t id)
   return true;
 }
 
-/**
- * Calculate Threshold based on Distance To Mean method and Kinetic graph method
- */
-double 
-PositionTable::CalculateThreshold (Time time) 
-{
-  double kinetic_degree = CalculateDegree (time);
-
-  return 0.80 - 0.95 * exp(-0.06 * kinetic_degree);
-  //return kinetic_degree;
-
-}
-
 double 
 PositionTable::CalculateDegree (Time time)
 {
-  Purge ();
-  if (m_table.empty ())
-    {
-      return 0;
-    }
-  double stability;
-  double degree;
-
-  double kinetic_degree = 0;
-
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time>>::const_iterator i = m_table.begin ();
-  for (; i != m_table.end (); i++)
-    {
-      stability = CalculateStability (time.GetSeconds (), 
-                                      std::get<4> (i->second), 
-                                      std::get<5> (i->second).GetSeconds ());
-
-      NS_LOG_INFO (" Time: " << time
-        << " Beta i: " << 1/m_poissonCoeff.second
-        << " Beta j: " << std::get<4> (i->second)
-        << " ti: " << m_trajectoryBegin
-        << " tj: " << std::get<5> (i->second)
-        << " Stability: " << stability);
-
-      degree = CalculateDoubleSigmoid (std::get<2> (i->second).GetSeconds (),
-                                       std::get<3> (i->second).GetSeconds (),
-                                       time.GetSeconds ());
+  double kinetic_degree = m_core.CalculateDegree (time.GetSeconds ());
 
-      NS_LOG_INFO (" Degree: " << degree);
-
-      kinetic_degree += stability * degree;
-    }
-
-  NS_LOG_INFO (" Kinetic Degree: " << kinetic_degree);
+  NS_LOG_INFO (" Time: " << time
+    << " Beta i: " << 1/m_core.GetPoissonCoeff ()
+    << " ti: " << GetTrajectoryBegin ()
+    << " Kinetic Degree: " << kinetic_degree);
 
   return kinetic_degree;
 }
 
-
-void 
-PositionTable::Print (std::ostream & os)
+bool
+PositionTable::Load (std::istream & is, Time shift)
 {
-  Purge ();
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time>>::const_iterator i = m_table.begin ();
-  while (i != m_table.end ())
+  if (!m_core.Load (is, ToTableTime (shift)))
     {
-      os << "\n id : " << i->first 
-      << " time arrived " << std::get<2> (i->second).GetSeconds ()
-      << " time before leave " << std::get<3> (i->second).GetSeconds ();
-      i++;
+      return false;
     }
+  NS_LOG_INFO (" Kdtm table restored with " << m_core.GetEntries ().size () << " entries");
+  return true;
 }
 
-// Private functions
-//{
-
-
-/// Calculate element Aij of equation Pij(t) = Aij*t^2 + Bij*t + Cij
-double 
-PositionTable::CalculateAij (Vector velocity)
-{
-  return pow (m_myVelocity.x - velocity.x, 2) + pow (m_myVelocity.y - velocity.y, 2);  
-}
-
-/// Calculate element Bij of equation Pij(t) = Aij*t^2 + Bij*t + Cij
-double 
-PositionTable::CalculateBij (Vector position, Vector velocity)
-{
-  return 2 * (m_myPosition.x - position.x) * (m_myVelocity.x - velocity.x) 
-       + 2 * (m_myPosition.y - position.y) * (m_myVelocity.y - velocity.y);
-}
-
-/// Calculate element Cij of equation Pij(t) = Aij*t^2 + Bij*t + Cij
-double 
-PositionTable::CalculateCij (Vector position)
-{
-  return pow (m_myPosition.x - position.x, 2) + pow (m_myPosition.y - position.y, 2);
-}
-
-/// Calculate neighbors time in and out. Solve the equation Pij(t) = 0
-std::pair<Time, Time> 
-PositionTable::CalculateTimeFromTo (Time time, Vector position, Vector velocity)
-{
-  double Aij = CalculateAij (velocity);
-  double Bij = CalculateBij (position, velocity);
-  double Cij = CalculateCij (position);
-
-  double from;
-  double to;
-
-  // Time infinity must be > to simulation time
-  double infinity =  500.0;
-
-  if (Aij == 0) 
-    {
-      if (Bij == 0)
-        {
-          //NS_LOG_INFO (" Aij: " << Aij << " Bij: " << Bij << " Cij: " << Cij);
-          //NS_LOG_INFO (" Time from: " << Seconds (0.0) << " Time to: " << Seconds (500));
-
-          return std::make_pair (time, Seconds (infinity));
-        }
-
-      from = - (Cij - pow (m_maxRange, 2)) / Bij;
-      to = - (Cij - pow (m_maxRange, 2)) / Bij;
-
-      //NS_LOG_INFO (" Aij: " << Aij << " Bij: " << Bij << " Cij: " << Cij);
-      //NS_LOG_INFO (" Time from: " << from << " Time to: " << to);
-
-      NS_LOG_INFO ("aij = bij = 0, t_from " <<  (time.GetSeconds () + from) 
-        << " t_to " <<  (time.GetSeconds () + to));
-
-      return std::make_pair (time + Seconds (from), time + Seconds (to));
-    }
-
-  double delta = pow (Bij, 2) - 4 * Aij * (Cij - pow(m_maxRange, 2));
-
-  if (delta > 0)
-    {
-      from = (- Bij - sqrt (delta)) / (2 * Aij);
-      if (from > 0)
-        {
-          to = from;
-          from = (- Bij + sqrt (delta)) / (2 * Aij);
-        }
-      else 
-        {
-          to = (- Bij + sqrt (delta)) / (2 * Aij);
-        }
-    }
-  if (delta == 0)
-    {
-      from = - Bij / (2 * Aij);
-      to = - Bij / (2 * Aij);
-
-    }
-  if (delta < 0)
-    {
-      from = 0;
-      to = infinity;
-    }
-
-  if (time.GetSeconds () + from < 0)
-    {
-      from = -(time.GetSeconds ());
-    }
-
-    NS_LOG_INFO (" t_from " << (time.GetSeconds () + from) 
-      << " t_to " << (time.GetSeconds () + to));
-
-  return std::make_pair (Seconds (time.GetSeconds () + from), 
-                         Seconds (time.GetSeconds () + to));
-}
-
-
-/// Calculate double Sigmoid of liason ij with time (t_to and t_from)
-double 
-PositionTable::CalculateDoubleSigmoid (double t_from, double t_to, double t)
-{
-  return (1.0 / (1.0 + exp (- m_alpha * (t - t_from)))) * (1.0 / (1.0 + exp (m_alpha * (t - t_to))));
-}
-
-/** Calculate stability coefficient of liason ij, pij(t):
- *  pij(t)= exp (-(Betai + Betaj)*(t - (ti*Betai + tj*Betaj)/(Betai + Betaj)))
- */
-double
-PositionTable::CalculateStability (double time, double tj, double Betaj)
-{
-  double Betai = 1.0 / m_poissonCoeff.second;
-  double ti = m_trajectoryBegin.GetSeconds ();
-
-  if (Betaj == 0.0 && Betai == 0.0)
-    {
-      return 1;
-    } 
-
-  NS_LOG_INFO (" Betai + Betaj: " << Betai);
-
-  return exp (-(Betai + Betaj)*(time - ((ti*Betai + tj*Betaj)/(Betai + Betaj))));
-}
-
-//}
-
 /// Opreators
 //{
 
@@ -2,6 +2,8 @@
 #define KDTM_PTABLE_H
 
 #include <map>
+#include <limits>
+#include <vector>
 #include <cassert>
 #include <stdint.h>
 #include "ns3/ipv4.h"
@@ -14,13 +16,93 @@
 #include "ns3/wifi-mac-header.h"
 #include "ns3/random-variable-stream.h"
 #include <complex>
+#include <cmath>
+#include "kdtm-core.h"
+#include "kdtm-policies.h"
+#include "kdtm-neighbor-summary.h"
+#include "kdtm-neighbor-table.h"
 
 namespace ns3 {
 namespace kdtm {
 
+/// \return time of the core, TableTime, of a simulator time
+inline TableTime
+ToTableTime (Time time)
+{
+  return time.GetNanoSeconds ();
+}
+
+inline Time
+FromTableTime (TableTime time)
+{
+  return NanoSeconds (time);
+}
+
+inline CoreVector
+ToCoreVector (Vector vector)
+{
+  return CoreVector (vector.x, vector.y, vector.z);
+}
+
+inline Vector
+FromCoreVector (CoreVector vector)
+{
+  return Vector (vector.x, vector.y, vector.z);
+}
+
+/**
+ * \ingroup kdtm
+ * \brief Clock of the core reading Simulator::Now
+ */
+class SimulatorClock : public CoreClock
+{
+public:
+  virtual TableTime Now () const;
+
+  /// The clock shared by all the tables
+  static SimulatorClock const * Get ();
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Positions of the nodes simulated by a rank, read from their
+ * mobility models
+ *
+ * The true positions, which a vehicle does not know: for studies comparing
+ * them to the dead-reckoned ones, set on the core of a table with
+ * GetCore ().SetPositionSource.  Nodes of other ranks of a distributed
+ * simulation are left to the table.
+ */
+class MobilityPositionSource : public PositionSource
+{
+public:
+  MobilityPositionSource (uint32_t systemId = 0)
+    : m_systemId (systemId)
+  {
+  }
+
+  virtual bool GetPosition (uint32_t id, CoreVector & position) const;
+
+private:
+  uint32_t m_systemId;
+};
+
+/// Neighbor of a PositionTable, see NeighborEntry
+typedef NeighborEntry PositionTableEntry;
+
 /*
  * \ingroup kdtm
  * \brief Position table used by kDTM
+ *
+ * The ns-3 adapter of a NeighborTable: it converts Time and Vector to the
+ * types of the core, purges the entries and answers the positions at
+ * Simulator::Now and maps the MAC TX errors to neighbors.  GetCore gives
+ * the table of the core.
+ *
+ * Link windows are cached: a hello or an own kinematics update only
+ * recomputes the window of a neighbor when the relative position drifted
+ * from its prediction by more than the position tolerance or the relative
+ * velocity changed by more than the velocity tolerance.
  */
 class PositionTable
 {
@@ -29,41 +111,123 @@ public:
   PositionTable ();
   PositionTable (double maxRange, Vector position, Vector velocity);
 
+  /// The protocol core of the table
+  NeighborTable & GetCore ()
+  {
+    return m_core;
+  }
+
+  NeighborTable const & GetCore () const
+  {
+    return m_core;
+  }
+
   /**
    * \brief Gets the last time the entry was updated
    * \param id uint32_t to get time of update from
    * \return Time of last update to the position
    */
-  Time GetEntryUpdateTime (uint32_t id);
+  Time GetEntryUpdateTime (uint32_t id)
+  {
+    return FromTableTime (m_core.GetEntryUpdateTime (id));
+  }
 
   /**
-   * \brief Adds entry in position table
+   * \brief Adds entry in position table or updates the entry already present
+   *
+   * A hello of a known neighbor which moves as its entry predicts (within
+   * the position and velocity tolerances) with the same Betaj and tj only
+   * refreshes the time it was heard: the kinematics of the entry, its link
+   * window and the version of the table are kept.
    */
-  void AddEntry (uint32_t id, Vector position, Vector velocity, Time time, double Betaj, Time tj);
+  void AddEntry (uint32_t id, Vector position, Vector velocity, Time time, double Betaj, Time tj)
+  {
+    m_core.AddEntry (id, ToCoreVector (position), ToCoreVector (velocity), ToTableTime (time),
+                     Betaj, ToTableTime (tj));
+  }
+
+  /// Number of hellos of neighbors already in the table
+  uint64_t GetNUpdates () const {
+    return m_core.GetNUpdates ();
+  }
+
+  /// Number of those hellos which only refreshed the entry
+  uint64_t GetNFastUpdates () const {
+    return m_core.GetNFastUpdates ();
+  }
 
   /**
    * \brief Deletes entry in position table
    */
-  void DeleteEntry (uint32_t id);
+  void DeleteEntry (uint32_t id)
+  {
+    m_core.DeleteEntry (id);
+  }
+
+  /**
+   * \brief Updates the own kinematics
+   * \param time time of the position
+   *
+   * When the node drifted from the kinematics the link windows were last
+   * checked with (it turned, braked, ...), the windows of all the neighbors
+   * are checked in one pass and those which moved are recomputed with the
+   * neighbor positions extrapolated to time.
+   */
+  void UpdateMyKinematics (Time time, Vector position, Vector velocity);
+
+  /// \return predicted link window of a neighbor, (0, 0) if unknown
+  std::pair<Time, Time> GetLinkWindow (uint32_t id) const
+  {
+    std::pair<TableTime, TableTime> window = m_core.GetLinkWindow (id);
+    return std::make_pair (FromTableTime (window.first), FromTableTime (window.second));
+  }
 
   /**
    * \brief Gets position from position table
    * \param id uint32_t to get position from
    * \return Position of that id or NULL if not known
+   *
+   * The position of a neighbor is extrapolated to Simulator::Now from the
+   * position and velocity of its last hello; the mobility models are not
+   * read (see MobilityPositionSource).
    */
-  Vector GetPosition (uint32_t id);
+  Vector GetPosition (uint32_t id)
+  {
+    return FromCoreVector (m_core.GetPosition (id));
+  }
+
+  /// Position of a neighbor at time, by dead reckoning
+  Vector GetPosition (uint32_t id, Time time) const
+  {
+    return FromCoreVector (m_core.GetPosition (id, ToTableTime (time)));
+  }
+
+  /// Positions of all the neighbors at time, see NeighborTable::GetPositions
+  uint32_t GetPositions (Time time, std::vector<uint32_t> & ids,
+                         std::vector<double> & x, std::vector<double> & y)
+  {
+    return m_core.GetPositions (ToTableTime (time), ids, x, y);
+  }
 
   /**
    * \brief Checks if a node is a neighbour
    * \param id uint32_t of the node to check
    * \return True if the node is neighbour, false otherwise
    */
-  bool isNeighbour (uint32_t id);
+  bool isNeighbour (uint32_t id)
+  {
+    return m_core.IsNeighbor (id);
+  }
 
   /**
-   * \brief remove entries with expired lifetime
+   * \brief remove entries with expired lifetime, and the addresses of the
+   * neighbors that left the table
    */
-  void Purge ();
+  void Purge ()
+  {
+    m_core.Purge ();
+    PurgeAddresses ();
+  }
 
   /**
    * \brief clears all entries
@@ -72,16 +236,112 @@ public:
 
   /**
    * \Get Callback to ProcessTxError
+   *
+   * To be connected to the TxErrHeader trace of the MAC; the receivers of
+   * the failed frames are found by the addresses set by SetNeighborAddress.
    */
   Callback<void, WifiMacHeader const &> GetTxErrorCallback () const
   {
     return m_txErrorCallback;
   }
 
+  /**
+   * \brief Set the MAC address a neighbor sends its frames from
+   *
+   * The addresses of the neighbors that left the table are dropped when
+   * they outnumber the entries, so that the addresses stay within twice
+   * the size of the table.
+   */
+  void SetNeighborAddress (uint32_t id, Mac48Address address);
+
+  /// Number of MAC addresses kept, see SetNeighborAddress
+  uint32_t GetNAddresses () const
+  {
+    return m_addresses.size ();
+  }
+
+  /**
+   * \brief A frame to a neighbor was not acknowledged
+   *
+   * The neighbor is suspect from its first failure on, and is evicted when
+   * the failures in a row reach the TX failure limit: the table and the
+   * kinetic degree lose it before its link window ends.  A hello of the
+   * neighbor or ReportTxSuccess clears its failures.
+   * \return true if the neighbor was evicted
+   */
+  bool ReportTxFailure (uint32_t id);
+
+  /// A frame to a neighbor was acknowledged
+  void ReportTxSuccess (uint32_t id)
+  {
+    m_core.ReportTxSuccess (id);
+  }
+
+  /// \return true if the last frames to a neighbor in the table failed
+  bool IsSuspect (uint32_t id) const
+  {
+    return m_core.IsSuspect (id);
+  }
+
+  uint32_t GetTxFailureLimit () const {
+    return m_core.GetTxFailureLimit ();
+  }
+
+  /// Set the failures in a row which evict a neighbor, 0 never evicts
+  void SetTxFailureLimit (uint32_t limit)
+  {
+    m_core.SetTxFailureLimit (limit);
+  }
+
+  /// Number of TX failures toward neighbors in the table
+  uint64_t GetNTxFailures () const {
+    return m_core.GetNTxFailures ();
+  }
+
+  /// Number of neighbors evicted on TX failures
+  uint64_t GetNEvictions () const {
+    return m_core.GetNEvictions ();
+  }
+
+  /**
+   * \brief Keeps the summary of its neighbors a neighbor advertised
+   *
+   * The summary does not change the kinetic degree nor the version; it is
+   * kept until the next one.
+   */
+  void SetNeighborSummary (uint32_t id, NeighborSummary const & summary)
+  {
+    m_core.SetNeighborSummary (id, summary);
+  }
+
+  /// Summary of the neighbors of the table, to advertise in a hello
+  NeighborSummary CreateNeighborSummary (uint32_t bitsPerNeighbor = 8)
+  {
+    return m_core.CreateNeighborSummary (bitsPerNeighbor);
+  }
+
+  /**
+   * \brief Whether a transmission of the node reaches a neighbor that the
+   * transmissions of others did not
+   *
+   * A neighbor is covered when it is one of the transmitters or in the
+   * summary of one of them.  Transmitters without a summary only cover
+   * themselves; a false positive of a summary takes a neighbor as covered.
+   * \param transmitters ids of the nodes the node heard the message from
+   * \return true if a neighbor is not covered
+   */
+  bool AddsCoverage (std::vector<uint32_t> const & transmitters)
+  {
+    return m_core.AddsCoverage (transmitters);
+  }
+
   /**
    * \brief Calculate distance Threshold Mc based on Position predicaition algorithm
    */ 
-  double CalculateThreshold (Time time);
+  double CalculateThreshold (Time time)
+  {
+    return ExponentialThreshold () (CalculateDegree (time));
+  }
 
   bool IsInSearch (uint32_t id);
 
@@ -89,102 +349,244 @@ public:
 
   static Vector GetInvalidPosition ()
   {
-    return Vector (-1, -1, 0);
+    return FromCoreVector (NeighborTable::GetInvalidPosition ());
   }
 
   double GetMaxRange () const {
-    return m_maxRange;
+    return m_core.GetMaxRange ();
   }
 
   void SetMaxRange (double maxRange) 
   {
-    m_maxRange = maxRange;
+    m_core.SetMaxRange (maxRange);
   }
 
   Vector GetMyPosition () const {
-    return m_myPosition;
+    return FromCoreVector (m_core.GetMyPosition ());
   }
 
   void SetMyPosition (Vector position) 
   {
-    m_myPosition = position;
+    m_core.SetMyPosition (ToCoreVector (position));
   }
 
   Vector GetMyVelocity () const {
-    return m_myVelocity;
+    return FromCoreVector (m_core.GetMyVelocity ());
   }
 
   void SetMyVelocity (Vector velocity) 
   {
-    m_myVelocity = velocity;
+    m_core.SetMyVelocity (ToCoreVector (velocity));
+  }
+
+  double GetPositionTolerance () const {
+    return m_core.GetPositionTolerance ();
+  }
+
+  /// Set the drift of a relative position (m) under which a link window is kept
+  void SetPositionTolerance (double tolerance)
+  {
+    m_core.SetPositionTolerance (tolerance);
+  }
+
+  double GetVelocityTolerance () const {
+    return m_core.GetVelocityTolerance ();
+  }
+
+  /// Set the change of a relative velocity (m/s) under which a link window is kept
+  void SetVelocityTolerance (double tolerance)
+  {
+    m_core.SetVelocityTolerance (tolerance);
   }
 
   double GetPoissonCoeff () const {
-    return m_poissonCoeff.second;
+    return m_core.GetPoissonCoeff ();
   }
 
   void SetPoissonCoeff (double time)
   {
-    m_poissonCoeff.second = (m_poissonCoeff.first * m_poissonCoeff.second + time) / (m_poissonCoeff.first + 1);
-    m_poissonCoeff.first++;
+    m_core.SetPoissonCoeff (time);
   }
 
   Time GetTrajectoryBegin () const {
-    return m_trajectoryBegin;
+    return FromTableTime (m_core.GetTrajectoryBegin ());
   }
 
   void SetTrajectoryBegin (Time time)
   {
-    m_trajectoryBegin = time;
+    m_core.SetTrajectoryBegin (ToTableTime (time));
   }
 
   double GetAlpha () const {
-    return m_alpha;
+    return m_core.GetAlpha ();
   }
 
   void SetAlpha (double alpha)
   {
-    m_alpha = alpha;
+    m_core.SetAlpha (alpha);
   }
 
-  void Print (std::ostream & os);
+  /**
+   * \brief Gets the version of the table
+   *
+   * The version changes with every modification of an entry, of a link
+   * window or of the own parameters of the degree.  The purge of the
+   * entries whose window ended does not change it: their removal is
+   * predictable.
+   */
+  uint64_t GetVersion () const {
+    return m_core.GetVersion ();
+  }
+
+  std::map<uint32_t, PositionTableEntry> const & GetEntries () const {
+    return m_core.GetEntries ();
+  }
+
+  void Print (std::ostream & os)
+  {
+    m_core.Print (os);
+  }
 
   double CalculateDegree (Time time);
 
-private:
-  Time m_entryLifeTime;
-  //  map: node Id  <Position, velocity, time_from, Time_to, Betaj, tj>
-  std::map<uint32_t, std::tuple<Vector, Vector, Time, Time, double, Time>> m_table;
-  // TX error callback
-  Callback<void, WifiMacHeader const &> m_txErrorCallback;
+  /**
+   * \brief Kinetic degree and bound of its error, see SetDegreeEpsilon
+   */
+  double CalculateDegree (Time time, double & errorBound)
+  {
+    return m_core.CalculateDegree (time.GetSeconds (), errorBound);
+  }
+
+  /**
+   * \brief Kinetic degree with the given stability and link degree models
+   *
+   * CalculateDegree is this loop with PoissonStability and
+   * DoubleSigmoidDegree; BasicPositionTable runs it with its policies.
+   * The models are called directly, the compiler inlines them.
+   */
+  template <class StabilityPolicy, class DegreePolicy>
+  double CalculateDegreeWith (Time time, StabilityPolicy const & stability, DegreePolicy const & degree)
+  {
+    return m_core.CalculateDegreeWith (time.GetSeconds (), stability, degree);
+  }
 
-  Vector m_myPosition;
-  Vector m_myVelocity;
+  /**
+   * \brief Kinetic degree skipping the neighbors of negligible contribution
+   *
+   * The neighbors are visited in ascending order of the beginning of their
+   * window and the loop stops at the first one whose link degree is at most
+   * the epsilon of the table for the whole window (DegreePolicy::Reach).  As
+   * long as the stability is at most 1, i.e. time is after the trajectory
+   * beginnings, each skipped neighbor adds at most epsilon; otherwise no
+   * neighbor is skipped.
+   * \param errorBound set to the bound of the sum of the skipped terms
+   */
+  template <class StabilityPolicy, class DegreePolicy>
+  double CalculateDegreeWith (Time time, StabilityPolicy const & stability, DegreePolicy const & degree,
+                              double & errorBound)
+  {
+    return m_core.CalculateDegreeWith (time.GetSeconds (), stability, degree, errorBound);
+  }
 
-  double m_maxRange;
+  double GetDegreeEpsilon () const {
+    return m_core.GetDegreeEpsilon ();
+  }
 
-  double m_alpha;
+  /// Set the link degree under which a neighbor is left out of the kinetic
+  /// degree, 0 (the default) computes it exactly
+  void SetDegreeEpsilon (double epsilon)
+  {
+    m_core.SetDegreeEpsilon (epsilon);
+  }
 
-  std::pair<uint32_t, double> m_poissonCoeff;
+  /**
+   * \brief Writes the entries and the own state of the table to a snapshot
+   *
+   * The position source, the neighbor addresses, the TX failures and the
+   * neighbor summaries are not part of the state.
+   */
+  void Save (std::ostream & os) const
+  {
+    m_core.Save (os);
+  }
+
+  /**
+   * \brief Replaces the table by a state written by Save
+   * \param shift added to all the restored times, -t to restore a snapshot
+   * taken at time t in a simulation starting at 0
+   * \return false if the stream is truncated
+   */
+  bool Load (std::istream & is, Time shift);
 
-  Time m_trajectoryBegin;
+private:
+  NeighborTable m_core;
+  // TX error callback
+  Callback<void, WifiMacHeader const &> m_txErrorCallback;
+  /// MAC address -> node id of the neighbors
+  std::map<Mac48Address, uint32_t> m_addresses;
 
   // Process layer 2 TX error notification
   void ProcessTxError (WifiMacHeader const&);
+  // Drop the addresses of the neighbors not in the table
+  void PurgeAddresses ();
+};
 
-  /// Calucale link power equation Pij(t) = Aij*t^2 + Bij*t + Cij
-  double CalculateAij (Vector velocity);
-  double CalculateBij (Vector position, Vector velocity);
-  double CalculateCij (Vector position);
-  
-  /// Calculate time tij(to) and tij(from)
-  std::pair<Time, Time> CalculateTimeFromTo (Time time, Vector position, Vector velocity);
+/**
+ * \ingroup kdtm
+ * \brief Position table with compile-time stability, link degree and
+ * threshold models (see kdtmPolicies)
+ *
+ * CalculateDegree and CalculateThreshold hide those of PositionTable: the
+ * models only apply when the table is used through its own type.
+ * BasicPositionTable<> computes the same values as PositionTable.  Use
+ * KineticModel to choose the models at run time.
+ */
+template <class StabilityPolicy = PoissonStability,
+          class DegreePolicy = DoubleSigmoidDegree,
+          class ThresholdPolicy = ExponentialThreshold>
+class BasicPositionTable : public PositionTable
+{
+public:
+  BasicPositionTable (double maxRange, Vector position, Vector velocity,
+                      StabilityPolicy stability = StabilityPolicy (),
+                      DegreePolicy degree = DegreePolicy (),
+                      ThresholdPolicy threshold = ThresholdPolicy ())
+    : PositionTable (maxRange, position, velocity),
+      m_stability (stability),
+      m_degree (degree),
+      m_threshold (threshold)
+  {
+  }
 
-  /// Calculate stability of liaison ij: pij(t)
-  double CalculateStability (double time, double tj, double Betaj);
-  /// Calculate degree of liason ij: Degij(t)
-  double CalculateDoubleSigmoid (double t_from, double t_to, double t);
+  double CalculateDegree (Time time)
+  {
+    return CalculateDegreeWith (time, m_stability, m_degree);
+  }
+
+  double CalculateThreshold (Time time)
+  {
+    return m_threshold (CalculateDegree (time));
+  }
 
+  StabilityPolicy & GetStabilityPolicy ()
+  {
+    return m_stability;
+  }
+
+  DegreePolicy & GetDegreePolicy ()
+  {
+    return m_degree;
+  }
+
+  ThresholdPolicy & GetThresholdPolicy ()
+  {
+    return m_threshold;
+  }
+
+private:
+  StabilityPolicy m_stability;
+  DegreePolicy m_degree;
+  ThresholdPolicy m_threshold;
 };
 
 std::ostream & operator<< (std::ostream & os, PositionTable & h);
@@ -0,0 +1,251 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-record.h"
+#include "ns3/log.h"
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmRecord");
+
+namespace ns3 {
+namespace kdtm {
+
+/// Writes a column, false on I/O error
+template <typename T>
+static bool
+WriteColumn (FILE *file, std::vector<T> const & column)
+{
+  return fwrite (&column[0], sizeof (T), column.size (), file) == column.size ();
+}
+
+/// Reads a column of n values, false on truncated file
+template <typename T>
+static bool
+ReadColumn (FILE *file, std::vector<T> & column, uint32_t n)
+{
+  column.resize (n);
+  return fread (&column[0], sizeof (T), n, file) == n;
+}
+
+//-----------------------------------------------------------------------------
+// Recorder
+//-----------------------------------------------------------------------------
+DisseminationRecorder::DisseminationRecorder ()
+  : m_file (0),
+    m_blockSize (0),
+    m_nRecords (0)
+{
+}
+
+DisseminationRecorder::~DisseminationRecorder ()
+{
+  Close ();
+}
+
+bool
+DisseminationRecorder::Open (std::string path, uint32_t blockSize)
+{
+  Close ();
+  m_file = fopen (path.c_str (), "wb");
+  if (!m_file)
+    {
+      NS_LOG_ERROR ("Can not create " << path);
+      return false;
+    }
+
+  // Blocks are large sequential writes, let stdio pass them through
+  setvbuf (m_file, 0, _IOFBF, 1 << 20);
+
+  m_blockSize = blockSize > 0 ? blockSize : 1;
+  m_nRecords = 0;
+  m_time.reserve (m_blockSize);
+  m_node.reserve (m_blockSize);
+  m_messageId.reserve (m_blockSize);
+  m_hopCount.reserve (m_blockSize);
+  m_prevHop.reserve (m_blockSize);
+  m_x.reserve (m_blockSize);
+  m_y.reserve (m_blockSize);
+  m_decision.reserve (m_blockSize);
+  m_threshold.reserve (m_blockSize);
+
+  uint32_t version = GetVersion ();
+  fwrite (GetMagic (), 1, 8, m_file);
+  fwrite (&version, sizeof (version), 1, m_file);
+  fwrite (&m_blockSize, sizeof (m_blockSize), 1, m_file);
+  return true;
+}
+
+void
+DisseminationRecorder::Record (DisseminationRecord const & record)
+{
+  if (!m_file)
+    {
+      return;
+    }
+  m_time.push_back (record.time);
+  m_node.push_back (record.node);
+  m_messageId.push_back (record.messageId);
+  m_hopCount.push_back (record.hopCount);
+  m_prevHop.push_back (record.prevHop);
+  m_x.push_back (record.x);
+  m_y.push_back (record.y);
+  m_decision.push_back (record.decision);
+  m_threshold.push_back (record.threshold);
+  m_nRecords++;
+
+  if (m_time.size () >= m_blockSize)
+    {
+      Flush ();
+    }
+}
+
+void
+DisseminationRecorder::Flush ()
+{
+  if (!m_file || m_time.empty ())
+    {
+      return;
+    }
+
+  uint32_t n = m_time.size ();
+  bool ok = fwrite (&n, sizeof (n), 1, m_file) == 1
+    && WriteColumn (m_file, m_time)
+    && WriteColumn (m_file, m_node)
+    && WriteColumn (m_file, m_messageId)
+    && WriteColumn (m_file, m_hopCount)
+    && WriteColumn (m_file, m_prevHop)
+    && WriteColumn (m_file, m_x)
+    && WriteColumn (m_file, m_y)
+    && WriteColumn (m_file, m_decision)
+    && WriteColumn (m_file, m_threshold);
+  if (!ok)
+    {
+      NS_LOG_ERROR ("Write of " << n << " dissemination records failed");
+    }
+
+  m_time.clear ();
+  m_node.clear ();
+  m_messageId.clear ();
+  m_hopCount.clear ();
+  m_prevHop.clear ();
+  m_x.clear ();
+  m_y.clear ();
+  m_decision.clear ();
+  m_threshold.clear ();
+}
+
+void
+DisseminationRecorder::Close ()
+{
+  if (!m_file)
+    {
+      return;
+    }
+  Flush ();
+  fclose (m_file);
+  m_file = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Reader
+//-----------------------------------------------------------------------------
+DisseminationReader::DisseminationReader ()
+  : m_file (0),
+    m_blockSize (0)
+{
+}
+
+DisseminationReader::~DisseminationReader ()
+{
+  Close ();
+}
+
+bool
+DisseminationReader::Open (std::string path)
+{
+  Close ();
+  m_file = fopen (path.c_str (), "rb");
+  if (!m_file)
+    {
+      NS_LOG_ERROR ("Can not open " << path);
+      return false;
+    }
+
+  char magic[8];
+  uint32_t version;
+  if (fread (magic, 1, 8, m_file) != 8
+      || std::memcmp (magic, DisseminationRecorder::GetMagic (), 8) != 0
+      || fread (&version, sizeof (version), 1, m_file) != 1
+      || version != DisseminationRecorder::GetVersion ()
+      || fread (&m_blockSize, sizeof (m_blockSize), 1, m_file) != 1
+      || m_blockSize == 0)
+    {
+      NS_LOG_ERROR (path << " is not a dissemination record file");
+      Close ();
+      return false;
+    }
+  return true;
+}
+
+bool
+DisseminationReader::ReadBlock (std::vector<DisseminationRecord> & records)
+{
+  records.clear ();
+  uint32_t n;
+  if (!m_file || fread (&n, sizeof (n), 1, m_file) != 1 || n == 0)
+    {
+      return false;
+    }
+  // The recorder never writes more, a larger count is a damaged file
+  if (n > m_blockSize)
+    {
+      NS_LOG_ERROR ("Block of " << n << " dissemination records, more than " << m_blockSize);
+      return false;
+    }
+
+  std::vector<double> time, x, y, threshold;
+  std::vector<uint32_t> node, messageId, hopCount, prevHop;
+  std::vector<uint8_t> decision;
+  bool ok = ReadColumn (m_file, time, n)
+    && ReadColumn (m_file, node, n)
+    && ReadColumn (m_file, messageId, n)
+    && ReadColumn (m_file, hopCount, n)
+    && ReadColumn (m_file, prevHop, n)
+    && ReadColumn (m_file, x, n)
+    && ReadColumn (m_file, y, n)
+    && ReadColumn (m_file, decision, n)
+    && ReadColumn (m_file, threshold, n);
+  if (!ok)
+    {
+      NS_LOG_ERROR ("Truncated block of " << n << " dissemination records");
+      return false;
+    }
+
+  records.resize (n);
+  for (uint32_t k = 0; k < n; k++)
+    {
+      DisseminationRecord & record = records[k];
+      record.time = time[k];
+      record.node = node[k];
+      record.messageId = messageId[k];
+      record.hopCount = hopCount[k];
+      record.prevHop = prevHop[k];
+      record.x = x[k];
+      record.y = y[k];
+      record.decision = decision[k];
+      record.threshold = threshold[k];
+    }
+  return true;
+}
+
+void
+DisseminationReader::Close ()
+{
+  if (m_file)
+    {
+      fclose (m_file);
+    }
+  m_file = 0;
+}
+
+} // kdtm
+} // ns3
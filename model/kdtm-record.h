@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_RECORD_H
+#define KDTM_RECORD_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace kdtm {
+
+/// What happened to a warning at a node
+enum DisseminationDecision
+{
+  KDTM_RECEPTION = 0,    // a copy of the warning was received
+  KDTM_REBROADCAST = 1,  // backoff expired, the node rebroadcast the warning
+  KDTM_SUPPRESSED = 2    // backoff expired, the node did not rebroadcast
+};
+
+/**
+ * \ingroup kdtm
+ * \brief One warning reception or rebroadcast decision
+ */
+struct DisseminationRecord
+{
+  double time;          // s
+  uint32_t node;
+  uint32_t messageId;
+  uint32_t hopCount;
+  uint32_t prevHop;
+  double x;             // position of the node
+  double y;
+  uint8_t decision;     // DisseminationDecision
+  double threshold;     // kinetic threshold, 0 for receptions
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Append-only columnar binary file of dissemination records
+ *
+ \verbatim
+   file   : magic "KDTMREC1" | uint32 version | uint32 block capacity
+   block  : uint32 record count n
+            time[n] node[n] messageId[n] hopCount[n] prevHop[n]
+            x[n] y[n] decision[n] threshold[n]
+ \endverbatim
+ *
+ * Values are stored in host byte order, each column of a block is a
+ * contiguous array of fixed-size values.  Records are buffered by columns in
+ * memory and a whole block is written at once, so a reader can load a single
+ * column of a block without parsing the others.
+ */
+class DisseminationRecorder
+{
+public:
+  /// c-tor
+  DisseminationRecorder ();
+  ~DisseminationRecorder ();
+
+  /**
+   * \brief Creates the record file
+   * \param blockSize number of records buffered before a block is written
+   * \return false if the file can not be created
+   */
+  bool Open (std::string path, uint32_t blockSize = 65536);
+
+  /**
+   * \brief Appends a record
+   */
+  void Record (DisseminationRecord const & record);
+
+  /**
+   * \brief Writes the buffered records as a block
+   */
+  void Flush ();
+
+  /**
+   * \brief Flushes and closes the file
+   */
+  void Close ();
+
+  bool IsOpen () const {
+    return m_file != 0;
+  }
+
+  uint64_t GetNRecords () const {
+    return m_nRecords;
+  }
+
+  static const char * GetMagic ()
+  {
+    return "KDTMREC1";
+  }
+
+  static uint32_t GetVersion ()
+  {
+    return 1;
+  }
+
+private:
+  FILE *m_file;
+  uint32_t m_blockSize;
+  uint64_t m_nRecords;
+
+  ///\name Columns of the current block
+  //\{
+  std::vector<double> m_time;
+  std::vector<uint32_t> m_node;
+  std::vector<uint32_t> m_messageId;
+  std::vector<uint32_t> m_hopCount;
+  std::vector<uint32_t> m_prevHop;
+  std::vector<double> m_x;
+  std::vector<double> m_y;
+  std::vector<uint8_t> m_decision;
+  std::vector<double> m_threshold;
+  //\}
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Reads a file written by DisseminationRecorder block by block
+ */
+class DisseminationReader
+{
+public:
+  /// c-tor
+  DisseminationReader ();
+  ~DisseminationReader ();
+
+  /**
+   * \brief Opens a record file
+   * \return false if the file can not be read or is not a record file
+   */
+  bool Open (std::string path);
+
+  /**
+   * \brief Reads the next block
+   * \param records records of the block, replaced
+   * \return false at the end of the file
+   */
+  bool ReadBlock (std::vector<DisseminationRecord> & records);
+
+  void Close ();
+
+private:
+  FILE *m_file;
+  uint32_t m_blockSize;
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_RECORD_H */
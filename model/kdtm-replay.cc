@@ -0,0 +1,399 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-replay.h"
+#include "ns3/log.h"
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmReplay");
+
+namespace ns3 {
+namespace kdtm {
+
+/// Fixed part of the header of a delivery file
+struct DeliveryFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t nNodes;
+  double range;
+  double alpha;
+  double degreeEpsilon;
+  char stability[16];
+  char degree[16];
+  char threshold[16];
+};
+
+/// Copies a model name in a fixed size field, NUL padded
+static void
+WriteName (char (&field)[16], std::string const & name)
+{
+  std::memset (field, 0, sizeof (field));
+  std::strncpy (field, name.c_str (), sizeof (field) - 1);
+}
+
+QueueDecision
+DecideRebroadcast (PositionTable & table, Queue const & queue, KineticModel const & model,
+                   uint32_t messageId, Time now, double range)
+{
+  QueueDecision decision = QueueDecision ();
+  Vector mean = queue.CalculateSpatialDist (messageId);
+  decision.distanceToMean = CalculateDistance (table.GetMyPosition (), mean) / range;
+  decision.threshold = model.CalculateThreshold (table, now);
+  decision.rebroadcast = decision.distanceToMean >= decision.threshold;
+  decision.deadline = now;
+  return decision;
+}
+
+//-----------------------------------------------------------------------------
+// Recorder
+//-----------------------------------------------------------------------------
+DeliveryRecorder::DeliveryRecorder ()
+  : m_file (0),
+    m_nEvents (0)
+{
+}
+
+DeliveryRecorder::~DeliveryRecorder ()
+{
+  Close ();
+}
+
+bool
+DeliveryRecorder::Open (std::string path, DeliveryConfig const & config)
+{
+  Close ();
+  m_file = fopen (path.c_str (), "wb");
+  if (!m_file)
+    {
+      NS_LOG_ERROR ("Can not create " << path);
+      return false;
+    }
+
+  DeliveryFileHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.magic, GetMagic (), sizeof (header.magic));
+  header.version = GetVersion ();
+  header.nNodes = config.trajectoryBegin.size ();
+  header.range = config.range;
+  header.alpha = config.alpha;
+  header.degreeEpsilon = config.degreeEpsilon;
+  WriteName (header.stability, config.stability);
+  WriteName (header.degree, config.degree);
+  WriteName (header.threshold, config.threshold);
+  fwrite (&header, sizeof (header), 1, m_file);
+  for (uint32_t i = 0; i < config.trajectoryBegin.size (); i++)
+    {
+      int64_t ticks = config.trajectoryBegin[i].GetNanoSeconds ();
+      fwrite (&ticks, sizeof (ticks), 1, m_file);
+    }
+
+  m_nEvents = 0;
+  m_block.clear ();
+  m_block.reserve (4096);
+  return true;
+}
+
+DeliveryEvent &
+DeliveryRecorder::Append (Time time, uint32_t node, DeliveryType type, Vector myPosition, Vector myVelocity)
+{
+  if (m_block.size () == m_block.capacity ())
+    {
+      Flush ();
+    }
+  m_block.push_back (DeliveryEvent ());
+  DeliveryEvent & event = m_block.back ();
+  std::memset (&event, 0, sizeof (event));
+  event.time = time.GetNanoSeconds ();
+  event.node = node;
+  event.type = type;
+  event.myX = myPosition.x;
+  event.myY = myPosition.y;
+  event.myVx = myVelocity.x;
+  event.myVy = myVelocity.y;
+  m_nEvents++;
+  return event;
+}
+
+void
+DeliveryRecorder::RecordHello (Time time, uint32_t node, Vector myPosition, Vector myVelocity,
+                               uint32_t id, Vector position, Vector velocity, double beta, Time trajectoryBegin)
+{
+  if (!m_file)
+    {
+      return;
+    }
+  DeliveryEvent & event = Append (time, node, KDTM_DELIVERY_HELLO, myPosition, myVelocity);
+  event.id = id;
+  event.x = position.x;
+  event.y = position.y;
+  event.vx = velocity.x;
+  event.vy = velocity.y;
+  event.beta = beta;
+  event.trajectoryBegin = trajectoryBegin.GetNanoSeconds ();
+}
+
+void
+DeliveryRecorder::RecordWarning (Time time, uint32_t node, QueueEntry const & entry, Time backOff)
+{
+  if (!m_file)
+    {
+      return;
+    }
+  DeliveryEvent & event = Append (time, node, KDTM_DELIVERY_WARNING, Vector (0, 0, 0), Vector (0, 0, 0));
+  event.id = entry.GetPrevHopId ();
+  event.sourceId = entry.GetSourceId ();
+  event.messageId = entry.GetMessageId ();
+  event.hopCount = entry.GetHopCount ();
+  event.x = entry.GetPosition ().x;
+  event.y = entry.GetPosition ().y;
+  event.backOff = backOff.GetNanoSeconds ();
+}
+
+void
+DeliveryRecorder::RecordExpiry (Time time, uint32_t node, Vector myPosition, Vector myVelocity,
+                                uint32_t messageId, QueueDecision const & decision)
+{
+  if (!m_file)
+    {
+      return;
+    }
+  DeliveryEvent & event = Append (time, node, KDTM_DELIVERY_EXPIRY, myPosition, myVelocity);
+  event.messageId = messageId;
+  event.threshold = decision.threshold;
+  event.rebroadcast = decision.rebroadcast;
+}
+
+void
+DeliveryRecorder::RecordSample (Time time, uint32_t node, Vector myPosition, Vector myVelocity)
+{
+  if (!m_file)
+    {
+      return;
+    }
+  Append (time, node, KDTM_DELIVERY_SAMPLE, myPosition, myVelocity);
+}
+
+void
+DeliveryRecorder::RecordTxFailure (Time time, uint32_t node, uint32_t id)
+{
+  if (!m_file)
+    {
+      return;
+    }
+  DeliveryEvent & event = Append (time, node, KDTM_DELIVERY_TX_FAILURE, Vector (0, 0, 0), Vector (0, 0, 0));
+  event.id = id;
+}
+
+void
+DeliveryRecorder::Flush ()
+{
+  if (!m_file || m_block.empty ())
+    {
+      return;
+    }
+  if (fwrite (&m_block[0], sizeof (DeliveryEvent), m_block.size (), m_file) != m_block.size ())
+    {
+      NS_LOG_ERROR ("Write of " << m_block.size () << " delivery events failed");
+    }
+  m_block.clear ();
+}
+
+void
+DeliveryRecorder::Close ()
+{
+  if (!m_file)
+    {
+      return;
+    }
+  Flush ();
+  fclose (m_file);
+  m_file = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Reader
+//-----------------------------------------------------------------------------
+DeliveryReader::DeliveryReader ()
+  : m_file (0)
+{
+}
+
+DeliveryReader::~DeliveryReader ()
+{
+  Close ();
+}
+
+bool
+DeliveryReader::Open (std::string path)
+{
+  Close ();
+  m_file = fopen (path.c_str (), "rb");
+  if (!m_file)
+    {
+      NS_LOG_ERROR ("Can not open " << path);
+      return false;
+    }
+
+  DeliveryFileHeader header;
+  if (fread (&header, sizeof (header), 1, m_file) != 1
+      || std::memcmp (header.magic, DeliveryRecorder::GetMagic (), sizeof (header.magic)) != 0
+      || header.version != DeliveryRecorder::GetVersion ())
+    {
+      NS_LOG_ERROR (path << " is not a delivery file");
+      Close ();
+      return false;
+    }
+  header.stability[15] = header.degree[15] = header.threshold[15] = 0;
+  m_config.range = header.range;
+  m_config.alpha = header.alpha;
+  m_config.degreeEpsilon = header.degreeEpsilon;
+  m_config.stability = header.stability;
+  m_config.degree = header.degree;
+  m_config.threshold = header.threshold;
+  m_config.trajectoryBegin.resize (header.nNodes);
+  for (uint32_t i = 0; i < header.nNodes; i++)
+    {
+      int64_t ticks;
+      if (fread (&ticks, sizeof (ticks), 1, m_file) != 1)
+        {
+          NS_LOG_ERROR (path << " is truncated");
+          Close ();
+          return false;
+        }
+      m_config.trajectoryBegin[i] = NanoSeconds (ticks);
+    }
+  return true;
+}
+
+bool
+DeliveryReader::Read (std::vector<DeliveryEvent> & events, uint32_t maxEvents)
+{
+  events.resize (maxEvents);
+  size_t n = m_file && maxEvents > 0 ? fread (&events[0], sizeof (DeliveryEvent), maxEvents, m_file) : 0;
+  events.resize (n);
+  return n > 0;
+}
+
+void
+DeliveryReader::Close ()
+{
+  if (m_file)
+    {
+      fclose (m_file);
+    }
+  m_file = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Replay
+//-----------------------------------------------------------------------------
+DeliveryReplay::DeliveryReplay ()
+  : m_range (0),
+    m_nEvents (0),
+    m_nDecisions (0),
+    m_nRebroadcasts (0),
+    m_nMismatches (0)
+{
+}
+
+DeliveryReplay::~DeliveryReplay ()
+{
+  Clear ();
+}
+
+void
+DeliveryReplay::Clear ()
+{
+  for (std::vector<Node *>::iterator i = m_nodes.begin (); i != m_nodes.end (); ++i)
+    {
+      delete *i;
+    }
+  m_nodes.clear ();
+}
+
+bool
+DeliveryReplay::Configure (DeliveryConfig const & config)
+{
+  Clear ();
+  m_model = CreateKineticModel (config.stability, config.degree, config.threshold);
+  if (!m_model)
+    {
+      return false;
+    }
+  m_range = config.range;
+  for (uint32_t i = 0; i < config.trajectoryBegin.size (); i++)
+    {
+      // As kdtm-example configures the table of a vehicle
+      Node *node = new Node (config.range);
+      node->table.SetAlpha (config.alpha);
+      node->table.SetDegreeEpsilon (config.degreeEpsilon);
+      node->table.SetTrajectoryBegin (config.trajectoryBegin[i]);
+      m_nodes.push_back (node);
+    }
+  m_nEvents = m_nDecisions = m_nRebroadcasts = m_nMismatches = 0;
+  return true;
+}
+
+bool
+DeliveryReplay::Apply (DeliveryEvent const & event)
+{
+  if (event.node >= m_nodes.size ())
+    {
+      NS_LOG_WARN ("Event of unknown node " << event.node);
+      return false;
+    }
+  m_nEvents++;
+  Node *node = m_nodes[event.node];
+  Time time = NanoSeconds (event.time);
+  Vector myPosition (event.myX, event.myY, 0);
+  Vector myVelocity (event.myVx, event.myVy, 0);
+
+  switch (event.type)
+    {
+    case KDTM_DELIVERY_HELLO:
+      node->table.UpdateMyKinematics (time, myPosition, myVelocity);
+      node->table.AddEntry (event.id, Vector (event.x, event.y, 0), Vector (event.vx, event.vy, 0),
+                            time, event.beta, NanoSeconds (event.trajectoryBegin));
+      return true;
+    case KDTM_DELIVERY_WARNING:
+      node->queue.Add (QueueEntry (Vector (event.x, event.y, 0), NanoSeconds (event.backOff),
+                                   Create<Packet> (), event.sourceId, event.messageId, event.id,
+                                   event.hopCount));
+      return true;
+    case KDTM_DELIVERY_SAMPLE:
+      node->table.UpdateMyKinematics (time, myPosition, myVelocity);
+      m_model->CalculateDegree (node->table, time);
+      m_model->CalculateThreshold (node->table, time);
+      return true;
+    case KDTM_DELIVERY_TX_FAILURE:
+      node->table.ReportTxFailure (event.id);
+      return true;
+    case KDTM_DELIVERY_EXPIRY:
+      break;
+    default:
+      NS_LOG_WARN ("Unknown event type " << event.type);
+      return false;
+    }
+
+  node->table.UpdateMyKinematics (time, myPosition, myVelocity);
+  QueueDecision decision = DecideRebroadcast (node->table, node->queue, *m_model, event.messageId,
+                                              time, m_range);
+  node->queue.SetDecision (event.messageId, decision);
+  if (node->queue.Exist (event.messageId))
+    {
+      node->queue.GetEntry (event.messageId).SetForwarded (true);
+    }
+  m_nDecisions++;
+  m_nRebroadcasts += decision.rebroadcast;
+  if (decision.rebroadcast != (event.rebroadcast != 0) || decision.threshold != event.threshold)
+    {
+      NS_LOG_WARN ("Node " << event.node << " message " << event.messageId << " at " << time.GetSeconds ()
+                   << " s: threshold " << decision.threshold << " instead of " << event.threshold);
+      m_nMismatches++;
+      return false;
+    }
+  return true;
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,269 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_REPLAY_H
+#define KDTM_REPLAY_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include "kdtm-ptable.h"
+#include "kdtm-wqueue.h"
+#include "kdtm-kinetic-model.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/// Calls into the protocol core of a node
+enum DeliveryType
+{
+  KDTM_DELIVERY_HELLO = 0,    // hello, or kinematics carried by a warning: AddEntry
+  KDTM_DELIVERY_WARNING = 1,  // copy of a warning: Queue::Add
+  KDTM_DELIVERY_EXPIRY = 2,   // backoff expiry: rebroadcast decision
+  KDTM_DELIVERY_SAMPLE = 3,   // kinetic degree and threshold sampled
+  KDTM_DELIVERY_TX_FAILURE = 4  // frame to a neighbor not acknowledged: ReportTxFailure
+};
+
+/**
+ * \ingroup kdtm
+ * \brief One event delivered to the protocol core of a node
+ *
+ * The kinematics of the node are those it updated its table with before
+ * the call, for all the types but KDTM_DELIVERY_WARNING.
+ */
+struct DeliveryEvent
+{
+  int64_t time;             // ns
+  uint32_t node;            // index of the node
+  uint32_t type;            // DeliveryType
+  double myX;               // kinematics of the node
+  double myY;
+  double myVx;
+  double myVy;
+  uint32_t id;              // hello: sender, warning: previous hop, TX failure: receiver
+  uint32_t sourceId;        // warning
+  uint32_t messageId;       // warning, expiry
+  uint32_t hopCount;        // warning
+  double x;                 // hello: sender position, warning: position of the copy
+  double y;
+  double vx;                // hello: sender velocity
+  double vy;
+  double beta;              // hello
+  int64_t trajectoryBegin;  // hello, ns
+  int64_t backOff;          // warning, ns
+  double threshold;         // expiry: recorded decision
+  uint32_t rebroadcast;
+  uint32_t reserved;
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Configuration of the nodes of a delivery file
+ */
+struct DeliveryConfig
+{
+  double range;
+  double alpha;
+  double degreeEpsilon;
+  std::string stability;    // CreateKineticModel names
+  std::string degree;
+  std::string threshold;
+  std::vector<Time> trajectoryBegin;  // of each node
+};
+
+/**
+ * \ingroup kdtm
+ * \brief The kDTM rebroadcast rule
+ *
+ * The distance of the node to the mean position of the copies of the
+ * message, in ranges, against the kinetic threshold of its table.
+ * \param range transmission range (m)
+ * \return the decision, taken at now
+ */
+QueueDecision DecideRebroadcast (PositionTable & table, Queue const & queue, KineticModel const & model,
+                                 uint32_t messageId, Time now, double range);
+
+/**
+ * \ingroup kdtm
+ * \brief Binary file of the events delivered to the protocol core of the
+ * nodes of a simulation
+ *
+ \verbatim
+   magic "KDTMRPL1" | uint32 version | uint32 nNodes
+   double range | double alpha | double degreeEpsilon
+   char stability[16] | char degree[16] | char threshold[16]
+   int64 trajectoryBegin[nNodes] (ns)
+   DeliveryEvent x n          (time order)
+ \endverbatim
+ *
+ * Values are stored in host byte order.  Events are buffered and written
+ * by blocks.
+ */
+class DeliveryRecorder
+{
+public:
+  /// c-tor
+  DeliveryRecorder ();
+  ~DeliveryRecorder ();
+
+  /**
+   * \brief Creates the file
+   * \return false if it can not be created
+   */
+  bool Open (std::string path, DeliveryConfig const & config);
+
+  /// A hello, or the kinematics carried by a warning, added to the table of node
+  void RecordHello (Time time, uint32_t node, Vector myPosition, Vector myVelocity,
+                    uint32_t id, Vector position, Vector velocity, double beta, Time trajectoryBegin);
+
+  /// A copy of a warning added to the queue of node
+  void RecordWarning (Time time, uint32_t node, QueueEntry const & entry, Time backOff);
+
+  /// The rebroadcast decision of node on backoff expiry
+  void RecordExpiry (Time time, uint32_t node, Vector myPosition, Vector myVelocity,
+                     uint32_t messageId, QueueDecision const & decision);
+
+  /// The kinetic degree and threshold of node sampled
+  void RecordSample (Time time, uint32_t node, Vector myPosition, Vector myVelocity);
+
+  /// A frame of node to neighbor id was not acknowledged
+  void RecordTxFailure (Time time, uint32_t node, uint32_t id);
+
+  /// Flushes and closes the file
+  void Close ();
+
+  bool IsOpen () const {
+    return m_file != 0;
+  }
+
+  uint64_t GetNEvents () const {
+    return m_nEvents;
+  }
+
+  static const char * GetMagic ()
+  {
+    return "KDTMRPL1";
+  }
+
+  static uint32_t GetVersion ()
+  {
+    return 1;
+  }
+
+private:
+  FILE *m_file;
+  uint64_t m_nEvents;
+  std::vector<DeliveryEvent> m_block;
+
+  /// Event of the type with the common fields set
+  DeliveryEvent & Append (Time time, uint32_t node, DeliveryType type, Vector myPosition, Vector myVelocity);
+  void Flush ();
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Reads a file written by DeliveryRecorder
+ */
+class DeliveryReader
+{
+public:
+  /// c-tor
+  DeliveryReader ();
+  ~DeliveryReader ();
+
+  /**
+   * \brief Opens a delivery file and reads its configuration
+   * \return false if the file can not be read or is not a delivery file
+   */
+  bool Open (std::string path);
+
+  /**
+   * \brief Reads the next events
+   * \param events replaced by at most maxEvents events
+   * \return false at the end of the file
+   */
+  bool Read (std::vector<DeliveryEvent> & events, uint32_t maxEvents = 65536);
+
+  void Close ();
+
+  DeliveryConfig const & GetConfig () const {
+    return m_config;
+  }
+
+private:
+  FILE *m_file;
+  DeliveryConfig m_config;
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Protocol core of the nodes of a delivery file, without channel,
+ * mobility or packets
+ *
+ * Apply () makes the calls the simulation made.  PositionTable::Purge reads
+ * Simulator::Now (), so the events must be applied at their time from
+ * simulator events for the tables to go through the same states; the
+ * decisions are then those that were recorded.
+ */
+class DeliveryReplay
+{
+public:
+  /// c-tor
+  DeliveryReplay ();
+  ~DeliveryReplay ();
+
+  /**
+   * \brief Creates the nodes, their tables and queues empty
+   * \return false if the kinetic model is unknown
+   */
+  bool Configure (DeliveryConfig const & config);
+
+  /**
+   * \brief Makes the call of an event into the core of its node
+   * \return false if an expiry decision differs from the recorded one
+   */
+  bool Apply (DeliveryEvent const & event);
+
+  uint64_t GetNEvents () const {
+    return m_nEvents;
+  }
+
+  uint64_t GetNDecisions () const {
+    return m_nDecisions;
+  }
+
+  uint64_t GetNRebroadcasts () const {
+    return m_nRebroadcasts;
+  }
+
+  uint64_t GetNMismatches () const {
+    return m_nMismatches;
+  }
+
+private:
+  /// Protocol state of a node
+  struct Node
+  {
+    Node (double range)
+      : table (range, Vector (0, 0, 0), Vector (0, 0, 0))
+    {
+    }
+    PositionTable table;
+    Queue queue;
+  };
+
+  double m_range;
+  Ptr<KineticModel> m_model;
+  std::vector<Node *> m_nodes;
+  uint64_t m_nEvents;
+  uint64_t m_nDecisions;
+  uint64_t m_nRebroadcasts;
+  uint64_t m_nMismatches;
+
+  void Clear ();
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_REPLAY_H */
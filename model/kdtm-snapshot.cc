@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-snapshot.h"
+#include "ns3/log.h"
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmSnapshot");
+
+namespace ns3 {
+namespace kdtm {
+
+static const char g_snapshotMagic[8] = { 'K', 'D', 'T', 'M', 'S', 'N', 'P', '1' };
+static const uint32_t g_snapshotVersion = 3;
+
+void
+SnapshotWrite (std::ostream & os, Vector const & value)
+{
+  SnapshotWrite (os, value.x);
+  SnapshotWrite (os, value.y);
+  SnapshotWrite (os, value.z);
+}
+
+bool
+SnapshotRead (std::istream & is, Vector & value)
+{
+  return SnapshotRead (is, value.x) && SnapshotRead (is, value.y) && SnapshotRead (is, value.z);
+}
+
+void
+SnapshotWrite (std::ostream & os, Time const & value)
+{
+  int64_t ns = value.GetNanoSeconds ();
+  SnapshotWrite (os, ns);
+}
+
+bool
+SnapshotRead (std::istream & is, Time & value)
+{
+  int64_t ns;
+  if (!SnapshotRead (is, ns))
+    {
+      return false;
+    }
+  value = NanoSeconds (ns);
+  return true;
+}
+
+void
+WriteSnapshotHeader (std::ostream & os, Time time, uint32_t nNodes)
+{
+  os.write (g_snapshotMagic, sizeof (g_snapshotMagic));
+  SnapshotWrite (os, g_snapshotVersion);
+  SnapshotWrite (os, time);
+  SnapshotWrite (os, nNodes);
+}
+
+bool
+ReadSnapshotHeader (std::istream & is, Time & time, uint32_t & nNodes)
+{
+  char magic[sizeof (g_snapshotMagic)];
+  uint32_t version;
+  if (!is.read (magic, sizeof (magic))
+      || std::memcmp (magic, g_snapshotMagic, sizeof (magic)) != 0
+      || !SnapshotRead (is, version)
+      || version != g_snapshotVersion
+      || !SnapshotRead (is, time)
+      || !SnapshotRead (is, nNodes))
+    {
+      NS_LOG_ERROR ("Not a version " << g_snapshotVersion << " kdtm snapshot");
+      return false;
+    }
+  return true;
+}
+
+} // kdtm
+} // ns3
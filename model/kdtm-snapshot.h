@@ -0,0 +1,49 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_SNAPSHOT_H
+#define KDTM_SNAPSHOT_H
+
+#include <stdint.h>
+#include <iostream>
+#include "ns3/vector.h"
+#include "ns3/nstime.h"
+#include "kdtm-core.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Binary encoding of the protocol state snapshots
+ *
+ * A snapshot is a stream of fixed-size values in host byte order, it is
+ * only meant to be read back by the build that wrote it.  Times are stored
+ * as signed nanoseconds, vectors as three doubles.
+ *
+ \verbatim
+   file : magic "KDTMSNP1" | uint32 version | int64 time | uint32 nodes
+          then the state of the nodes, as written by the application
+ \endverbatim
+ *
+ * PositionTable::Save and Queue::Save write the state of one node.
+ */
+void SnapshotWrite (std::ostream & os, Vector const & value);
+bool SnapshotRead (std::istream & is, Vector & value);
+void SnapshotWrite (std::ostream & os, Time const & value);
+bool SnapshotRead (std::istream & is, Time & value);
+
+/**
+ * \brief Writes the header of a snapshot
+ * \param time simulation time of the snapshot
+ * \param nNodes number of node states which follow
+ */
+void WriteSnapshotHeader (std::ostream & os, Time time, uint32_t nNodes);
+
+/**
+ * \brief Reads the header of a snapshot
+ * \return false if the stream is not a snapshot of this version
+ */
+bool ReadSnapshotHeader (std::istream & is, Time & time, uint32_t & nNodes);
+
+} // kdtm
+} // ns3
+#endif /* KDTM_SNAPSHOT_H */
@@ -0,0 +1,274 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-trace-writer.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmTraceWriter");
+
+namespace ns3 {
+namespace kdtm {
+
+/// Time the thread sleeps when the ring is empty
+static const std::chrono::microseconds g_idleSleep (100);
+
+//-----------------------------------------------------------------------------
+// Stream
+//-----------------------------------------------------------------------------
+AsyncTraceWriter::StreamBuffer::StreamBuffer (AsyncTraceWriter *writer)
+  : m_writer (writer),
+    m_text (RECORD_TEXT)
+{
+  setp (&m_text[0], &m_text[0] + m_text.size ());
+}
+
+void
+AsyncTraceWriter::StreamBuffer::Commit ()
+{
+  if (pptr () > pbase ())
+    {
+      m_writer->Enqueue (pbase (), pptr () - pbase ());
+    }
+  setp (&m_text[0], &m_text[0] + m_text.size ());
+}
+
+AsyncTraceWriter::StreamBuffer::int_type
+AsyncTraceWriter::StreamBuffer::overflow (int_type c)
+{
+  if (m_writer->m_policy == KDTM_TRACE_DROP)
+    {
+      // The text is dropped whole or not at all: keep it until sync
+      std::ptrdiff_t size = pptr () - pbase ();
+      m_text.resize (2 * m_text.size ());
+      setp (&m_text[0], &m_text[0] + m_text.size ());
+      pbump (size);
+    }
+  else
+    {
+      Commit ();
+    }
+  if (!traits_type::eq_int_type (c, traits_type::eof ()))
+    {
+      *pptr () = traits_type::to_char_type (c);
+      pbump (1);
+    }
+  return traits_type::not_eof (c);
+}
+
+int
+AsyncTraceWriter::StreamBuffer::sync ()
+{
+  Commit ();
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Writer
+//-----------------------------------------------------------------------------
+AsyncTraceWriter::AsyncTraceWriter ()
+  : m_file (0),
+    m_policy (KDTM_TRACE_BLOCK),
+    m_mask (0),
+    m_writeSize (0),
+    m_stop (false),
+    m_head (0),
+    m_written (0),
+    m_nWrites (0),
+    m_tail (0),
+    m_cachedHead (0),
+    m_nRecords (0),
+    m_nDropped (0),
+    m_nStalls (0),
+    m_streamBuffer (this),
+    m_stream (&m_streamBuffer)
+{
+}
+
+AsyncTraceWriter::~AsyncTraceWriter ()
+{
+  Close ();
+}
+
+bool
+AsyncTraceWriter::Open (std::string path, uint32_t nRecords, TracePolicy policy, uint32_t writeSize)
+{
+  Close ();
+  m_file = fopen (path.c_str (), "w");
+  if (!m_file)
+    {
+      NS_LOG_ERROR ("Can not create " << path);
+      return false;
+    }
+
+  uint64_t size = 1;
+  while (size < nRecords)
+    {
+      size <<= 1;
+    }
+  m_ring.resize (size);
+  m_mask = size - 1;
+  m_policy = policy;
+  m_writeSize = std::max<uint32_t> (writeSize, RECORD_TEXT);
+  m_buffer.clear ();
+  m_buffer.reserve (m_writeSize + RECORD_TEXT);
+  m_head.store (0);
+  m_written.store (0);
+  m_nWrites.store (0);
+  m_tail.store (0);
+  m_cachedHead = 0;
+  m_nRecords = m_nDropped = m_nStalls = 0;
+  m_stop.store (false);
+  m_thread = std::thread (&AsyncTraceWriter::Drain, this);
+  return true;
+}
+
+uint64_t
+AsyncTraceWriter::GetFree ()
+{
+  uint64_t tail = m_tail.load (std::memory_order_relaxed);
+  if (tail - m_cachedHead == m_ring.size ())
+    {
+      m_cachedHead = m_head.load (std::memory_order_acquire);
+    }
+  return m_ring.size () - (tail - m_cachedHead);
+}
+
+bool
+AsyncTraceWriter::Write (char const *text, size_t size)
+{
+  m_streamBuffer.Commit ();
+  return Enqueue (text, size);
+}
+
+bool
+AsyncTraceWriter::Enqueue (char const *text, size_t size)
+{
+  if (!m_file || size == 0)
+    {
+      return false;
+    }
+  uint64_t nRecords = (size + RECORD_TEXT - 1) / RECORD_TEXT;
+  if (m_policy == KDTM_TRACE_DROP)
+    {
+      if (GetFree () < nRecords)
+        {
+          // The cached head may be late: look at the thread once more
+          m_cachedHead = m_head.load (std::memory_order_acquire);
+          if (GetFree () < nRecords)
+            {
+              m_nDropped += nRecords;
+              return false;
+            }
+        }
+    }
+
+  bool stalled = false;
+  uint64_t tail = m_tail.load (std::memory_order_relaxed);
+  while (size > 0)
+    {
+      while (GetFree () == 0)
+        {
+          stalled = true;
+          std::this_thread::yield ();
+        }
+      Record & record = m_ring[tail & m_mask];
+      record.size = std::min<size_t> (size, RECORD_TEXT);
+      std::memcpy (record.text, text, record.size);
+      text += record.size;
+      size -= record.size;
+      m_tail.store (++tail, std::memory_order_release);
+    }
+  m_nRecords += nRecords;
+  m_nStalls += stalled;
+  return true;
+}
+
+void
+AsyncTraceWriter::WriteBuffer ()
+{
+  if (m_buffer.empty ())
+    {
+      return;
+    }
+  if (fwrite (&m_buffer[0], 1, m_buffer.size (), m_file) != m_buffer.size ())
+    {
+      NS_LOG_ERROR ("Write of " << m_buffer.size () << " trace bytes failed");
+    }
+  m_buffer.clear ();
+  m_nWrites.fetch_add (1, std::memory_order_relaxed);
+}
+
+void
+AsyncTraceWriter::Drain ()
+{
+  uint64_t head = m_head.load (std::memory_order_relaxed);
+  while (true)
+    {
+      uint64_t tail = m_tail.load (std::memory_order_acquire);
+      if (head == tail)
+        {
+          // Idle: whatever is buffered goes to the disk now
+          if (!m_buffer.empty ())
+            {
+              WriteBuffer ();
+              fflush (m_file);
+            }
+          m_written.store (head, std::memory_order_release);
+          if (m_stop.load (std::memory_order_acquire)
+              && m_tail.load (std::memory_order_acquire) == head)
+            {
+              return;
+            }
+          std::this_thread::sleep_for (g_idleSleep);
+          continue;
+        }
+      for (; head != tail; head++)
+        {
+          Record const & record = m_ring[head & m_mask];
+          m_buffer.insert (m_buffer.end (), record.text, record.text + record.size);
+          if (m_buffer.size () >= m_writeSize)
+            {
+              // Give the records back before the disk write
+              m_head.store (head + 1, std::memory_order_release);
+              WriteBuffer ();
+            }
+        }
+      m_head.store (head, std::memory_order_release);
+    }
+}
+
+void
+AsyncTraceWriter::Flush ()
+{
+  if (!m_file)
+    {
+      return;
+    }
+  m_streamBuffer.Commit ();
+  uint64_t tail = m_tail.load (std::memory_order_relaxed);
+  while (m_written.load (std::memory_order_acquire) < tail)
+    {
+      std::this_thread::sleep_for (g_idleSleep);
+    }
+}
+
+void
+AsyncTraceWriter::Close ()
+{
+  if (!m_file)
+    {
+      return;
+    }
+  m_streamBuffer.Commit ();
+  m_stop.store (true, std::memory_order_release);
+  m_thread.join ();
+  fclose (m_file);
+  m_file = 0;
+  NS_LOG_INFO (m_nRecords << " trace records, " << m_nDropped << " dropped, "
+               << m_nStalls << " stalls, " << m_nWrites.load () << " writes");
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,176 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_TRACE_WRITER_H
+#define KDTM_TRACE_WRITER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+namespace kdtm {
+
+/// What AsyncTraceWriter does with a text which does not fit in the ring
+enum TracePolicy
+{
+  KDTM_TRACE_BLOCK = 0,  // wait for the writer thread to make room
+  KDTM_TRACE_DROP = 1    // drop the text and count its records
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Text trace file written by a background thread
+ *
+ * The simulation thread copies the text in fixed size records of a lock
+ * free single producer, single consumer ring and returns; a thread of the
+ * writer drains the ring into a large buffer and writes the buffer to the
+ * file in one call when it is full or the ring is empty.  The simulation
+ * never waits for the disk, only for room in the ring under
+ * KDTM_TRACE_BLOCK.
+ *
+ * Under KDTM_TRACE_DROP a text is enqueued whole or not at all, a text of
+ * more records than the ring holds is always dropped.
+ *
+ * All the calls but the getters are for the simulation thread only.
+ */
+class AsyncTraceWriter
+{
+public:
+  /// Bytes of text in a record
+  static const uint32_t RECORD_TEXT = 254;
+
+  /// c-tor
+  AsyncTraceWriter ();
+  /// Closes the file
+  ~AsyncTraceWriter ();
+
+  /**
+   * \brief Creates the file and starts the writer thread
+   * \param nRecords records of the ring, rounded up to a power of 2
+   * \param writeSize bytes the thread buffers before it writes
+   */
+  bool Open (std::string path, uint32_t nRecords = 16384, TracePolicy policy = KDTM_TRACE_BLOCK,
+             uint32_t writeSize = 1 << 20);
+
+  bool IsOpen () const {
+    return m_file != 0;
+  }
+
+  TracePolicy GetPolicy () const {
+    return m_policy;
+  }
+
+  /// Enqueues a text, after the pending text of the stream; false if dropped
+  bool Write (char const *text, size_t size);
+  bool Write (std::string const & text)
+  {
+    return Write (text.data (), text.size ());
+  }
+
+  /**
+   * \brief Stream of the file, for the Print functions
+   *
+   * The text is enqueued by record, the last one on std::flush, std::endl,
+   * Write, Flush or Close.  Under KDTM_TRACE_DROP it is held until then and
+   * enqueued or dropped whole.
+   */
+  std::ostream & GetStream ()
+  {
+    return m_stream;
+  }
+
+  /// Waits until all the text is written to the file
+  void Flush ();
+  /// Writes the pending text, stops the thread and closes the file
+  void Close ();
+
+  /// Number of records enqueued
+  uint64_t GetNRecords () const {
+    return m_nRecords;
+  }
+
+  /// Number of records dropped
+  uint64_t GetNDropped () const {
+    return m_nDropped;
+  }
+
+  /// Number of texts the simulation waited for room for
+  uint64_t GetNStalls () const {
+    return m_nStalls;
+  }
+
+  /// Number of writes to the file by the thread
+  uint64_t GetNWrites () const {
+    return m_nWrites.load (std::memory_order_relaxed);
+  }
+
+private:
+  AsyncTraceWriter (AsyncTraceWriter const &);
+  AsyncTraceWriter & operator= (AsyncTraceWriter const &);
+
+  /// One slot of the ring, 256 bytes
+  struct Record
+  {
+    uint16_t size;
+    char text[RECORD_TEXT];
+  };
+
+  /// Buffers the text of the stream in one record, or all of it under
+  /// KDTM_TRACE_DROP
+  class StreamBuffer : public std::streambuf
+  {
+  public:
+    StreamBuffer (AsyncTraceWriter *writer);
+    /// Enqueues the pending text
+    void Commit ();
+
+  protected:
+    int_type overflow (int_type c);
+    int sync ();
+
+  private:
+    AsyncTraceWriter *m_writer;
+    std::vector<char> m_text;
+  };
+
+  /// Enqueues a text without the pending text of the stream
+  bool Enqueue (char const *text, size_t size);
+  /// Free records of the ring, from the producer side
+  uint64_t GetFree ();
+  /// Body of the writer thread
+  void Drain ();
+  /// Writes the buffer of the thread to the file
+  void WriteBuffer ();
+
+  FILE *m_file;
+  TracePolicy m_policy;
+  std::vector<Record> m_ring;
+  uint64_t m_mask;
+  std::vector<char> m_buffer;   // of the thread
+  size_t m_writeSize;
+  std::thread m_thread;
+  std::atomic<bool> m_stop;
+
+  // Written by the thread, read by the simulation
+  alignas (64) std::atomic<uint64_t> m_head;     // next record to drain
+  std::atomic<uint64_t> m_written;               // records in the file
+  std::atomic<uint64_t> m_nWrites;
+  // Written by the simulation, read by the thread
+  alignas (64) std::atomic<uint64_t> m_tail;     // next free record
+  uint64_t m_cachedHead;
+  uint64_t m_nRecords;
+  uint64_t m_nDropped;
+  uint64_t m_nStalls;
+
+  StreamBuffer m_streamBuffer;
+  std::ostream m_stream;
+};
+
+} // kdtm
+} // ns3
+
+#endif /* KDTM_TRACE_WRITER_H */
@@ -0,0 +1,362 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "kdtm-trace.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("KdtmTrace");
+
+namespace ns3 {
+namespace kdtm {
+
+/// Record of the temporary spool file of MobilityTraceWriter
+struct MobilityTraceSpoolRecord
+{
+  uint32_t vehicle;
+  MobilityTraceRecord record;
+};
+
+//-----------------------------------------------------------------------------
+// Writer
+//-----------------------------------------------------------------------------
+MobilityTraceWriter::MobilityTraceWriter ()
+  : m_spool (0),
+    m_nRecords (0)
+{
+}
+
+MobilityTraceWriter::~MobilityTraceWriter ()
+{
+  if (m_spool)
+    {
+      fclose (m_spool);
+      unlink ((m_path + ".tmp").c_str ());
+    }
+}
+
+bool
+MobilityTraceWriter::Open (std::string path)
+{
+  m_path = path;
+  m_spool = fopen ((path + ".tmp").c_str (), "w+b");
+  if (!m_spool)
+    {
+      NS_LOG_ERROR ("Can not create " << path << ".tmp");
+      return false;
+    }
+
+  std::memset (&m_header, 0, sizeof (m_header));
+  std::memcpy (m_header.magic, MobilityTraceStreamer::GetMagic (), sizeof (m_header.magic));
+  m_header.version = MobilityTraceStreamer::GetVersion ();
+  m_header.tMin = m_header.xMin = m_header.yMin = std::numeric_limits<double>::max ();
+  m_header.tMax = m_header.xMax = m_header.yMax = - std::numeric_limits<double>::max ();
+  m_nRecords = 0;
+  m_index.clear ();
+  return true;
+}
+
+bool
+MobilityTraceWriter::Add (uint32_t vehicle, double time, double x, double y)
+{
+  if (vehicle >= m_index.size ())
+    {
+      MobilityTraceIndex empty = { 0, 0, 0, 0 };
+      m_index.resize (vehicle + 1, empty);
+    }
+
+  MobilityTraceIndex & index = m_index[vehicle];
+  if (index.nRecords > 0 && time <= index.tEnd)
+    {
+      NS_LOG_WARN ("Vehicle " << vehicle << " record at " << time << " is not after " << index.tEnd);
+      return false;
+    }
+
+  MobilityTraceSpoolRecord spool;
+  spool.vehicle = vehicle;
+  spool.record.time = time;
+  spool.record.x = x;
+  spool.record.y = y;
+  if (fwrite (&spool, sizeof (spool), 1, m_spool) != 1)
+    {
+      return false;
+    }
+
+  if (index.nRecords == 0)
+    {
+      index.tBegin = time;
+    }
+  index.tEnd = time;
+  index.nRecords++;
+  m_nRecords++;
+
+  m_header.tMin = std::min (m_header.tMin, time);
+  m_header.tMax = std::max (m_header.tMax, time);
+  m_header.xMin = std::min (m_header.xMin, x);
+  m_header.xMax = std::max (m_header.xMax, x);
+  m_header.yMin = std::min (m_header.yMin, y);
+  m_header.yMax = std::max (m_header.yMax, y);
+  return true;
+}
+
+bool
+MobilityTraceWriter::Finish ()
+{
+  m_header.nVehicles = m_index.size ();
+  m_header.nRecords = m_nRecords;
+
+  std::vector<uint64_t> cursors (m_index.size ());
+  uint64_t first = 0;
+  for (uint32_t v = 0; v < m_index.size (); v++)
+    {
+      m_index[v].firstRecord = first;
+      cursors[v] = first;
+      first += m_index[v].nRecords;
+    }
+
+  size_t headerSize = sizeof (MobilityTraceHeader) + m_index.size () * sizeof (MobilityTraceIndex);
+  size_t size = headerSize + m_nRecords * sizeof (MobilityTraceRecord);
+
+  int fd = open (m_path.c_str (), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate (fd, size) != 0)
+    {
+      NS_LOG_ERROR ("Can not create " << m_path);
+      if (fd >= 0)
+        {
+          close (fd);
+        }
+      return false;
+    }
+  void *mapping = mmap (0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close (fd);
+  if (mapping == MAP_FAILED)
+    {
+      NS_LOG_ERROR ("Can not map " << m_path);
+      return false;
+    }
+
+  char *base = static_cast<char *> (mapping);
+  std::memcpy (base, &m_header, sizeof (m_header));
+  if (!m_index.empty ())
+    {
+      std::memcpy (base + sizeof (m_header), &m_index[0], m_index.size () * sizeof (MobilityTraceIndex));
+    }
+  MobilityTraceRecord *records = reinterpret_cast<MobilityTraceRecord *> (base + headerSize);
+
+  // Scatter the spooled records at the place of their vehicle
+  rewind (m_spool);
+  std::vector<MobilityTraceSpoolRecord> block (4096);
+  size_t n;
+  while ((n = fread (&block[0], sizeof (MobilityTraceSpoolRecord), block.size (), m_spool)) > 0)
+    {
+      for (size_t k = 0; k < n; k++)
+        {
+          records[cursors[block[k].vehicle]++] = block[k].record;
+        }
+    }
+
+  munmap (mapping, size);
+  fclose (m_spool);
+  m_spool = 0;
+  unlink ((m_path + ".tmp").c_str ());
+
+  NS_LOG_INFO ("Wrote " << m_index.size () << " vehicles and " << m_nRecords << " records to " << m_path);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Streamer
+//-----------------------------------------------------------------------------
+MobilityTraceStreamer::MobilityTraceStreamer ()
+  : m_mapping (0),
+    m_mappingSize (0),
+    m_header (0),
+    m_index (0),
+    m_records (0),
+    m_chunkSize (16),
+    m_parking (Vector (-1e6, -1e6, 0))
+{
+}
+
+MobilityTraceStreamer::~MobilityTraceStreamer ()
+{
+  Close ();
+}
+
+bool
+MobilityTraceStreamer::Open (std::string path)
+{
+  Close ();
+
+  int fd = open (path.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      NS_LOG_ERROR ("Can not open " << path);
+      return false;
+    }
+  struct stat st;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (MobilityTraceHeader))
+    {
+      close (fd);
+      NS_LOG_ERROR (path << " is not a mobility trace");
+      return false;
+    }
+  m_mappingSize = st.st_size;
+  m_mapping = mmap (0, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (m_mapping == MAP_FAILED)
+    {
+      m_mapping = 0;
+      NS_LOG_ERROR ("Can not map " << path);
+      return false;
+    }
+  // Vehicles are read in an order driven by simulated time, not by offset
+  madvise (m_mapping, m_mappingSize, MADV_RANDOM);
+
+  char const *base = static_cast<char const *> (m_mapping);
+  m_header = reinterpret_cast<MobilityTraceHeader const *> (base);
+  size_t headerSize = sizeof (MobilityTraceHeader) + m_header->nVehicles * sizeof (MobilityTraceIndex);
+  if (std::memcmp (m_header->magic, GetMagic (), sizeof (m_header->magic)) != 0
+      || m_header->version != GetVersion ()
+      || m_mappingSize < headerSize
+      || m_header->nRecords > (m_mappingSize - headerSize) / sizeof (MobilityTraceRecord))
+    {
+      NS_LOG_ERROR (path << " is not a version " << GetVersion () << " mobility trace");
+      Close ();
+      return false;
+    }
+  m_index = reinterpret_cast<MobilityTraceIndex const *> (base + sizeof (MobilityTraceHeader));
+  m_records = reinterpret_cast<MobilityTraceRecord const *> (base + headerSize);
+
+  // Load and GetFirstPosition trust the index, it must stay in the records
+  for (uint32_t v = 0; v < m_header->nVehicles; v++)
+    {
+      MobilityTraceIndex const & index = m_index[v];
+      if (index.firstRecord > m_header->nRecords
+          || index.nRecords > m_header->nRecords - index.firstRecord
+          || !(index.tBegin <= index.tEnd))
+        {
+          NS_LOG_ERROR (path << ": invalid index of vehicle " << v);
+          Close ();
+          return false;
+        }
+    }
+
+  NS_LOG_INFO ("Mapped " << path << ": " << m_header->nVehicles << " vehicles, "
+               << m_header->nRecords << " records");
+  return true;
+}
+
+void
+MobilityTraceStreamer::Close ()
+{
+  if (m_mapping)
+    {
+      munmap (m_mapping, m_mappingSize);
+    }
+  m_mapping = 0;
+  m_mappingSize = 0;
+  m_header = 0;
+  m_index = 0;
+  m_records = 0;
+}
+
+void
+MobilityTraceStreamer::Install (NodeContainer nodes)
+{
+  NS_ASSERT (m_header);
+  uint32_t n = std::min (nodes.GetN (), m_header->nVehicles);
+  m_cursors.resize (n);
+
+  for (uint32_t v = 0; v < n; v++)
+    {
+      Cursor & cursor = m_cursors[v];
+      cursor.next = m_index[v].firstRecord;
+      cursor.end = m_index[v].firstRecord + m_index[v].nRecords;
+      cursor.model = CreateObject<WaypointMobilityModel> ();
+      cursor.model->SetPosition (m_parking);
+      nodes.Get (v)->AggregateObject (cursor.model);
+
+      if (m_index[v].nRecords > 0)
+        {
+          Time start = Seconds (m_index[v].tBegin) - Simulator::Now ();
+          Simulator::Schedule (start.IsPositive () ? start : Seconds (0),
+                               &MobilityTraceStreamer::Load, this, v);
+        }
+    }
+}
+
+bool
+MobilityTraceStreamer::IsActive (uint32_t vehicle) const
+{
+  if (!m_header || vehicle >= m_cursors.size () || m_index[vehicle].nRecords == 0)
+    {
+      return false;
+    }
+  double now = Simulator::Now ().GetSeconds ();
+  return m_index[vehicle].tBegin <= now && now <= m_index[vehicle].tEnd;
+}
+
+Vector
+MobilityTraceStreamer::GetFirstPosition (uint32_t vehicle) const
+{
+  NS_ASSERT (m_header && vehicle < m_header->nVehicles);
+  if (m_index[vehicle].nRecords == 0)
+    {
+      return m_parking;
+    }
+  MobilityTraceRecord const & first = m_records[m_index[vehicle].firstRecord];
+  return Vector (first.x, first.y, 0);
+}
+
+void
+MobilityTraceStreamer::Load (uint32_t vehicle)
+{
+  Cursor & cursor = m_cursors[vehicle];
+
+  if (cursor.next == m_index[vehicle].firstRecord)
+    {
+      // Jump from the parking position to the first record
+      MobilityTraceRecord const & first = m_records[cursor.next];
+      cursor.model->SetPosition (Vector (first.x, first.y, 0));
+    }
+
+  uint64_t last = std::min (cursor.end, cursor.next + m_chunkSize);
+  for (; cursor.next < last; cursor.next++)
+    {
+      MobilityTraceRecord const & record = m_records[cursor.next];
+      cursor.model->AddWaypoint (Waypoint (Seconds (record.time), Vector (record.x, record.y, 0)));
+    }
+
+  // Refill when the vehicle heads to the last waypoint it has, or park it
+  // once it reached the end of its trace.
+  Time next;
+  if (cursor.next < cursor.end)
+    {
+      next = Seconds (m_records[cursor.next - 2].time) - Simulator::Now ();
+      Simulator::Schedule (next.IsPositive () ? next : Seconds (0),
+                           &MobilityTraceStreamer::Load, this, vehicle);
+    }
+  else
+    {
+      next = Seconds (m_records[cursor.end - 1].time) - Simulator::Now ();
+      Simulator::Schedule (next.IsPositive () ? next : Seconds (0),
+                           &MobilityTraceStreamer::Park, this, vehicle);
+    }
+}
+
+void
+MobilityTraceStreamer::Park (uint32_t vehicle)
+{
+  Cursor & cursor = m_cursors[vehicle];
+  cursor.model->EndMobility ();
+  cursor.model->SetPosition (m_parking);
+}
+
+} // kdtm
+} // ns3
@@ -0,0 +1,222 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef KDTM_TRACE_H
+#define KDTM_TRACE_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ns3/node-container.h"
+#include "ns3/waypoint-mobility-model.h"
+#include "ns3/vector.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+namespace kdtm {
+
+/**
+ * \ingroup kdtm
+ * \brief Indexed binary mobility trace
+ *
+ * The file is meant to be memory mapped, all the fields are stored in host
+ * byte order:
+ *
+ \verbatim
+   MobilityTraceHeader
+   MobilityTraceIndex  x nVehicles   (vehicle i at position i)
+   MobilityTraceRecord x nRecords    (grouped by vehicle, ascending time)
+ \endverbatim
+ */
+struct MobilityTraceHeader
+{
+  char magic[8];        // "KDTMTRC1"
+  uint32_t version;
+  uint32_t nVehicles;
+  uint64_t nRecords;
+  double tMin;
+  double tMax;
+  double xMin;
+  double xMax;
+  double yMin;
+  double yMax;
+};
+
+/// Records of one vehicle
+struct MobilityTraceIndex
+{
+  uint64_t firstRecord;
+  uint64_t nRecords;
+  double tBegin;
+  double tEnd;
+};
+
+/// Position of a vehicle at a given time, the vehicle moves in straight
+/// line between two records
+struct MobilityTraceRecord
+{
+  double time;
+  double x;
+  double y;
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Builds an indexed binary mobility trace from records in any order
+ * of vehicles
+ *
+ * Records are spooled to a temporary file with the output path and a ".tmp"
+ * suffix while only the number of records per vehicle is kept in memory.
+ * Finish () then scatters them at their place in the output file, so the
+ * conversion of a trace of any size needs memory proportional to the number
+ * of vehicles only.  The records of a vehicle must be added in ascending
+ * time order.
+ */
+class MobilityTraceWriter
+{
+public:
+  /// c-tor
+  MobilityTraceWriter ();
+  ~MobilityTraceWriter ();
+
+  /**
+   * \brief Opens the output trace
+   * \return false if the temporary file can not be created
+   */
+  bool Open (std::string path);
+
+  /**
+   * \brief Adds a record
+   * \param vehicle dense index of the vehicle, starting at 0
+   * \return false if the record is older than the last one of the vehicle,
+   * the record is then dropped
+   */
+  bool Add (uint32_t vehicle, double time, double x, double y);
+
+  /**
+   * \brief Writes the output trace and removes the temporary file
+   * \return false on I/O error
+   */
+  bool Finish ();
+
+  uint64_t GetNRecords () const {
+    return m_nRecords;
+  }
+
+private:
+  std::string m_path;
+  FILE *m_spool;
+  uint64_t m_nRecords;
+  std::vector<MobilityTraceIndex> m_index;
+  MobilityTraceHeader m_header;
+};
+
+/**
+ * \ingroup kdtm
+ * \brief Mobility source streaming the waypoints of a binary mobility trace
+ *
+ * The trace is memory mapped, opening it does not read the records.  Each
+ * vehicle gets a WaypointMobilityModel that is fed at most "chunk size"
+ * waypoints at a time: the next chunk is read from the mapping when the
+ * vehicle reaches the last but one waypoint it was given.  The memory used
+ * is thus proportional to the number of vehicles active at the same time
+ * and not to the length of the trace.
+ *
+ * Before its first record and after its last one a vehicle stands at the
+ * parking position, far from the road.
+ */
+class MobilityTraceStreamer
+{
+public:
+  /// c-tor
+  MobilityTraceStreamer ();
+  ~MobilityTraceStreamer ();
+
+  /**
+   * \brief Maps a trace written by MobilityTraceWriter
+   * \return false if the file can not be mapped or is not a valid trace
+   */
+  bool Open (std::string path);
+
+  /**
+   * \brief Unmaps the trace
+   */
+  void Close ();
+
+  /**
+   * \brief Streams vehicle i of the trace on node i of the container
+   *
+   * A WaypointMobilityModel is aggregated to every node, the trace must stay
+   * open until the end of the simulation.
+   */
+  void Install (NodeContainer nodes);
+
+  /// \return true if the vehicle is in the trace at the current time
+  bool IsActive (uint32_t vehicle) const;
+
+  /// \return first position of a vehicle in the trace
+  Vector GetFirstPosition (uint32_t vehicle) const;
+
+  uint32_t GetNVehicles () const {
+    return m_header ? m_header->nVehicles : 0;
+  }
+
+  MobilityTraceHeader const * GetHeader () const {
+    return m_header;
+  }
+
+  uint32_t GetChunkSize () const {
+    return m_chunkSize;
+  }
+
+  void SetChunkSize (uint32_t chunkSize)
+  {
+    m_chunkSize = chunkSize < 2 ? 2 : chunkSize;
+  }
+
+  Vector GetParkingPosition () const {
+    return m_parking;
+  }
+
+  void SetParkingPosition (Vector parking)
+  {
+    m_parking = parking;
+  }
+
+  static const char * GetMagic ()
+  {
+    return "KDTMTRC1";
+  }
+
+  static uint32_t GetVersion ()
+  {
+    return 1;
+  }
+
+private:
+  /// Streaming state of a vehicle
+  struct Cursor
+  {
+    uint64_t next;   // next record to give to the model
+    uint64_t end;    // one past the last record of the vehicle
+    Ptr<WaypointMobilityModel> model;
+  };
+
+  void *m_mapping;
+  size_t m_mappingSize;
+  MobilityTraceHeader const *m_header;
+  MobilityTraceIndex const *m_index;
+  MobilityTraceRecord const *m_records;
+
+  uint32_t m_chunkSize;
+  Vector m_parking;
+  std::vector<Cursor> m_cursors;
+
+  /// Gives the next chunk of waypoints of a vehicle to its model
+  void Load (uint32_t vehicle);
+  /// Moves a vehicle which left the trace to the parking position
+  void Park (uint32_t vehicle);
+};
+
+} // kdtm
+} // ns3
+#endif /* KDTM_TRACE_H */
@@ -1,6 +1,7 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
 #include "kdtm-wqueue.h"
+#include "kdtm-snapshot.h"
 #include "ns3/log.h"
 #include <algorithm>
 
@@ -32,78 +33,102 @@ QueueEntry::QueueEntry (Vector position, Time backofftime,
 
 /// Queue
 Queue::Queue ()
+	:	m_maxLen (0),
+		m_queueTimeOut (Seconds (0))
 {
 }
 
 void
-Queue::Add (QueueEntry entry)
+Queue::Save (std::ostream & os) const
 {
-	m_queue[entry.GetMessageId ()].push_front (entry);
-}
+	SnapshotWrite (os, m_maxLen);
+	SnapshotWrite (os, m_queueTimeOut);
 
-void
-Queue::Purge (uint32_t messageId)
-{
-	m_queue.erase (messageId);
-}
-
-bool 
-Queue::Find (uint32_t messageId, uint32_t prevId)
-{
-	std::map<uint32_t, std::list<QueueEntry>>::iterator i = m_queue.find (messageId);
-	if (i != m_queue.end ())
+	uint32_t nMessages = m_queue.size ();
+	SnapshotWrite (os, nMessages);
+	std::map<uint32_t, MessageCopies>::const_iterator i = m_queue.begin ();
+	for (; i != m_queue.end (); i++)
 		{
-			std::list<QueueEntry>::iterator j = i->second.begin ();
-			for (; j!=i->second.end (); j++)
+			uint32_t nEntries = i->second.entries.size ();
+			SnapshotWrite (os, i->first);
+			SnapshotWrite (os, nEntries);
+			std::list<QueueEntry>::const_iterator j = i->second.entries.begin ();
+			for (; j != i->second.entries.end (); j++)
 				{
-					if (j->GetPrevHopId () == prevId)
+					uint8_t forwarded = j->GetForwarded ();
+					uint32_t size = j->GetPacket ()->GetSize ();
+					std::vector<uint8_t> bytes (size);
+					if (size > 0)
 						{
-							return true;
+							j->GetPacket ()->CopyData (&bytes[0], size);
 						}
+					SnapshotWrite (os, j->GetPosition ());
+					SnapshotWrite (os, j->GetBackOffTime ());
+					SnapshotWrite (os, j->GetSourceId ());
+					SnapshotWrite (os, j->GetPrevHopId ());
+					SnapshotWrite (os, j->GetHopCount ());
+					SnapshotWrite (os, forwarded);
+					SnapshotWrite (os, size);
+					os.write (reinterpret_cast<char const *> (bytes.data ()), size);
 				}
 		}
-		return false;
 }
 
-bool 
-Queue::Exist (uint32_t messageId)
+bool
+Queue::Load (std::istream & is)
 {
-	if (m_queue.find (messageId) != m_queue.end ())
-		return true;
+	m_queue.clear ();
+	uint32_t nMessages;
+	if (!(SnapshotRead (is, m_maxLen)
+		&& SnapshotRead (is, m_queueTimeOut)
+		&& SnapshotRead (is, nMessages)))
+		{
+			return false;
+		}
 
-	return false;
+	for (uint32_t m = 0; m < nMessages; m++)
+		{
+			uint32_t messageId, nEntries;
+			if (!(SnapshotRead (is, messageId) && SnapshotRead (is, nEntries)))
+				{
+					m_queue.clear ();
+					return false;
+				}
+			MessageCopies & copies = m_queue[messageId];
+			for (uint32_t k = 0; k < nEntries; k++)
+				{
+					Vector position;
+					Time backOffTime;
+					uint32_t sourceId, prevHopId, hopCount, size;
+					uint8_t forwarded;
+					if (!(SnapshotRead (is, position)
+						&& SnapshotRead (is, backOffTime)
+						&& SnapshotRead (is, sourceId)
+						&& SnapshotRead (is, prevHopId)
+						&& SnapshotRead (is, hopCount)
+						&& SnapshotRead (is, forwarded)
+						&& SnapshotRead (is, size)))
+						{
+							m_queue.clear ();
+							return false;
+						}
+					std::vector<uint8_t> bytes (size);
+					if (!is.read (reinterpret_cast<char *> (bytes.data ()), size))
+						{
+							m_queue.clear ();
+							return false;
+						}
+					QueueEntry entry (position, Seconds (0),
+						Create<Packet> (bytes.data (), size),
+						sourceId, messageId, prevHopId, hopCount, forwarded != 0);
+					entry.SetBackOffTime (backOffTime);
+					copies.sumx += position.x;
+					copies.sumy += position.y;
+					copies.entries.push_back (entry);
+				}
+		}
+	return true;
 }
 
-
-Vector 
-Queue::CalculateSpatialDist (uint32_t setId)
-{
-  std::list<QueueEntry> set = m_queue[setId];
-
-	std::list<QueueEntry>::const_iterator i = set.begin ();
-
-	Vector spatialDist;
-
-  spatialDist.x = 0;
-  spatialDist.y = 0;
-
-  if (!(set.empty ()))
-    {
-      double sumx = 0;
-      double sumy = 0;
-
-      for (; i != set.end (); i++)
-        {
-          sumx += i->GetPosition ().x;
-          sumy += i->GetPosition ().y;      
-        }
-
-      spatialDist.x =  ((double) 1/set.size ()) * sumx;
-      spatialDist.y =  ((double) 1/set.size ()) * sumy;  
-    }
-
-  return spatialDist;
 }
-
 }
-}
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/simulator.h"
 #include "kdtm-packet.h"
+#include "kdtm-copy-queue.h"
 #include "ns3/enum.h"
 #include "ns3/nstime.h"
 #include "ns3/vector.h"
@@ -125,7 +126,20 @@ private:
 
 };
 
-class Queue
+/// Rebroadcast decision taken for a message, see Queue::SetDecision
+struct QueueDecision
+{
+	double distanceToMean;  // to the mean position of the copies, in ranges
+	double threshold;
+	bool rebroadcast;
+	Time deadline;          // backoff expiry the decision was taken at
+};
+
+/**
+ * \brief Copies of the warnings heard by the node, the CopyQueue of the
+ * core holding the packets
+ */
+class Queue : public CopyQueue<QueueEntry, QueueDecision>
 {
 public:
 	/// Callback <Packet, nodeId>
@@ -137,20 +151,12 @@ public:
 	{
 	}
 
-	/// Add element to Queue
-	void Add (QueueEntry entry);
-
-	/// Delete messageID elements
-	void Purge (uint32_t messageId);
-
-	/// Find if entry already in queue
-	bool Find (uint32_t messageId, uint32_t prevId);
-
-	/// Find if entry exist
-	bool Exist (uint32_t messageId);
-
-	/// Calculate Spatial Distribution
-	Vector CalculateSpatialDist (uint32_t setId);
+	/// Calculate Spatial Distribution, the mean position of the copies
+	Vector CalculateSpatialDist (uint32_t setId) const
+	{
+		CoreVector mean = GetMeanPosition (setId);
+		return Vector (mean.x, mean.y, 0);
+	}
 
 	Time GetQueueTimeOut () const
 	{
@@ -162,26 +168,22 @@ public:
 		m_queueTimeOut = timeOut;
 	}
 
-	QueueEntry & GetEntry (uint32_t messageId)
-	{
-		return m_queue.find(messageId)->second.front ();
-	}
+	/**
+	 * \brief Writes the entries to a snapshot, packets included
+	 *
+	 * Backoff times are stored relative to the current time.
+	 */
+	void Save (std::ostream & os) const;
 
-	bool IsAlreadyForwarded (uint32_t messageId)
-	{
-		if (m_queue.find (messageId) != m_queue.end ())
-			{
-				return m_queue.find (messageId)->second.front ().GetForwarded ();
-			}
-		return false;
-	}
+	/**
+	 * \brief Replaces the queue by entries written by Save
+	 * \return false if the stream is truncated
+	 */
+	bool Load (std::istream & is);
 
 private:
 	uint32_t m_maxLen;
 	Time m_queueTimeOut;
-
-	/// Queue of entry: < message id, < sender id, < sender position, backofftimer, Packet>>
-	std::map<uint32_t, std::list<QueueEntry>> m_queue;
 };
 
 }
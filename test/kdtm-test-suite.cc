@@ -1,7 +1,31 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
 // Include a header file from your module to test.
-#include "ns3/kdtm.h"
+#include "ns3/kdtm-ptable.h"
+#include "ns3/kdtm-partition.h"
+#include "ns3/kdtm-trace.h"
+#include "ns3/kdtm-record.h"
+#include "ns3/kdtm-snapshot.h"
+#include "ns3/kdtm-wqueue.h"
+#include "ns3/kdtm-link-solver.h"
+#include "ns3/kdtm-kinetic-model.h"
+#include "ns3/kdtm-kinetic-degree.h"
+#include "ns3/kdtm-packet.h"
+#include "ns3/kdtm-replay.h"
+#include "ns3/kdtm-neighbor-summary.h"
+#include "ns3/kdtm-hello-scheduler.h"
+#include "ns3/kdtm-kpi.h"
+#include "ns3/kdtm-trace-writer.h"
+#include "ns3/kdtm-neighbor-table.h"
+#include "ns3/kdtm-copy-queue.h"
+#include "ns3/kdtm-codec.h"
+#include "ns3/simulator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "ns3/constant-position-mobility-model.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -9,6 +33,7 @@
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
 using namespace ns3;
+using namespace ns3::kdtm;
 
 // This is an example TestCase.
 class KdtmTestCase1 : public TestCase
@@ -46,6 +71,1748 @@ KdtmTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// Strips, owners and halo of the spatial partition used by distributed runs
+class KdtmPartitionTestCase : public TestCase
+{
+public:
+  KdtmPartitionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmPartitionTestCase::KdtmPartitionTestCase ()
+  : TestCase ("Kdtm spatial partition")
+{
+}
+
+void
+KdtmPartitionTestCase::DoRun (void)
+{
+  SpatialPartition partition (0, 4000, 4, 300);
+
+  NS_TEST_ASSERT_MSG_EQ (partition.GetOwner (Vector (10, 0, 0)), 0, "first strip");
+  NS_TEST_ASSERT_MSG_EQ (partition.GetOwner (Vector (2500, 0, 0)), 2, "third strip");
+  NS_TEST_ASSERT_MSG_EQ (partition.GetOwner (Vector (-50, 0, 0)), 0, "before the road");
+  NS_TEST_ASSERT_MSG_EQ (partition.GetOwner (Vector (4000, 0, 0)), 3, "end of the road");
+  NS_TEST_ASSERT_MSG_EQ (partition.GetOwner (Vector (9000, 0, 0)), 3, "after the road");
+  NS_TEST_ASSERT_MSG_EQ_TOL (partition.GetStripBegin (1), 1000, 1e-9, "strip begin");
+  NS_TEST_ASSERT_MSG_EQ_TOL (partition.GetStripEnd (1), 2000, 1e-9, "strip end");
+
+  NS_TEST_ASSERT_MSG_EQ (partition.IsInHalo (Vector (1000, 0, 0)), false, "empty extent");
+  partition.ExtendExtent (Vector (1200, 0, 0));
+  partition.ExtendExtent (Vector (1800, 0, 0));
+  NS_TEST_ASSERT_MSG_EQ (partition.IsInHalo (Vector (1500, 0, 0)), true, "inside the extent");
+  NS_TEST_ASSERT_MSG_EQ (partition.IsInHalo (Vector (2050, 0, 0)), true, "inside the halo");
+  NS_TEST_ASSERT_MSG_EQ (partition.IsInHalo (Vector (850, 0, 0)), false, "out of the halo");
+  partition.ResetExtent ();
+  NS_TEST_ASSERT_MSG_EQ (partition.IsInHalo (Vector (1500, 0, 0)), false, "reset extent");
+}
+
+// GetPosition answers from the table, MobilityPositionSource only reads the
+// mobility model of the nodes of its own rank
+class KdtmRemotePositionTestCase : public TestCase
+{
+public:
+  KdtmRemotePositionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmRemotePositionTestCase::KdtmRemotePositionTestCase ()
+  : TestCase ("Kdtm position of nodes of other ranks")
+{
+}
+
+void
+KdtmRemotePositionTestCase::DoRun (void)
+{
+  Ptr<Node> local = CreateObject<Node> (0);
+  Ptr<Node> remote = CreateObject<Node> (1);
+  Ptr<Node> unknown = CreateObject<Node> (1);
+  Ptr<Node> nodes[] = { local, remote, unknown };
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector (100 * (i + 1), 0, 0));
+      nodes[i]->AggregateObject (mobility);
+    }
+
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  table.AddEntry (remote->GetId (), Vector (190, 5, 0), Vector (0, 0, 0), Seconds (0), 0, Seconds (0));
+
+  Vector position = table.GetPosition (local->GetId ());
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, PositionTable::GetInvalidPosition ().x, 1e-9,
+                             "local node not in the table");
+  MobilityPositionSource source (0);
+  table.GetCore ().SetPositionSource (&source);
+  position = table.GetPosition (local->GetId ());
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, 100, 1e-9, "local node read from its mobility model");
+  position = table.GetPosition (remote->GetId ());
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, 190, 1e-9, "remote node read from the table");
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.y, 5, 1e-9, "remote node read from the table");
+  position = table.GetPosition (unknown->GetId ());
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, PositionTable::GetInvalidPosition ().x, 1e-9,
+                             "remote node not in the table");
+}
+
+// Positions dead-reckoned from the hellos, one by one and in batch
+class KdtmDeadReckoningTestCase : public TestCase
+{
+public:
+  KdtmDeadReckoningTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmDeadReckoningTestCase::KdtmDeadReckoningTestCase ()
+  : TestCase ("Kdtm dead-reckoned neighbor positions")
+{
+}
+
+void
+KdtmDeadReckoningTestCase::DoRun (void)
+{
+  ManualClock clock (SecondsToTableTime (10));
+  NeighborTable table (250, CoreVector (0, 0, 0), CoreVector (25, 0, 0));
+  table.SetClock (&clock);
+  for (uint32_t j = 0; j < 9; j++)
+    {
+      table.AddEntry (2 * j, CoreVector (-100.0 + 25 * j, 4.0 * (j % 3), 1), CoreVector (20.0 + j, -0.5 * j, 0),
+                      SecondsToTableTime (10 - 0.1 * j), 0.01, 0);
+    }
+
+  // One neighbor, at the clock or at any time
+  CoreVector position = table.GetPosition (4);
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, -50 + 22 * 0.2, 1e-9, "x at the clock");
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.y, 8 - 1 * 0.2, 1e-9, "y at the clock");
+  NS_TEST_ASSERT_MSG_EQ (position.z, 1, "z kept");
+  position = table.GetPosition (4, SecondsToTableTime (12));
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, -50 + 22 * 2.2, 1e-9, "x ahead");
+  NS_TEST_ASSERT_MSG_EQ (table.GetPosition (5, 0).x, NeighborTable::GetInvalidPosition ().x, "unknown");
+
+  // All of them, as one by one
+  std::vector<uint32_t> ids;
+  std::vector<double> x, y;
+  TableTime time = SecondsToTableTime (11.5);
+  NS_TEST_ASSERT_MSG_EQ (table.GetPositions (time, ids, x, y), 9, "all the neighbors");
+  for (uint32_t k = 0; k < ids.size (); k++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (ids[k], 2 * k, "ascending ids");
+      NS_TEST_ASSERT_MSG_EQ_TOL (x[k], table.GetPosition (ids[k], time).x, 1e-9, "same x");
+      NS_TEST_ASSERT_MSG_EQ_TOL (y[k], table.GetPosition (ids[k], time).y, 1e-9, "same y");
+    }
+
+  // The arrays follow the table
+  table.AddEntry (4, CoreVector (0, 0, 0), CoreVector (0, 0, 0), clock.Now (), 0.01, 0);
+  table.DeleteEntry (6);
+  table.GetPositions (time, ids, x, y);
+  NS_TEST_ASSERT_MSG_EQ (ids.size (), 8, "deleted neighbor");
+  NS_TEST_ASSERT_MSG_EQ (ids[2], 4, "updated neighbor");
+  NS_TEST_ASSERT_MSG_EQ (x[2], 0, "updated neighbor stands still");
+  clock.Set (SecondsToTableTime (1000));
+  table.Purge ();
+  NS_TEST_ASSERT_MSG_EQ (table.GetPositions (time, ids, x, y), table.GetEntries ().size (), "purged neighbors");
+}
+
+// Records written in any vehicle order are streamed back as waypoints
+class KdtmTraceTestCase : public TestCase
+{
+public:
+  KdtmTraceTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void CheckPosition (Ptr<Node> node, double x, double y, std::string msg);
+};
+
+KdtmTraceTestCase::KdtmTraceTestCase ()
+  : TestCase ("Kdtm binary mobility trace")
+{
+}
+
+void
+KdtmTraceTestCase::CheckPosition (Ptr<Node> node, double x, double y, std::string msg)
+{
+  Vector position = node->GetObject<MobilityModel> ()->GetPosition ();
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.x, x, 1e-6, msg);
+  NS_TEST_ASSERT_MSG_EQ_TOL (position.y, y, 1e-6, msg);
+}
+
+void
+KdtmTraceTestCase::DoRun (void)
+{
+  std::string path = CreateTempDirFilename ("kdtm-trace-test.kdtm");
+
+  MobilityTraceWriter writer;
+  NS_TEST_ASSERT_MSG_EQ (writer.Open (path), true, "open writer");
+  // vehicle 1 enters at 1 s, vehicle 0 drives 10 m/s from 2 s to 8 s
+  writer.Add (1, 1, 500, 0);
+  for (uint32_t t = 2; t <= 8; t++)
+    {
+      writer.Add (0, t, 10 * (t - 2), 4);
+    }
+  writer.Add (1, 3, 500, 20);
+  NS_TEST_ASSERT_MSG_EQ (writer.Add (1, 2, 0, 0), false, "record before the last one");
+  NS_TEST_ASSERT_MSG_EQ (writer.Finish (), true, "finish writer");
+
+  MobilityTraceStreamer streamer;
+  NS_TEST_ASSERT_MSG_EQ (streamer.Open (path), true, "open trace");
+  NS_TEST_ASSERT_MSG_EQ (streamer.GetNVehicles (), 2, "vehicles");
+  NS_TEST_ASSERT_MSG_EQ (streamer.GetHeader ()->nRecords, 9, "records");
+  NS_TEST_ASSERT_MSG_EQ_TOL (streamer.GetHeader ()->xMax, 500, 1e-9, "bounds");
+  NS_TEST_ASSERT_MSG_EQ_TOL (streamer.GetFirstPosition (0).y, 4, 1e-9, "first position");
+
+  // Small chunks force several refills of vehicle 0
+  streamer.SetChunkSize (2);
+  NodeContainer nodes;
+  nodes.Create (2);
+  streamer.Install (nodes);
+
+  Vector parking = streamer.GetParkingPosition ();
+  Simulator::Schedule (Seconds (0.5), &KdtmTraceTestCase::CheckPosition, this,
+                       nodes.Get (0), parking.x, parking.y, "parked before its trace");
+  Simulator::Schedule (Seconds (2.0), &KdtmTraceTestCase::CheckPosition, this,
+                       nodes.Get (0), 0, 4, "first record");
+  Simulator::Schedule (Seconds (6.5), &KdtmTraceTestCase::CheckPosition, this,
+                       nodes.Get (0), 45, 4, "interpolated after refills");
+  Simulator::Schedule (Seconds (2.0), &KdtmTraceTestCase::CheckPosition, this,
+                       nodes.Get (1), 500, 10, "second vehicle");
+  Simulator::Schedule (Seconds (9.0), &KdtmTraceTestCase::CheckPosition, this,
+                       nodes.Get (0), parking.x, parking.y, "parked after its trace");
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  streamer.Close ();
+
+  // Index entries out of the records or ending before they begin fail the
+  // open, the index of vehicle 1 follows the header and the one of vehicle 0
+  FILE *file = fopen (path.c_str (), "r+b");
+  long offset = sizeof (MobilityTraceHeader) + sizeof (MobilityTraceIndex);
+  MobilityTraceIndex index;
+  fseek (file, offset, SEEK_SET);
+  NS_TEST_ASSERT_MSG_EQ (fread (&index, sizeof (index), 1, file), 1, "read index");
+  MobilityTraceIndex damaged = index;
+  damaged.nRecords = 9;
+  fseek (file, offset, SEEK_SET);
+  fwrite (&damaged, sizeof (damaged), 1, file);
+  fflush (file);
+  NS_TEST_ASSERT_MSG_EQ (streamer.Open (path), false, "records past the end");
+  damaged = index;
+  damaged.tEnd = damaged.tBegin - 1;
+  fseek (file, offset, SEEK_SET);
+  fwrite (&damaged, sizeof (damaged), 1, file);
+  fflush (file);
+  NS_TEST_ASSERT_MSG_EQ (streamer.Open (path), false, "end before the beginning");
+  fseek (file, offset, SEEK_SET);
+  fwrite (&index, sizeof (index), 1, file);
+  fclose (file);
+  NS_TEST_ASSERT_MSG_EQ (streamer.Open (path), true, "index restored");
+  streamer.Close ();
+  std::remove (path.c_str ());
+}
+
+// Dissemination records spanning several blocks are read back unchanged
+class KdtmRecordTestCase : public TestCase
+{
+public:
+  KdtmRecordTestCase ();
+  virtual ~KdtmRecordTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmRecordTestCase::KdtmRecordTestCase ()
+  : TestCase ("Kdtm dissemination records")
+{
+}
+
+KdtmRecordTestCase::~KdtmRecordTestCase ()
+{
+}
+
+void
+KdtmRecordTestCase::DoRun (void)
+{
+  std::string path = CreateTempDirFilename ("kdtm-record-test.bin");
+
+  DisseminationRecorder recorder;
+  NS_TEST_ASSERT_MSG_EQ (recorder.Open (path, 4), true, "open recorder");
+  for (uint32_t k = 0; k < 10; k++)
+    {
+      DisseminationRecord record;
+      record.time = 0.5 * k;
+      record.node = k;
+      record.messageId = 7;
+      record.hopCount = k / 3;
+      record.prevHop = k + 100;
+      record.x = 10.0 * k;
+      record.y = -1.5;
+      record.decision = k % 3;
+      record.threshold = 0.01 * k;
+      recorder.Record (record);
+    }
+  recorder.Close ();
+  NS_TEST_ASSERT_MSG_EQ (recorder.GetNRecords (), 10, "records written");
+
+  DisseminationReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (path), true, "open reader");
+  std::vector<DisseminationRecord> block;
+  uint32_t n = 0;
+  uint32_t nBlocks = 0;
+  while (reader.ReadBlock (block))
+    {
+      for (uint32_t k = 0; k < block.size (); k++, n++)
+        {
+          NS_TEST_ASSERT_MSG_EQ_TOL (block[k].time, 0.5 * n, 1e-12, "time");
+          NS_TEST_ASSERT_MSG_EQ (block[k].node, n, "node");
+          NS_TEST_ASSERT_MSG_EQ (block[k].messageId, 7, "message id");
+          NS_TEST_ASSERT_MSG_EQ (block[k].hopCount, n / 3, "hop count");
+          NS_TEST_ASSERT_MSG_EQ (block[k].prevHop, n + 100, "previous hop");
+          NS_TEST_ASSERT_MSG_EQ_TOL (block[k].x, 10.0 * n, 1e-12, "x");
+          NS_TEST_ASSERT_MSG_EQ_TOL (block[k].y, -1.5, 1e-12, "y");
+          NS_TEST_ASSERT_MSG_EQ ((uint32_t) block[k].decision, n % 3, "decision");
+          NS_TEST_ASSERT_MSG_EQ_TOL (block[k].threshold, 0.01 * n, 1e-12, "threshold");
+        }
+      nBlocks++;
+    }
+  NS_TEST_ASSERT_MSG_EQ (n, 10, "records read");
+  NS_TEST_ASSERT_MSG_EQ (nBlocks, 3, "blocks of 4, 4 and 2 records");
+  reader.Close ();
+
+  // A damaged record count is not allocated, after magic, version and
+  // block size
+  FILE *file = fopen (path.c_str (), "r+b");
+  uint32_t damaged = 0x7fffffff;
+  fseek (file, 16, SEEK_SET);
+  fwrite (&damaged, sizeof (damaged), 1, file);
+  fclose (file);
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (path), true, "reopen reader");
+  NS_TEST_ASSERT_MSG_EQ (reader.ReadBlock (block), false, "block larger than the block size");
+  NS_TEST_ASSERT_MSG_EQ (block.empty (), true, "nothing read");
+  reader.Close ();
+  std::remove (path.c_str ());
+}
+
+// Tables and queues restored from a snapshot behave as the saved ones,
+// with their times shifted
+class KdtmSnapshotTestCase : public TestCase
+{
+public:
+  KdtmSnapshotTestCase ();
+  virtual ~KdtmSnapshotTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmSnapshotTestCase::KdtmSnapshotTestCase ()
+  : TestCase ("Kdtm snapshot and restore")
+{
+}
+
+KdtmSnapshotTestCase::~KdtmSnapshotTestCase ()
+{
+}
+
+void
+KdtmSnapshotTestCase::DoRun (void)
+{
+  PositionTable table (250, Vector (100, 0, 0), Vector (30, 0, 0));
+  table.SetTrajectoryBegin (Seconds (-40));
+  table.SetPoissonCoeff (120);
+  table.AddEntry (1000, Vector (50, 4, 0), Vector (25, 0, 0), Seconds (20), 1.0 / 200, Seconds (-10));
+  table.AddEntry (1001, Vector (300, 8, 0), Vector (-30, 0, 0), Seconds (20), 1.0 / 300, Seconds (-70));
+
+  Queue queue;
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (WarningHeader (3, 4, 2, 9, 120, 8));
+  queue.Add (QueueEntry (Vector (120, 8, 0), Seconds (0.01), packet, 3, 9, 4, 2));
+  queue.Add (QueueEntry (Vector (180, 0, 0), Seconds (0.02), packet->Copy (), 3, 9, 5, 2));
+
+  std::stringstream snapshot;
+  WriteSnapshotHeader (snapshot, Seconds (20), 1);
+  table.Save (snapshot);
+  queue.Save (snapshot);
+
+  Time time;
+  uint32_t nNodes;
+  NS_TEST_ASSERT_MSG_EQ (ReadSnapshotHeader (snapshot, time, nNodes), true, "header");
+  NS_TEST_ASSERT_MSG_EQ (time, Seconds (20), "snapshot time");
+  NS_TEST_ASSERT_MSG_EQ (nNodes, 1, "snapshot nodes");
+
+  // Restore the state of 20 s at 5 s
+  PositionTable restoredTable (100, Vector (0, 0, 0), Vector (0, 0, 0));
+  Queue restoredQueue;
+  NS_TEST_ASSERT_MSG_EQ (restoredTable.Load (snapshot, Seconds (-15)), true, "load table");
+  NS_TEST_ASSERT_MSG_EQ (restoredQueue.Load (snapshot), true, "load queue");
+
+  NS_TEST_ASSERT_MSG_EQ_TOL (restoredTable.GetMaxRange (), 250, 1e-12, "range");
+  NS_TEST_ASSERT_MSG_EQ_TOL (restoredTable.GetPoissonCoeff (), table.GetPoissonCoeff (), 1e-12, "Poisson coefficient");
+  NS_TEST_ASSERT_MSG_EQ (restoredTable.GetTrajectoryBegin (), Seconds (-55), "trajectory begin");
+  NS_TEST_ASSERT_MSG_EQ (restoredTable.isNeighbour (1001), true, "entry");
+  NS_TEST_ASSERT_MSG_EQ_TOL (restoredTable.CalculateDegree (Seconds (6)), table.CalculateDegree (Seconds (21)),
+                             1e-9, "degree");
+  NS_TEST_ASSERT_MSG_EQ_TOL (restoredTable.CalculateThreshold (Seconds (7)), table.CalculateThreshold (Seconds (22)),
+                             1e-9, "threshold");
+
+  NS_TEST_ASSERT_MSG_EQ (restoredQueue.Find (9, 5), true, "queue entry");
+  Vector mean = restoredQueue.CalculateSpatialDist (9);
+  NS_TEST_ASSERT_MSG_EQ_TOL (mean.x, 150, 1e-9, "spatial distribution");
+  QueueEntry & entry = restoredQueue.GetEntry (9);
+  NS_TEST_ASSERT_MSG_EQ (entry.GetPrevHopId (), 5, "entry order");
+  NS_TEST_ASSERT_MSG_EQ (entry.GetPacket ()->GetSize (), packet->GetSize (), "packet size");
+  WarningHeader warning;
+  entry.GetPacket ()->Copy ()->RemoveHeader (warning);
+  NS_TEST_ASSERT_MSG_EQ (warning.GetMessageId (), 9, "packet contents");
+
+  std::stringstream truncated (snapshot.str ().substr (0, 40));
+  NS_TEST_ASSERT_MSG_EQ (ReadSnapshotHeader (truncated, time, nNodes), true, "truncated header");
+  NS_TEST_ASSERT_MSG_EQ (restoredTable.Load (truncated, Seconds (0)), false, "truncated table");
+}
+
+// Link windows are only recomputed when the relative kinematics drift
+class KdtmLinkWindowTestCase : public TestCase
+{
+public:
+  KdtmLinkWindowTestCase ();
+  virtual ~KdtmLinkWindowTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmLinkWindowTestCase::KdtmLinkWindowTestCase ()
+  : TestCase ("Kdtm cached link windows")
+{
+}
+
+KdtmLinkWindowTestCase::~KdtmLinkWindowTestCase ()
+{
+}
+
+void
+KdtmLinkWindowTestCase::DoRun (void)
+{
+  PositionTable table (250, Vector (0, 0, 0), Vector (30, 0, 0));
+  table.UpdateMyKinematics (Seconds (10), Vector (300, 0, 0), Vector (30, 0, 0));
+
+  // 100 m ahead, 10 m/s slower: in range from 0 s (clamped) to 45 s
+  table.AddEntry (1, Vector (400, 0, 0), Vector (20, 0, 0), Seconds (10), 0, Seconds (0));
+  std::pair<Time, Time> window = table.GetLinkWindow (1);
+  NS_TEST_ASSERT_MSG_EQ_TOL (window.first.GetSeconds (), 0, 1e-6, "from");
+  NS_TEST_ASSERT_MSG_EQ_TOL (window.second.GetSeconds (), 45, 1e-6, "to");
+
+  // 0.5 m off the prediction: kept
+  table.UpdateMyKinematics (Seconds (11), Vector (330, 0, 0), Vector (30, 0, 0));
+  table.AddEntry (1, Vector (420.5, 0, 0), Vector (20, 0, 0), Seconds (11), 0, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ (table.GetLinkWindow (1).second, window.second, "window kept");
+
+  // 5 m off: recomputed
+  table.AddEntry (1, Vector (425, 0, 0), Vector (20, 0, 0), Seconds (11), 0, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ_TOL (table.GetLinkWindow (1).second.GetSeconds (), 45.5, 1e-6, "window moved");
+
+  // The node stops: the window is recomputed from the extrapolated neighbor,
+  // as a fresh table would do it
+  table.UpdateMyKinematics (Seconds (12), Vector (360, 0, 0), Vector (0, 0, 0));
+  PositionTable fresh (250, Vector (360, 0, 0), Vector (0, 0, 0));
+  fresh.AddEntry (1, Vector (445, 0, 0), Vector (20, 0, 0), Seconds (12), 0, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ_TOL (table.GetLinkWindow (1).second.GetSeconds (),
+                             fresh.GetLinkWindow (1).second.GetSeconds (), 1e-9, "own kinematics");
+  NS_TEST_ASSERT_MSG_EQ_TOL (table.GetLinkWindow (1).second.GetSeconds (), 20.25, 1e-6, "stopped");
+  NS_TEST_ASSERT_MSG_EQ (table.GetLinkWindow (2).second, Seconds (0), "unknown neighbor");
+
+  // Nearly equal velocities: the end, 3.5e11 s away, does not fit in
+  // nanoseconds and is the infinity of a permanent link
+  PositionTable parallel (250, Vector (0, 0, 0), Vector (30, 0, 0));
+  parallel.AddEntry (3, Vector (100, 0, 0), Vector (30 + 1e-9, 0, 0), Seconds (10), 0, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ_TOL (parallel.GetLinkWindow (3).second.GetSeconds (), 510, 1e-6, "slow drift");
+  parallel.UpdateMyKinematics (Seconds (20), Vector (350, 0, 0), Vector (30 - 1e-9, 0, 0));
+  NS_TEST_ASSERT_MSG_EQ_TOL (parallel.GetLinkWindow (3).second.GetSeconds (), 520, 1e-6, "slow drift, batch");
+  NS_TEST_ASSERT_MSG_EQ (SecondsToTableTime (3.5e11), INT64_MAX, "saturated");
+  NS_TEST_ASSERT_MSG_EQ (SecondsToTableTime (-3.5e11), INT64_MIN, "saturated below");
+}
+
+// The batch link window solver agrees with PositionTable on the edge cases
+class KdtmLinkSolverTestCase : public TestCase
+{
+public:
+  KdtmLinkSolverTestCase ();
+  virtual ~KdtmLinkSolverTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmLinkSolverTestCase::KdtmLinkSolverTestCase ()
+  : TestCase ("Kdtm batch link window solver")
+{
+}
+
+KdtmLinkSolverTestCase::~KdtmLinkSolverTestCase ()
+{
+}
+
+void
+KdtmLinkSolverTestCase::DoRun (void)
+{
+  // Node at the origin driving 30 m/s towards +x, neighbors at time 10 s
+  Vector myPosition (0, 0, 0);
+  Vector myVelocity (30, 0, 0);
+  const uint32_t n = 7;
+  Vector positions[n] = {
+    Vector (100, 0, 0),     // parallel motion
+    Vector (0, 250, 0),     // tangential pass, now
+    Vector (-300, 250, 0),  // tangential pass, 10 s ago
+    Vector (-400, 0, 0),    // already out of range, behind
+    Vector (400, 0, 0),     // out of range, coming
+    Vector (0, 400, 0),     // never in range
+    Vector (100, 50, 0)     // in range
+  };
+  Vector velocities[n] = {
+    Vector (30, 0, 0),
+    Vector (0, 0, 0),
+    Vector (0, 0, 0),
+    Vector (0, 0, 0),
+    Vector (0, 0, 0),
+    Vector (0, 0, 0),
+    Vector (-20, 3, 0)
+  };
+
+  double dx[n], dy[n], dvx[n], dvy[n], from[n], to[n];
+  for (uint32_t k = 0; k < n; k++)
+    {
+      dx[k] = myPosition.x - positions[k].x;
+      dy[k] = myPosition.y - positions[k].y;
+      dvx[k] = myVelocity.x - velocities[k].x;
+      dvy[k] = myVelocity.y - velocities[k].y;
+    }
+  SolveLinkWindows (n, dx, dy, dvx, dvy, 250, 10, 500, from, to);
+
+  for (uint32_t k = 0; k < n; k++)
+    {
+      PositionTable table (250, myPosition, myVelocity);
+      table.AddEntry (k, positions[k], velocities[k], Seconds (10), 0, Seconds (0));
+      std::pair<Time, Time> window = table.GetLinkWindow (k);
+      NS_TEST_ASSERT_MSG_EQ_TOL (from[k], window.first.GetSeconds (), 1e-6, "from of case " << k);
+      NS_TEST_ASSERT_MSG_EQ_TOL (to[k], window.second.GetSeconds (), 1e-6, "to of case " << k);
+    }
+
+  NS_TEST_ASSERT_MSG_EQ_TOL (to[0], 510, 1e-9, "parallel");
+  NS_TEST_ASSERT_MSG_EQ_TOL (from[1], 10, 1e-9, "tangential from");
+  NS_TEST_ASSERT_MSG_EQ_TOL (to[1], 10, 1e-9, "tangential to");
+  NS_TEST_ASSERT_MSG_EQ_TOL (to[2], 0, 1e-6, "past tangential");
+  NS_TEST_ASSERT_MSG_EQ_TOL (from[3], 0, 1e-9, "left, clamped at the start");
+  NS_TEST_ASSERT_MSG_EQ_TOL (to[3], 5, 1e-6, "left");
+  NS_TEST_ASSERT_MSG_EQ_TOL (from[4], 15, 1e-6, "coming from");
+  NS_TEST_ASSERT_MSG_EQ_TOL (to[4], 10 + 650.0 / 30, 1e-6, "coming to");
+  NS_TEST_ASSERT_MSG_EQ_TOL (to[5], 510, 1e-9, "never in range");
+
+  // Nearly equal velocities: the root of the end, 3.5e11 s away, is capped
+  // at infinity as in PositionTable
+  double ndx = -100, ndy = 0, ndvx = 1e-9, ndvy = 0;
+  double nfrom, nto;
+  SolveLinkWindows (1, &ndx, &ndy, &ndvx, &ndvy, 250, 0, 500, &nfrom, &nto);
+  NS_TEST_ASSERT_MSG_EQ_TOL (nfrom, 0, 1e-9, "slow drift from");
+  NS_TEST_ASSERT_MSG_EQ_TOL (nto, 500, 1e-9, "slow drift capped");
+}
+
+// Policy tables compute the degree of their models, the default policies
+// those of PositionTable, and the run time models those of the templates
+class KdtmPolicyTestCase : public TestCase
+{
+public:
+  KdtmPolicyTestCase ();
+  virtual ~KdtmPolicyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmPolicyTestCase::KdtmPolicyTestCase ()
+  : TestCase ("Kdtm kinetic model policies")
+{
+}
+
+KdtmPolicyTestCase::~KdtmPolicyTestCase ()
+{
+}
+
+/// Fills a table with neighbors ahead of the node, only some of them in range at 15 s
+template <class Table>
+static void
+FillTable (Table & table)
+{
+  table.SetTrajectoryBegin (Seconds (-30));
+  table.UpdateMyKinematics (Seconds (10), Vector (0, 0, 0), Vector (30, 0, 0));
+  for (uint32_t j = 0; j < 5; j++)
+    {
+      // 20 m/s: leave the range at 10 + (50 j + 250) / 10 s
+      table.AddEntry (j, Vector (50.0 * j, 4, 0), Vector (20, 0, 0), Seconds (10), 1.0 / (100 + j), Seconds (- (double) j));
+    }
+}
+
+void
+KdtmPolicyTestCase::DoRun (void)
+{
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  BasicPositionTable<> defaultTable (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  BasicPositionTable<UnitStability, WindowDegree, ConstantThreshold>
+    windowTable (250, Vector (0, 0, 0), Vector (0, 0, 0), UnitStability (), WindowDegree (), ConstantThreshold (0.4));
+  FillTable (table);
+  FillTable (defaultTable);
+  FillTable (windowTable);
+
+  Time t = Seconds (36);
+  NS_TEST_ASSERT_MSG_EQ_TOL (defaultTable.CalculateDegree (t), table.CalculateDegree (t), 1e-12, "default degree");
+  NS_TEST_ASSERT_MSG_EQ_TOL (defaultTable.CalculateThreshold (t), table.CalculateThreshold (t), 1e-12, "default threshold");
+  // Windows end at 35, 40, 45, 50 and 55 s
+  NS_TEST_ASSERT_MSG_EQ_TOL (windowTable.CalculateDegree (t), 4, 1e-12, "neighbors in their window");
+  NS_TEST_ASSERT_MSG_EQ_TOL (windowTable.CalculateThreshold (t), 0.4, 1e-12, "constant threshold");
+
+  Ptr<KineticModel> model = CreateKineticModel ("poisson", "sigmoid", "exponential");
+  NS_TEST_ASSERT_MSG_EQ ((bool) model, true, "default model");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalculateDegree (table, t), table.CalculateDegree (t), 1e-12, "run time degree");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalculateThreshold (table, t), table.CalculateThreshold (t), 1e-12,
+                             "run time threshold");
+  model = CreateKineticModel ("unit", "window", "constant");
+  NS_TEST_ASSERT_MSG_EQ_TOL (model->CalculateDegree (table, t), 4, 1e-12, "run time window degree");
+  NS_TEST_ASSERT_MSG_EQ ((bool) CreateKineticModel ("poisson", "step", "exponential"), false, "unknown model");
+}
+
+class KdtmKineticDegreeTestCase : public TestCase
+{
+public:
+  KdtmKineticDegreeTestCase ();
+  virtual ~KdtmKineticDegreeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmKineticDegreeTestCase::KdtmKineticDegreeTestCase ()
+  : TestCase ("Kdtm kinetic degree curve")
+{
+}
+
+KdtmKineticDegreeTestCase::~KdtmKineticDegreeTestCase ()
+{
+}
+
+void
+KdtmKineticDegreeTestCase::DoRun (void)
+{
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  FillTable (table);
+
+  Ptr<KineticModel> model = CreateKineticModel ("poisson", "sigmoid", "exponential");
+  KineticDegreeCurve curve;
+  curve.SetHorizon (Seconds (10));
+  curve.Build (table, model, Seconds (30));
+  NS_TEST_ASSERT_MSG_EQ (curve.IsValid (table, Seconds (36)), true, "in the horizon");
+  NS_TEST_ASSERT_MSG_EQ (curve.IsValid (table, Seconds (41)), false, "after the horizon");
+
+  // Grid points are samples, the others are interpolated
+  Time t = Seconds (31.5);
+  NS_TEST_ASSERT_MSG_EQ_TOL (curve.GetDegree (t), model->CalculateDegree (table, t), 1e-12, "sampled degree");
+  t = Seconds (36.51);
+  NS_TEST_ASSERT_MSG_EQ_TOL (curve.GetDegree (t), model->CalculateDegree (table, t), 1e-3, "interpolated degree");
+  NS_TEST_ASSERT_MSG_EQ_TOL (curve.GetThreshold (t), model->CalculateThreshold (table, t), 1e-3,
+                             "interpolated threshold");
+
+  // Queries do not change the table, updates do
+  NS_TEST_ASSERT_MSG_EQ (curve.IsValid (table, Seconds (36)), true, "still valid");
+  table.AddEntry (9, Vector (10, 4, 0), Vector (30, 0, 0), Seconds (10), 0.01, Seconds (0));
+  NS_TEST_ASSERT_MSG_EQ (curve.IsValid (table, Seconds (36)), false, "invalidated by an update");
+  table.DeleteEntry (9);
+
+  // Windows end near 35 and 40 s: the degree jumps, the threshold goes down
+  model = CreateKineticModel ("unit", "window", "exponential");
+  curve.Build (table, model, Seconds (30));
+  Time exit0 = table.GetLinkWindow (0).second;
+  Time exit1 = table.GetLinkWindow (1).second;
+  NS_TEST_ASSERT_MSG_EQ_TOL (curve.GetDegree (exit0 - NanoSeconds (1)), 5, 1e-12, "before the exit");
+  NS_TEST_ASSERT_MSG_EQ_TOL (curve.GetDegree (exit0), 4, 1e-12, "at the exit");
+  NS_TEST_ASSERT_MSG_EQ_TOL (curve.GetDegree (Seconds (37.3)), 4, 1e-12, "after the exit");
+
+  Time below;
+  NS_TEST_ASSERT_MSG_EQ (curve.FindThresholdBelow (0.07, Seconds (30), below), true, "one exit");
+  NS_TEST_ASSERT_MSG_EQ (below, exit0, "time of one exit");
+  NS_TEST_ASSERT_MSG_EQ (curve.FindThresholdBelow (0.01, Seconds (30), below), true, "two exits");
+  NS_TEST_ASSERT_MSG_EQ (below, exit1, "time of two exits");
+  NS_TEST_ASSERT_MSG_EQ (curve.FindThresholdBelow (0.001, Seconds (30), below), false, "no crossing");
+}
+
+class KdtmDegreePruningTestCase : public TestCase
+{
+public:
+  KdtmDegreePruningTestCase ();
+  virtual ~KdtmDegreePruningTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmDegreePruningTestCase::KdtmDegreePruningTestCase ()
+  : TestCase ("Kdtm bounded-error degree pruning")
+{
+}
+
+KdtmDegreePruningTestCase::~KdtmDegreePruningTestCase ()
+{
+}
+
+void
+KdtmDegreePruningTestCase::DoRun (void)
+{
+  // Neighbors behind the node, closing in: windows begin from 10 s to 29 s
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  table.SetTrajectoryBegin (Seconds (-30));
+  table.UpdateMyKinematics (Seconds (10), Vector (0, 0, 0), Vector (20, 0, 0));
+  for (uint32_t j = 0; j < 20; j++)
+    {
+      table.AddEntry (j, Vector (-250.0 - 10 * j, 4, 0), Vector (30, 0, 0), Seconds (10), 1.0 / (100 + j), Seconds (- (double) j));
+    }
+
+  double errorBound;
+  Time t = Seconds (12);
+  double exact = table.CalculateDegree (t, errorBound);
+  NS_TEST_ASSERT_MSG_EQ (errorBound, 0, "exact by default");
+  NS_TEST_ASSERT_MSG_EQ_TOL (exact, table.CalculateDegree (t), 1e-12, "same degree");
+
+  double epsilons[3] = { 1e-9, 1e-4, 1e-2 };
+  double lastBound = 0;
+  for (uint32_t k = 0; k < 3; k++)
+    {
+      table.SetDegreeEpsilon (epsilons[k]);
+      double pruned = table.CalculateDegree (t, errorBound);
+      NS_TEST_ASSERT_MSG_LT (exact - pruned, errorBound + 1e-12, "error within the bound");
+      NS_TEST_ASSERT_MSG_GT (exact - pruned, -1e-12, "skipped terms are positive");
+      NS_TEST_ASSERT_MSG_LT (lastBound, errorBound + 1e-12, "more neighbors skipped");
+      lastBound = errorBound;
+    }
+  NS_TEST_ASSERT_MSG_GT (lastBound, 0, "neighbors skipped");
+
+  // Before the trajectory of a neighbor began its stability is not bounded
+  table.AddEntry (30, Vector (-600, 4, 0), Vector (30, 0, 0), Seconds (10), 0.01, Seconds (20));
+  table.CalculateDegree (t, errorBound);
+  NS_TEST_ASSERT_MSG_EQ (errorBound, 0, "no pruning");
+}
+
+class KdtmHelloFastPathTestCase : public TestCase
+{
+public:
+  KdtmHelloFastPathTestCase ();
+  virtual ~KdtmHelloFastPathTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmHelloFastPathTestCase::KdtmHelloFastPathTestCase ()
+  : TestCase ("Kdtm fast path of repeated hellos")
+{
+}
+
+KdtmHelloFastPathTestCase::~KdtmHelloFastPathTestCase ()
+{
+}
+
+void
+KdtmHelloFastPathTestCase::DoRun (void)
+{
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  table.UpdateMyKinematics (Seconds (10), Vector (0, 0, 0), Vector (30, 0, 0));
+  table.AddEntry (1, Vector (100, 4, 0), Vector (20, 0, 0), Seconds (10), 0.01, Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ (table.isNeighbour (1), true, "known neighbor");
+  NS_TEST_ASSERT_MSG_EQ (table.isNeighbour (2), false, "unknown neighbor");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNUpdates (), 0, "first hello");
+
+  // Hellos on the predicted trajectory, a bit off
+  uint64_t version = table.GetVersion ();
+  std::pair<Time, Time> window = table.GetLinkWindow (1);
+  table.AddEntry (1, Vector (120.3, 4, 0), Vector (20.05, 0, 0), Seconds (11), 0.01, Seconds (2));
+  table.AddEntry (1, Vector (140.6, 4, 0), Vector (20.05, 0, 0), Seconds (12), 0.01, Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ (table.GetNUpdates (), 2, "updates");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNFastUpdates (), 2, "fast updates");
+  NS_TEST_ASSERT_MSG_EQ (table.GetVersion (), version, "degree caches kept");
+  NS_TEST_ASSERT_MSG_EQ (table.GetLinkWindow (1).first, window.first, "window kept");
+  NS_TEST_ASSERT_MSG_EQ (table.GetLinkWindow (1).second, window.second, "window kept");
+
+  // 0.9 m off the anchor at every hello: the drift adds up to more than
+  // the tolerance
+  table.AddEntry (1, Vector (160.9, 4, 0), Vector (20, 0, 0), Seconds (13), 0.01, Seconds (2));
+  table.AddEntry (1, Vector (181.8, 4, 0), Vector (20, 0, 0), Seconds (14), 0.01, Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ (table.GetNFastUpdates (), 3, "drift from the anchor");
+  NS_TEST_ASSERT_MSG_EQ (table.GetVersion () != version, true, "entry updated");
+
+  // A new trajectory always updates the entry
+  version = table.GetVersion ();
+  table.AddEntry (1, Vector (201.8, 4, 0), Vector (20, 0, 0), Seconds (15), 0.01, Seconds (15));
+  NS_TEST_ASSERT_MSG_EQ (table.GetNFastUpdates (), 3, "new trajectory");
+  NS_TEST_ASSERT_MSG_EQ (table.GetVersion () != version, true, "entry updated");
+}
+
+class KdtmForwardWarningTestCase : public TestCase
+{
+public:
+  KdtmForwardWarningTestCase ();
+  virtual ~KdtmForwardWarningTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmForwardWarningTestCase::KdtmForwardWarningTestCase ()
+  : TestCase ("Kdtm in-place forwarding of warnings")
+{
+}
+
+KdtmForwardWarningTestCase::~KdtmForwardWarningTestCase ()
+{
+}
+
+/// Serialized bytes of a packet
+static std::vector<uint8_t>
+GetBytes (Ptr<const Packet> packet)
+{
+  std::vector<uint8_t> bytes (packet->GetSize ());
+  if (!bytes.empty ())
+    {
+      packet->CopyData (&bytes[0], bytes.size ());
+    }
+  return bytes;
+}
+
+void
+KdtmForwardWarningTestCase::DoRun (void)
+{
+  uint8_t payload[5] = { 1, 2, 3, 4, 5 };
+  for (uint32_t size = 0; size <= 5; size += 5)
+    {
+      Ptr<Packet> received = Create<Packet> (payload, size);
+      received->AddHeader (WarningHeader (7, 8, 3, 11, 0x0102030405060708ULL, 42));
+      received->AddHeader (TypeHeader (KDTM_WARNING));
+
+      // Slow path: remove, mutate, add back
+      Ptr<Packet> slow = received->Copy ();
+      TypeHeader type (KDTM_HELLO);
+      slow->RemoveHeader (type);
+      WarningHeader warning;
+      slow->RemoveHeader (warning);
+      warning.SetPrevHopId (9);
+      warning.SetHopCount (4);
+      warning.SetPostionx (0xfffffffffffffff0ULL);
+      warning.SetPositiony (1000);
+      slow->AddHeader (warning);
+      slow->AddHeader (type);
+
+      Ptr<Packet> fast = ForwardWarning (received, 9, 4, 0xfffffffffffffff0ULL, 1000);
+      NS_TEST_ASSERT_MSG_EQ ((bool) fast, true, "warning forwarded");
+      NS_TEST_ASSERT_MSG_EQ ((GetBytes (fast) == GetBytes (slow)), true, "same bytes as the slow path");
+      NS_TEST_ASSERT_MSG_EQ (received->GetSize (), 33 + size, "received packet unchanged");
+      NS_TEST_ASSERT_MSG_EQ ((GetBytes (ForwardWarning (received, 8, 3, 0x0102030405060708ULL, 42))
+                              == GetBytes (received)), true, "same fields, same bytes");
+    }
+
+  Ptr<Packet> hello = Create<Packet> ();
+  hello->AddHeader (HelloHeader (1));
+  hello->AddHeader (TypeHeader (KDTM_HELLO));
+  NS_TEST_ASSERT_MSG_EQ ((bool) ForwardWarning (hello, 9, 4, 0, 0), false, "not a warning");
+  NS_TEST_ASSERT_MSG_EQ ((bool) ForwardWarning (Create<Packet> (), 9, 4, 0, 0), false, "truncated");
+}
+
+class KdtmCompactWarningTestCase : public TestCase
+{
+public:
+  KdtmCompactWarningTestCase ();
+  virtual ~KdtmCompactWarningTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmCompactWarningTestCase::KdtmCompactWarningTestCase ()
+  : TestCase ("Kdtm compact warning header")
+{
+}
+
+KdtmCompactWarningTestCase::~KdtmCompactWarningTestCase ()
+{
+}
+
+void
+KdtmCompactWarningTestCase::DoRun (void)
+{
+  // One byte ids, then five byte ids
+  CompactWarningHeader small (7, 8, 3, 11, 1234.56, -20.04);
+  NS_TEST_ASSERT_MSG_EQ (small.GetSerializedSize (), 12, "small ids");
+  CompactWarningHeader large (0xffffffff, 300, 1000, 0x10000000, -214000.0, 214000.0);
+  NS_TEST_ASSERT_MSG_EQ (large.GetSerializedSize (), 21, "large ids");
+  NS_TEST_ASSERT_MSG_EQ (large.GetHopCount (), 255, "saturated hop count");
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (large);
+  packet->AddHeader (small);
+  packet->AddHeader (TypeHeader (KDTM_WARNING_COMPACT));
+  TypeHeader type (KDTM_HELLO);
+  packet->RemoveHeader (type);
+  NS_TEST_ASSERT_MSG_EQ (type.IsValid (), true, "compact type");
+  NS_TEST_ASSERT_MSG_EQ (type.Get (), KDTM_WARNING_COMPACT, "compact type");
+
+  CompactWarningHeader h;
+  packet->RemoveHeader (h);
+  NS_TEST_ASSERT_MSG_EQ (h.GetSourceId (), 7, "source");
+  NS_TEST_ASSERT_MSG_EQ (h.GetPrevHopId (), 8, "previous hop");
+  NS_TEST_ASSERT_MSG_EQ (h.GetHopCount (), 3, "hop count");
+  NS_TEST_ASSERT_MSG_EQ (h.GetMessageId (), 11, "message");
+  NS_TEST_ASSERT_MSG_EQ_TOL (h.GetPositionx (), 1234.6, 1e-9, "x, 0.1 m resolution");
+  NS_TEST_ASSERT_MSG_EQ_TOL (h.GetPositiony (), -20.0, 1e-9, "negative y");
+  packet->RemoveHeader (h);
+  NS_TEST_ASSERT_MSG_EQ (h.GetSourceId (), 0xffffffff, "large source");
+  NS_TEST_ASSERT_MSG_EQ (h.GetPrevHopId (), 300, "two byte previous hop");
+  NS_TEST_ASSERT_MSG_EQ (h.GetMessageId (), 0x10000000, "large message");
+  NS_TEST_ASSERT_MSG_EQ_TOL (h.GetPositionx (), -214000.0, 1e-9, "large negative x");
+  NS_TEST_ASSERT_MSG_EQ (h.IsValid (), true, "valid");
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 0, "all read");
+
+  // A source id of five bytes all continued is malformed
+  uint8_t malformed[16] = { 0xff, 0xff, 0xff, 0xff, 0xff };
+  Ptr<Packet> bad = Create<Packet> (malformed, sizeof (malformed));
+  bad->RemoveHeader (h);
+  NS_TEST_ASSERT_MSG_EQ (h.IsValid (), false, "malformed varint");
+  NS_TEST_ASSERT_MSG_EQ (h.GetSourceId (), 0xffffffff, "fields left as they were");
+
+  // Forwarding, with ids growing from one to two bytes
+  Ptr<Packet> received = Create<Packet> ();
+  received->AddHeader (small);
+  received->AddHeader (TypeHeader (KDTM_WARNING_COMPACT));
+  Ptr<Packet> slow = Create<Packet> ();
+  slow->AddHeader (CompactWarningHeader (7, 200, 4, 11, 1300.0, 4.0));
+  slow->AddHeader (TypeHeader (KDTM_WARNING_COMPACT));
+  Ptr<Packet> fast = ForwardCompactWarning (received, 200, 4, 1300.0, 4.0);
+  NS_TEST_ASSERT_MSG_EQ ((bool) fast, true, "compact warning forwarded");
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (fast) == GetBytes (slow)), true, "same bytes as the slow path");
+  NS_TEST_ASSERT_MSG_EQ ((bool) ForwardWarning (received, 200, 4, 1300, 4), false, "not a full warning");
+  NS_TEST_ASSERT_MSG_EQ (fast->GetSize () < 1 + WarningHeader ().GetSerializedSize (), true, "smaller");
+}
+
+class KdtmWarningBatchTestCase : public TestCase
+{
+public:
+  KdtmWarningBatchTestCase ();
+  virtual ~KdtmWarningBatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmWarningBatchTestCase::KdtmWarningBatchTestCase ()
+  : TestCase ("Kdtm warning batches")
+{
+}
+
+KdtmWarningBatchTestCase::~KdtmWarningBatchTestCase ()
+{
+}
+
+void
+KdtmWarningBatchTestCase::DoRun (void)
+{
+  // A full and a compact warning
+  std::vector<Ptr<Packet> > warnings;
+  warnings.push_back (Create<Packet> ());
+  warnings[0]->AddHeader (WarningHeader (7, 8, 3, 11, 1000, 2000));
+  warnings[0]->AddHeader (TypeHeader (KDTM_WARNING));
+  warnings.push_back (Create<Packet> ());
+  warnings[1]->AddHeader (CompactWarningHeader (9, 300, 1, 12, 1234.5, 4.0));
+  warnings[1]->AddHeader (TypeHeader (KDTM_WARNING_COMPACT));
+
+  Ptr<Packet> batch = AggregateWarnings (warnings);
+  NS_TEST_ASSERT_MSG_EQ ((bool) batch, true, "batch");
+  NS_TEST_ASSERT_MSG_EQ (batch->GetSize (), 1 + 3 + warnings[0]->GetSize () + warnings[1]->GetSize (),
+                         "type, count and sizes added");
+  TypeHeader type (KDTM_HELLO);
+  batch->PeekHeader (type);
+  NS_TEST_ASSERT_MSG_EQ (type.Get (), KDTM_WARNING_BATCH, "batch type");
+
+  std::vector<Ptr<Packet> > split;
+  NS_TEST_ASSERT_MSG_EQ (SplitWarnings (batch, split), true, "split");
+  NS_TEST_ASSERT_MSG_EQ (split.size (), 2, "two warnings");
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (split[0]) == GetBytes (warnings[0])), true, "full warning unchanged");
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (split[1]) == GetBytes (warnings[1])), true, "compact warning unchanged");
+
+  // A split warning is forwarded like a warning received alone
+  Ptr<Packet> forwarded = ForwardWarning (split[0], 5, 4, 1100, 2000);
+  NS_TEST_ASSERT_MSG_EQ ((bool) forwarded, true, "forwarded");
+  forwarded->RemoveHeader (type);
+  WarningHeader warning;
+  forwarded->RemoveHeader (warning);
+  NS_TEST_ASSERT_MSG_EQ (warning.GetMessageId (), 11, "message");
+  NS_TEST_ASSERT_MSG_EQ (warning.GetPrevHopId (), 5, "previous hop");
+
+  NS_TEST_ASSERT_MSG_EQ (SplitWarnings (warnings[0], split), false, "not a batch");
+  NS_TEST_ASSERT_MSG_EQ (split.size (), 0, "no warning");
+  Ptr<Packet> truncated = batch->CreateFragment (0, batch->GetSize () - 1);
+  NS_TEST_ASSERT_MSG_EQ (SplitWarnings (truncated, split), false, "truncated");
+
+  warnings.push_back (Create<Packet> (256));
+  NS_TEST_ASSERT_MSG_EQ ((bool) AggregateWarnings (warnings), false, "warning too large");
+}
+
+class KdtmNeighborStateTestCase : public TestCase
+{
+public:
+  KdtmNeighborStateTestCase ();
+  virtual ~KdtmNeighborStateTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmNeighborStateTestCase::KdtmNeighborStateTestCase ()
+  : TestCase ("Kdtm neighbor state carried by warnings")
+{
+}
+
+KdtmNeighborStateTestCase::~KdtmNeighborStateTestCase ()
+{
+}
+
+void
+KdtmNeighborStateTestCase::DoRun (void)
+{
+  double beta = 1.0 / 137;
+  Ptr<Packet> warning = Create<Packet> ();
+  warning->AddHeader (CompactWarningHeader (7, 8, 3, 11, 120.0, 4.0));
+  warning->AddHeader (TypeHeader (KDTM_WARNING_COMPACT));
+
+  Ptr<Packet> packet = warning->Copy ();
+  packet->AddHeader (NeighborStateHeader (20.0004, -1.5, Seconds (-2.5), beta, Vector (120.04, -3.26, 0)));
+  packet->AddHeader (TypeHeader (KDTM_NEIGHBOR_STATE));
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), warning->GetSize () + 33, "type and state added");
+
+  TypeHeader type (KDTM_HELLO);
+  packet->RemoveHeader (type);
+  NS_TEST_ASSERT_MSG_EQ (type.Get (), KDTM_NEIGHBOR_STATE, "state type");
+  NeighborStateHeader state;
+  packet->RemoveHeader (state);
+  NS_TEST_ASSERT_MSG_EQ_TOL (state.GetSpeedx (), 20.0, 1e-9, "x speed, 1 mm/s resolution");
+  NS_TEST_ASSERT_MSG_EQ_TOL (state.GetSpeedy (), -1.5, 1e-9, "negative y speed");
+  NS_TEST_ASSERT_MSG_EQ (state.GetTrajectoryBegin (), Seconds (-2.5), "exact trajectory begin");
+  NS_TEST_ASSERT_MSG_EQ (state.GetBeta (), beta, "exact beta");
+  NS_TEST_ASSERT_MSG_EQ_TOL (state.GetPosition ().x, 120.0, 1e-9, "x, 0.1 m resolution");
+  NS_TEST_ASSERT_MSG_EQ_TOL (state.GetPosition ().y, -3.3, 1e-9, "negative y, not clamped");
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (packet) == GetBytes (warning)), true, "warning frame unchanged");
+
+  // The state completed by the warning is the hello the sender would have
+  // sent: the entry is only refreshed
+  PositionTable table (250, Vector (0, 0, 0), Vector (0, 0, 0));
+  table.UpdateMyKinematics (Seconds (10), Vector (0, 0, 0), Vector (30, 0, 0));
+  table.AddEntry (8, Vector (100, 4, 0), Vector (20, -1.5, 0), Seconds (10), beta, Seconds (-2.5));
+  table.AddEntry (8, Vector (120, 2.5, 0), Vector (state.GetSpeedx (), state.GetSpeedy (), 0),
+                  Seconds (11), state.GetBeta (), state.GetTrajectoryBegin ());
+  NS_TEST_ASSERT_MSG_EQ (table.GetNFastUpdates (), 1, "entry refreshed by the warning");
+}
+
+class KdtmQueueDecisionTestCase : public TestCase
+{
+public:
+  KdtmQueueDecisionTestCase ();
+  virtual ~KdtmQueueDecisionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmQueueDecisionTestCase::KdtmQueueDecisionTestCase ()
+  : TestCase ("Kdtm cached rebroadcast decisions")
+{
+}
+
+KdtmQueueDecisionTestCase::~KdtmQueueDecisionTestCase ()
+{
+}
+
+void
+KdtmQueueDecisionTestCase::DoRun (void)
+{
+  Queue queue;
+  QueueDecision decision = QueueDecision ();
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDecision (9, decision), false, "unknown message");
+  queue.Add (QueueEntry (Vector (100, 8, 0), Seconds (0.01), Create<Packet> (), 3, 9, 4, 2));
+  queue.Add (QueueEntry (Vector (160, 0, 0), Seconds (0.02), Create<Packet> (), 3, 9, 5, 2));
+  queue.Add (QueueEntry (Vector (500, 0, 0), Seconds (0.02), Create<Packet> (), 3, 10, 5, 2));
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue.CalculateSpatialDist (9).x, 130, 1e-9, "mean x");
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue.CalculateSpatialDist (9).y, 4, 1e-9, "mean y");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDecision (9, decision), false, "no decision yet");
+
+  QueueDecision taken = { 0.3, 0.25, true, Seconds (1) };
+  queue.SetDecision (9, taken);
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDecision (9, decision), true, "cached");
+  NS_TEST_ASSERT_MSG_EQ_TOL (decision.distanceToMean, 0.3, 1e-12, "distance to mean");
+  NS_TEST_ASSERT_MSG_EQ (decision.rebroadcast, true, "decision");
+  NS_TEST_ASSERT_MSG_EQ (decision.deadline, Seconds (1), "deadline");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDecision (10, decision), false, "per message");
+
+  // A copy of another message keeps the decision, a copy of this one drops it
+  queue.Add (QueueEntry (Vector (700, 0, 0), Seconds (0.02), Create<Packet> (), 3, 10, 6, 2));
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDecision (9, decision), true, "other message");
+  queue.Add (QueueEntry (Vector (220, 4, 0), Seconds (0.02), Create<Packet> (), 3, 9, 6, 2));
+  NS_TEST_ASSERT_MSG_EQ (queue.GetDecision (9, decision), false, "invalidated");
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue.CalculateSpatialDist (9).x, 160, 1e-9, "mean updated");
+
+  queue.Purge (9);
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue.CalculateSpatialDist (9).x, 0, 1e-12, "purged");
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue.CalculateSpatialDist (10).x, 600, 1e-9, "other message kept");
+}
+
+class KdtmReplayTestCase : public TestCase
+{
+public:
+  KdtmReplayTestCase ();
+  virtual ~KdtmReplayTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmReplayTestCase::KdtmReplayTestCase ()
+  : TestCase ("Kdtm record and replay of the protocol core")
+{
+}
+
+KdtmReplayTestCase::~KdtmReplayTestCase ()
+{
+}
+
+void
+KdtmReplayTestCase::DoRun (void)
+{
+  DeliveryConfig config;
+  config.range = 250;
+  config.alpha = 10;
+  config.degreeEpsilon = 0;
+  config.stability = "poisson";
+  config.degree = "sigmoid";
+  config.threshold = "exponential";
+  config.trajectoryBegin.push_back (Seconds (-20));
+  config.trajectoryBegin.push_back (Seconds (-3.5));
+  Ptr<KineticModel> model = CreateKineticModel (config.stability, config.degree, config.threshold);
+
+  // The simulation: node 0 hears two neighbors then two copies of a warning
+  PositionTable table (config.range, Vector (0, 0, 0), Vector (0, 0, 0));
+  table.SetAlpha (config.alpha);
+  table.SetTrajectoryBegin (config.trajectoryBegin[0]);
+  Queue queue;
+  std::string path = CreateTempDirFilename ("kdtm-replay-test.bin");
+  DeliveryRecorder recorder;
+  NS_TEST_ASSERT_MSG_EQ (recorder.Open (path, config), true, "open recorder");
+  for (uint32_t j = 1; j <= 2; j++)
+    {
+      Time time = Seconds (10 + 0.1 * j);
+      Vector myPosition (30 * time.GetSeconds (), 0, 0);
+      table.UpdateMyKinematics (time, myPosition, Vector (30, 0, 0));
+      table.AddEntry (j, Vector (myPosition.x + 100 * j, 4, 0), Vector (25, 0, 0), time, 0.01, Seconds (-2.0 * j));
+      recorder.RecordHello (time, 0, myPosition, Vector (30, 0, 0), j, Vector (myPosition.x + 100 * j, 4, 0),
+                            Vector (25, 0, 0), 0.01, Seconds (-2.0 * j));
+    }
+  for (uint32_t j = 1; j <= 2; j++)
+    {
+      QueueEntry entry (Vector (300 + 50 * j, 0, 0), Seconds (0.01), Create<Packet> (), 1, 9, j, 2);
+      queue.Add (entry);
+      recorder.RecordWarning (Seconds (10.3), 0, entry, Seconds (0.01));
+    }
+  table.UpdateMyKinematics (Seconds (10.31), Vector (309.3, 0, 0), Vector (30, 0, 0));
+  QueueDecision decision = DecideRebroadcast (table, queue, *model, 9, Seconds (10.31), config.range);
+  recorder.RecordExpiry (Seconds (10.31), 0, Vector (309.3, 0, 0), Vector (30, 0, 0), 9, decision);
+  decision.rebroadcast = !decision.rebroadcast;
+  recorder.RecordExpiry (Seconds (10.32), 0, Vector (309.6, 0, 0), Vector (30, 0, 0), 9, decision);
+  recorder.Close ();
+  NS_TEST_ASSERT_MSG_EQ (recorder.GetNEvents (), 6, "events written");
+
+  DeliveryReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (path), true, "open reader");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetConfig ().degree, "sigmoid", "model names");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetConfig ().trajectoryBegin.size (), 2, "nodes");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetConfig ().trajectoryBegin[1], Seconds (-3.5), "trajectory begin");
+  std::vector<DeliveryEvent> events;
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (events), true, "events");
+  NS_TEST_ASSERT_MSG_EQ (events.size (), 6, "all events");
+  NS_TEST_ASSERT_MSG_EQ (events[1].type, KDTM_DELIVERY_HELLO, "hello");
+  NS_TEST_ASSERT_MSG_EQ (events[1].trajectoryBegin, Seconds (-4).GetNanoSeconds (), "hello trajectory begin");
+  NS_TEST_ASSERT_MSG_EQ (events[3].type, KDTM_DELIVERY_WARNING, "warning");
+  NS_TEST_ASSERT_MSG_EQ (events[3].id, 2, "previous hop");
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (events), false, "end of file");
+
+  // The replay takes the recorded decision, then sees the altered one
+  DeliveryReplay replay;
+  NS_TEST_ASSERT_MSG_EQ (replay.Configure (reader.GetConfig ()), true, "configure");
+  std::vector<bool> same;
+  reader.Open (path);
+  reader.Read (events);
+  for (uint32_t k = 0; k < events.size (); k++)
+    {
+      same.push_back (replay.Apply (events[k]));
+    }
+  NS_TEST_ASSERT_MSG_EQ (same[4], true, "same decision");
+  NS_TEST_ASSERT_MSG_EQ (same[5], false, "altered decision");
+  NS_TEST_ASSERT_MSG_EQ (replay.GetNDecisions (), 2, "decisions");
+  NS_TEST_ASSERT_MSG_EQ (replay.GetNMismatches (), 1, "mismatches");
+  reader.Close ();
+  std::remove (path.c_str ());
+}
+
+class KdtmTxErrorTestCase : public TestCase
+{
+public:
+  KdtmTxErrorTestCase ();
+  virtual ~KdtmTxErrorTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmTxErrorTestCase::KdtmTxErrorTestCase ()
+  : TestCase ("Kdtm neighbor eviction on MAC TX errors")
+{
+}
+
+KdtmTxErrorTestCase::~KdtmTxErrorTestCase ()
+{
+}
+
+void
+KdtmTxErrorTestCase::DoRun (void)
+{
+  // Two neighbors driving along with the node, their windows never end
+  PositionTable table (250, Vector (0, 0, 0), Vector (30, 0, 0));
+  table.AddEntry (1, Vector (100, 0, 0), Vector (30, 0, 0), Seconds (0), 0.01, Seconds (-10));
+  table.AddEntry (2, Vector (-100, 4, 0), Vector (30, 0, 0), Seconds (0), 0.01, Seconds (-10));
+  Mac48Address first = Mac48Address::Allocate ();
+  Mac48Address second = Mac48Address::Allocate ();
+  table.SetNeighborAddress (1, first);
+  table.SetNeighborAddress (2, second);
+  double degree = table.CalculateDegree (Seconds (1));
+
+  Callback<void, WifiMacHeader const &> txError = table.GetTxErrorCallback ();
+  WifiMacHeader header;
+  header.SetAddr1 (Mac48Address::GetBroadcast ());
+  txError (header);
+  header.SetAddr1 (Mac48Address::Allocate ());
+  txError (header);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNTxFailures (), 0, "broadcast and unknown receivers ignored");
+
+  header.SetAddr1 (first);
+  txError (header);
+  NS_TEST_ASSERT_MSG_EQ (table.IsSuspect (1), true, "suspect on the first failure");
+  NS_TEST_ASSERT_MSG_EQ (table.IsSuspect (2), false, "other neighbor");
+  NS_TEST_ASSERT_MSG_EQ (table.isNeighbour (1), true, "suspect kept");
+
+  // A hello of the neighbor clears its failures
+  uint64_t version = table.GetVersion ();
+  table.AddEntry (1, Vector (100, 0, 0), Vector (30, 0, 0), Seconds (0), 0.01, Seconds (-10));
+  NS_TEST_ASSERT_MSG_EQ (table.IsSuspect (1), false, "heard again");
+  NS_TEST_ASSERT_MSG_EQ (table.GetVersion (), version, "failures are not part of the version");
+
+  txError (header);
+  txError (header);
+  NS_TEST_ASSERT_MSG_EQ (table.isNeighbour (1), true, "below the limit");
+  txError (header);
+  NS_TEST_ASSERT_MSG_EQ (table.isNeighbour (1), false, "evicted at the limit");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNTxFailures (), 4, "failures");
+  txError (header);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNTxFailures (), 4, "evicted neighbor not reported");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNAddresses (), 1, "address of the evicted neighbor dropped");
+  NS_TEST_ASSERT_MSG_EQ (table.GetNEvictions (), 1, "evictions");
+  NS_TEST_ASSERT_MSG_EQ (table.GetVersion () != version, true, "eviction changes the version");
+  NS_TEST_ASSERT_MSG_EQ (table.CalculateDegree (Seconds (1)) < degree, true, "out of the degree");
+
+  // Successes reset the count, a limit of 0 never evicts
+  NS_TEST_ASSERT_MSG_EQ (table.ReportTxFailure (2), false, "first failure");
+  table.ReportTxSuccess (2);
+  NS_TEST_ASSERT_MSG_EQ (table.IsSuspect (2), false, "acknowledged");
+  table.SetTxFailureLimit (0);
+  for (uint32_t k = 0; k < 10; k++)
+    {
+      table.ReportTxFailure (2);
+    }
+  NS_TEST_ASSERT_MSG_EQ (table.isNeighbour (2), true, "no limit");
+  NS_TEST_ASSERT_MSG_EQ (table.ReportTxFailure (1), false, "evicted neighbor unknown");
+
+  // Addresses of neighbors that left without a TX error do not pile up
+  for (uint32_t k = 0; k < 100; k++)
+    {
+      table.SetNeighborAddress (100 + k, Mac48Address::Allocate ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (table.GetNAddresses () <= 3, true, "bounded by the table");
+  table.SetNeighborAddress (2, second);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNAddresses () <= 3, true, "neighbor address kept");
+  uint64_t failures = table.GetNTxFailures ();
+  header.SetAddr1 (second);
+  txError (header);
+  NS_TEST_ASSERT_MSG_EQ (table.GetNTxFailures (), failures + 1, "neighbor still reported");
+}
+
+class KdtmNeighborSummaryTestCase : public TestCase
+{
+public:
+  KdtmNeighborSummaryTestCase ();
+  virtual ~KdtmNeighborSummaryTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmNeighborSummaryTestCase::KdtmNeighborSummaryTestCase ()
+  : TestCase ("Kdtm two-hop neighbor summaries")
+{
+}
+
+KdtmNeighborSummaryTestCase::~KdtmNeighborSummaryTestCase ()
+{
+}
+
+void
+KdtmNeighborSummaryTestCase::DoRun (void)
+{
+  NeighborSummary empty;
+  NS_TEST_ASSERT_MSG_EQ (empty.MayContain (0), false, "empty summary");
+  NS_TEST_ASSERT_MSG_EQ (NeighborSummary::GetNWords (0, 8), 1, "at least a word");
+  NS_TEST_ASSERT_MSG_EQ (NeighborSummary::GetNWords (40, 8), 5, "8 bits per id");
+  NS_TEST_ASSERT_MSG_EQ (NeighborSummary::GetNWords (100000, 8), NeighborSummary::MAX_WORDS, "bounded");
+
+  // No false negative, few false positives at 8 bits per id
+  NeighborSummary summary (NeighborSummary::GetNWords (1000, 8));
+  for (uint32_t id = 0; id < 1000; id++)
+    {
+      summary.Add (id * 7);
+    }
+  uint32_t missed = 0;
+  uint32_t falsePositives = 0;
+  for (uint32_t id = 0; id < 1000; id++)
+    {
+      missed += !summary.MayContain (id * 7);
+      falsePositives += summary.MayContain (id * 7 + 1);
+    }
+  NS_TEST_ASSERT_MSG_EQ (missed, 0, "ids added are found");
+  NS_TEST_ASSERT_MSG_LT (falsePositives, 80, "false positive rate");
+
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (NeighborSummaryHeader (summary));
+  packet->AddHeader (TypeHeader (KDTM_NEIGHBOR_SUMMARY));
+  NS_TEST_ASSERT_MSG_EQ (packet->GetSize (), 2 + 8 * summary.GetNWords (), "type, count and words");
+  TypeHeader type (KDTM_HELLO);
+  packet->RemoveHeader (type);
+  NS_TEST_ASSERT_MSG_EQ (type.Get (), KDTM_NEIGHBOR_SUMMARY, "summary type");
+  NeighborSummaryHeader header;
+  packet->RemoveHeader (header);
+  NS_TEST_ASSERT_MSG_EQ ((header.GetSummary () == summary), true, "summary round trip");
+
+  // Node 0 hears a warning from 1, which reaches 2 but not 3
+  PositionTable table (250, Vector (0, 0, 0), Vector (30, 0, 0));
+  table.AddEntry (1, Vector (100, 0, 0), Vector (30, 0, 0), Seconds (0), 0.01, Seconds (-10));
+  table.AddEntry (2, Vector (-100, 0, 0), Vector (30, 0, 0), Seconds (0), 0.01, Seconds (-10));
+  table.AddEntry (3, Vector (-200, 4, 0), Vector (30, 0, 0), Seconds (0), 0.01, Seconds (-10));
+  NeighborSummary ofFirst (1);
+  ofFirst.Add (0);
+  ofFirst.Add (2);
+  std::vector<uint32_t> transmitters (1, 1);
+  NS_TEST_ASSERT_MSG_EQ (table.AddsCoverage (transmitters), true, "no summary, 1 only covers itself");
+  uint64_t version = table.GetVersion ();
+  table.SetNeighborSummary (1, ofFirst);
+  NS_TEST_ASSERT_MSG_EQ (table.GetVersion (), version, "summaries are not part of the version");
+  NS_TEST_ASSERT_MSG_EQ (table.AddsCoverage (transmitters), true, "3 not covered");
+  transmitters.push_back (3);
+  NS_TEST_ASSERT_MSG_EQ (table.AddsCoverage (transmitters), false, "3 heard too");
+  NS_TEST_ASSERT_MSG_EQ (table.CreateNeighborSummary ().MayContain (3), true, "own summary");
+
+  Queue queue;
+  queue.Add (QueueEntry (Vector (100, 0, 0), Seconds (0.01), Create<Packet> (), 5, 9, 1, 2));
+  queue.Add (QueueEntry (Vector (-200, 4, 0), Seconds (0.01), Create<Packet> (), 5, 9, 3, 2));
+  std::vector<uint32_t> prevHops = queue.GetPrevHops (9);
+  NS_TEST_ASSERT_MSG_EQ (prevHops.size (), 2, "copies");
+  NS_TEST_ASSERT_MSG_EQ (table.AddsCoverage (prevHops), false, "from the queue");
+  NS_TEST_ASSERT_MSG_EQ (queue.GetPrevHops (10).empty (), true, "unknown message");
+}
+
+class KdtmHelloSchedulerTestCase : public TestCase
+{
+public:
+  KdtmHelloSchedulerTestCase ();
+  virtual ~KdtmHelloSchedulerTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Records the hello and schedules the next one of the node
+  void Send (uint32_t node);
+
+  HelloScheduler m_scheduler;
+  std::vector<uint32_t> m_nodes;
+  std::vector<Time> m_times;
+  std::vector<Time> m_deadlines;
+};
+
+KdtmHelloSchedulerTestCase::KdtmHelloSchedulerTestCase ()
+  : TestCase ("Kdtm hellos sent by slot")
+{
+}
+
+KdtmHelloSchedulerTestCase::~KdtmHelloSchedulerTestCase ()
+{
+}
+
+void
+KdtmHelloSchedulerTestCase::Send (uint32_t node)
+{
+  m_nodes.push_back (node);
+  m_times.push_back (Simulator::Now ());
+  m_deadlines.push_back (m_scheduler.GetDeadline ());
+  if (m_nodes.size () <= 4)
+    {
+      m_scheduler.Schedule (node, m_scheduler.GetDeadline () + Seconds (1));
+    }
+}
+
+void
+KdtmHelloSchedulerTestCase::DoRun (void)
+{
+  m_scheduler.SetSlot (MilliSeconds (10));
+  m_scheduler.SetCallback (MakeCallback (&KdtmHelloSchedulerTestCase::Send, this));
+  m_scheduler.Schedule (1, MilliSeconds (1005));
+  m_scheduler.Schedule (2, MilliSeconds (1002));
+  m_scheduler.Schedule (3, MilliSeconds (1030));
+  m_scheduler.Schedule (4, MilliSeconds (1010));
+  Simulator::Run ();
+
+  // Slots ]1000, 1010] and ]1020, 1030], deadlines in order, phases kept
+  NS_TEST_ASSERT_MSG_EQ (m_nodes.size (), 8, "hellos");
+  NS_TEST_ASSERT_MSG_EQ (m_nodes[0], 2, "earliest deadline first");
+  NS_TEST_ASSERT_MSG_EQ (m_nodes[1], 1, "second deadline");
+  NS_TEST_ASSERT_MSG_EQ (m_nodes[2], 4, "end of the slot");
+  NS_TEST_ASSERT_MSG_EQ (m_times[0], MilliSeconds (1010), "sent at the end of the slot");
+  NS_TEST_ASSERT_MSG_EQ (m_times[2], MilliSeconds (1010), "same slot");
+  NS_TEST_ASSERT_MSG_EQ (m_deadlines[0], MilliSeconds (1002), "deadline");
+  NS_TEST_ASSERT_MSG_EQ (m_times[3], MilliSeconds (1030), "next slot");
+  NS_TEST_ASSERT_MSG_EQ (m_nodes[4], 2, "second round");
+  NS_TEST_ASSERT_MSG_EQ (m_deadlines[4], MilliSeconds (2002), "phase kept");
+  NS_TEST_ASSERT_MSG_EQ (m_times[4], MilliSeconds (2010), "second round slot");
+  NS_TEST_ASSERT_MSG_EQ (m_scheduler.GetNEvents (), 4, "an event per slot");
+  NS_TEST_ASSERT_MSG_EQ (m_scheduler.GetNHellos (), 8, "hellos counted");
+  NS_TEST_ASSERT_MSG_EQ (m_scheduler.GetLateness (), MilliSeconds (2 * (5 + 8 + 0 + 0)), "lateness");
+
+  // A hello due before the pending slot moves the event
+  m_scheduler.Schedule (5, Simulator::Now () + Seconds (2));
+  m_scheduler.Schedule (6, Simulator::Now () + Seconds (1));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_nodes.size (), 10, "both sent");
+  NS_TEST_ASSERT_MSG_EQ (m_nodes[8], 6, "earlier one first");
+  m_scheduler.Clear ();
+  Simulator::Destroy ();
+}
+
+class KdtmKpiTestCase : public TestCase
+{
+public:
+  KdtmKpiTestCase ();
+  virtual ~KdtmKpiTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmKpiTestCase::KdtmKpiTestCase ()
+  : TestCase ("Kdtm dissemination KPIs and log histograms")
+{
+}
+
+KdtmKpiTestCase::~KdtmKpiTestCase ()
+{
+}
+
+void
+KdtmKpiTestCase::DoRun (void)
+{
+  LogHistogram histogram (1e-3, 10, 8);
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetQuantile (0.5), 0, "empty");
+  for (uint32_t k = 1; k <= 1000; k++)
+    {
+      histogram.Add (k * 1e-3);
+    }
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetCount (), 1000, "count");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetMean (), 0.5005, 1e-9, "exact mean");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetMin (), 1e-3, 1e-12, "exact min");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetMax (), 1, 1e-12, "exact max");
+  double p50 = histogram.GetQuantile (0.5);
+  double p95 = histogram.GetQuantile (0.95);
+  NS_TEST_ASSERT_MSG_EQ ((p50 >= 0.5 && p50 <= 0.5 * std::pow (2, 1.0 / 8)), true, "median within a bucket");
+  NS_TEST_ASSERT_MSG_EQ ((p95 >= 0.95 && p95 <= 1), true, "p95 within a bucket, clamped to the max");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetQuantile (1), 1, 1e-12, "p100 is the max");
+
+  // Values out of the bounds are counted in the edge buckets
+  LogHistogram other (1e-3, 10, 8);
+  other.Add (0);
+  other.Add (1000);
+  NS_TEST_ASSERT_MSG_EQ (other.GetBucketCount (0), 1, "under min");
+  NS_TEST_ASSERT_MSG_EQ (other.GetBucketCount (other.GetNBuckets () - 1), 1, "over max");
+  histogram.Merge (other);
+  NS_TEST_ASSERT_MSG_EQ (histogram.GetCount (), 1002, "merged");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetMax (), 1000, 1e-9, "merged max");
+  NS_TEST_ASSERT_MSG_EQ_TOL (histogram.GetMin (), 0, 1e-12, "merged min");
+
+  std::vector<uint64_t> counts (other.GetNBuckets ());
+  for (uint32_t k = 0; k < counts.size (); k++)
+    {
+      counts[k] = 2 * other.GetBucketCount (k);
+    }
+  LogHistogram restored (1e-3, 10, 8);
+  restored.Restore (counts, 2 * other.GetSum (), 0, 1000);
+  NS_TEST_ASSERT_MSG_EQ (restored.GetCount (), 4, "restored count");
+  NS_TEST_ASSERT_MSG_EQ_TOL (restored.GetMean (), 500, 1e-9, "restored mean");
+
+  // Two warnings, the second one with no target area
+  DisseminationKpi kpi;
+  kpi.StartMessage (1, Seconds (30), 4);
+  kpi.StartMessage (2, Seconds (31), 0);
+  kpi.AddTransmission (1);
+  kpi.AddDelivery (1, Seconds (30.01), 1, true);
+  kpi.AddDelivery (1, Seconds (30.01), 1, true);
+  kpi.AddTransmission (1);
+  kpi.AddDelivery (1, Seconds (30.05), 2, true);
+  kpi.AddDelivery (1, Seconds (30.06), 2, false);
+  kpi.AddTransmission (2);
+  kpi.AddDelivery (2, Seconds (31.02), 1, false);
+  MessageKpi const *first = kpi.GetMessage (1);
+  NS_TEST_ASSERT_MSG_EQ ((first != 0), true, "known message");
+  NS_TEST_ASSERT_MSG_EQ (first->reachedTargets, 3, "targets reached");
+  NS_TEST_ASSERT_MSG_EQ (first->transmissions, 2, "transmissions");
+  NS_TEST_ASSERT_MSG_EQ (first->latency.GetCount (), 4, "deliveries");
+  NS_TEST_ASSERT_MSG_EQ_TOL (first->latency.GetMax (), 0.06, 1e-9, "latency from the start");
+  NS_TEST_ASSERT_MSG_EQ_TOL (first->hops.GetQuantile (0.5), 1, 1e-12, "median hop count");
+  NS_TEST_ASSERT_MSG_EQ ((kpi.GetMessage (3) == 0), true, "unknown message");
+  NS_TEST_ASSERT_MSG_EQ (kpi.GetNDeliveries (), 5, "run deliveries");
+  NS_TEST_ASSERT_MSG_EQ_TOL (kpi.GetCoverage (), 0.75, 1e-12, "run coverage");
+  NS_TEST_ASSERT_MSG_EQ_TOL (kpi.GetTransmissionsPerDelivery (), 0.6, 1e-12, "transmissions per delivery");
+  NS_TEST_ASSERT_MSG_EQ_TOL (kpi.GetHops ().GetMax (), 2, 1e-12, "run hops");
+
+  std::ostringstream os;
+  kpi.Write (os);
+  std::string text = os.str ();
+  NS_TEST_ASSERT_MSG_EQ (std::count (text.begin (), text.end (), '\n'), 4, "header, messages and run");
+  NS_TEST_ASSERT_MSG_EQ ((text.find ("\nrun 5 0.75 3 0.6 ") != std::string::npos), true, "run line");
+}
+
+class KdtmTraceWriterTestCase : public TestCase
+{
+public:
+  KdtmTraceWriterTestCase ();
+  virtual ~KdtmTraceWriterTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /// Content of a file
+  static std::string ReadFile (std::string path);
+};
+
+KdtmTraceWriterTestCase::KdtmTraceWriterTestCase ()
+  : TestCase ("Kdtm asynchronous trace writer")
+{
+}
+
+KdtmTraceWriterTestCase::~KdtmTraceWriterTestCase ()
+{
+}
+
+std::string
+KdtmTraceWriterTestCase::ReadFile (std::string path)
+{
+  std::ifstream is (path.c_str ());
+  std::ostringstream os;
+  os << is.rdbuf ();
+  return os.str ();
+}
+
+void
+KdtmTraceWriterTestCase::DoRun (void)
+{
+  std::string path = CreateTempDirFilename ("kdtm-trace-writer-test.txt");
+
+  // A ring of 4 records and a small write buffer: the simulation waits for
+  // the thread many times, nothing is lost nor reordered
+  AsyncTraceWriter writer;
+  NS_TEST_ASSERT_MSG_EQ (writer.Open (path, 3, KDTM_TRACE_BLOCK, 1000), true, "open writer");
+  std::ostringstream expected;
+  for (uint32_t k = 0; k < 2000; k++)
+    {
+      std::ostringstream line;
+      line << "line " << k << " " << std::string (k % 600, 'x') << "\n";
+      expected << line.str ();
+      if (k % 2)
+        {
+          NS_TEST_ASSERT_MSG_EQ (writer.Write (line.str ()), true, "blocking write");
+        }
+      else
+        {
+          writer.GetStream () << line.str ();
+        }
+    }
+  writer.Flush ();
+  NS_TEST_ASSERT_MSG_EQ ((ReadFile (path) == expected.str ()), true, "flushed text");
+  PositionTable table;
+  table.AddEntry (7, Vector (0, 0, 0), Vector (0, 0, 0), Seconds (0), 1, Seconds (0));
+  writer.GetStream () << table << "\n";
+  expected << table << "\n";
+  writer.Close ();
+  NS_TEST_ASSERT_MSG_EQ ((ReadFile (path) == expected.str ()), true, "written text");
+  NS_TEST_ASSERT_MSG_EQ (writer.GetNDropped (), 0, "nothing dropped");
+  NS_TEST_ASSERT_MSG_EQ ((writer.GetNWrites () > 1), true, "several writes");
+  NS_TEST_ASSERT_MSG_EQ (writer.Write ("closed"), false, "write after close");
+
+  // A text of more records than the ring holds is dropped whole
+  NS_TEST_ASSERT_MSG_EQ (writer.Open (path, 2, KDTM_TRACE_DROP), true, "reopen writer");
+  NS_TEST_ASSERT_MSG_EQ (writer.Write ("first\n"), true, "fits");
+  NS_TEST_ASSERT_MSG_EQ (writer.Write (std::string (3 * AsyncTraceWriter::RECORD_TEXT, 'y')), false,
+                         "does not fit");
+  writer.Flush ();
+  NS_TEST_ASSERT_MSG_EQ (writer.Write ("last\n"), true, "fits again");
+
+  // So is a text of the stream, not cut at the records which fit
+  writer.Flush ();
+  writer.GetStream () << std::string (2 * AsyncTraceWriter::RECORD_TEXT, 'z') << "z\n" << std::flush;
+  NS_TEST_ASSERT_MSG_EQ (writer.GetNDropped (), 6, "stream text dropped whole");
+  writer.Flush ();
+  std::string text = "stream " + std::string (AsyncTraceWriter::RECORD_TEXT, 's') + "\n";
+  writer.GetStream () << text << std::flush;
+  writer.Close ();
+  NS_TEST_ASSERT_MSG_EQ (writer.GetNDropped (), 6, "records dropped");
+  NS_TEST_ASSERT_MSG_EQ (writer.GetNRecords (), 4, "records written");
+  NS_TEST_ASSERT_MSG_EQ (ReadFile (path), "first\nlast\n" + text, "dropped texts left out");
+  std::remove (path.c_str ());
+}
+
+class KdtmCoreTestCase : public TestCase
+{
+public:
+  KdtmCoreTestCase ();
+  virtual ~KdtmCoreTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+KdtmCoreTestCase::KdtmCoreTestCase ()
+  : TestCase ("Kdtm protocol core without the simulator")
+{
+}
+
+KdtmCoreTestCase::~KdtmCoreTestCase ()
+{
+}
+
+/// Knows the position of node 3 only
+class FixedPositionSource : public PositionSource
+{
+public:
+  virtual bool GetPosition (uint32_t id, CoreVector & position) const
+  {
+    if (id != 3)
+      {
+        return false;
+      }
+    position = CoreVector (5, 6, 0);
+    return true;
+  }
+};
+
+void
+KdtmCoreTestCase::DoRun (void)
+{
+  // The core on a manual clock computes what the adapter computes on the
+  // simulator clock
+  ManualClock clock (ToTableTime (Simulator::Now ()));
+  NeighborTable core (250, CoreVector (0, 0, 0), CoreVector (25, 0, 0));
+  core.SetClock (&clock);
+  PositionTable table (250, Vector (0, 0, 0), Vector (25, 0, 0));
+  for (uint32_t j = 0; j < 20; j++)
+    {
+      double x = -500.0 + 50.0 * j;
+      core.AddEntry (j, CoreVector (x, 0, 0), CoreVector (20.0 + j, 0, 0), clock.Now (), 0.01, 0);
+      table.AddEntry (j, Vector (x, 0, 0), Vector (20.0 + j, 0, 0), Simulator::Now (), 0.01, Seconds (0));
+    }
+  NS_TEST_ASSERT_MSG_EQ (core.UpdateMyKinematics (clock.Now (), CoreVector (0, 0, 0), CoreVector (25, 5, 0)),
+                         20, "all windows recomputed");
+  table.UpdateMyKinematics (Simulator::Now (), Vector (0, 0, 0), Vector (25, 5, 0));
+  NS_TEST_ASSERT_MSG_EQ (core.CalculateDegree (1.0), table.CalculateDegree (Seconds (1)), "same degree");
+  NS_TEST_ASSERT_MSG_EQ (core.GetVersion (), table.GetVersion (), "same version");
+  std::pair<Time, Time> window = table.GetLinkWindow (7);
+  NS_TEST_ASSERT_MSG_EQ (core.GetLinkWindow (7).second, ToTableTime (window.second), "same window");
+
+  NS_TEST_ASSERT_MSG_EQ (core.GetPosition (10).x, table.GetPosition (10).x, "position of the hello");
+
+  // Purge at the time of the clock
+  NS_TEST_ASSERT_MSG_EQ (core.IsNeighbor (7), true, "neighbor in range");
+  clock.Set (core.GetLinkWindow (7).second);
+  core.Purge ();
+  NS_TEST_ASSERT_MSG_EQ (core.IsNeighbor (7), false, "window ended");
+
+  // Positions of the source first, then of the hellos
+  FixedPositionSource source;
+  core.SetPositionSource (&source);
+  NS_TEST_ASSERT_MSG_EQ (core.GetPosition (3).x, 5, "position of the source");
+  NS_TEST_ASSERT_MSG_EQ (core.GetPosition (99).x, NeighborTable::GetInvalidPosition ().x, "unknown");
+
+  // Queue of copies
+  CopyQueue<CopyEntry> copies;
+  Queue queue;
+  copies.Add (CopyEntry (CoreVector (100, 10, 0), 1, 42, 5));
+  copies.Add (CopyEntry (CoreVector (200, 30, 0), 1, 42, 6));
+  queue.Add (QueueEntry (Vector (100, 10, 0), Seconds (0), Create<Packet> (0), 1, 42, 5));
+  queue.Add (QueueEntry (Vector (200, 30, 0), Seconds (0), Create<Packet> (0), 1, 42, 6));
+  NS_TEST_ASSERT_MSG_EQ (copies.GetMeanPosition (42).x, queue.CalculateSpatialDist (42).x, "same mean");
+  NS_TEST_ASSERT_MSG_EQ (copies.GetMeanPosition (42).y, 20, "mean y");
+  NS_TEST_ASSERT_MSG_EQ ((copies.GetPrevHops (42) == queue.GetPrevHops (42)), true, "same previous hops");
+  NS_TEST_ASSERT_MSG_EQ (copies.Find (42, 5), true, "copy found");
+
+  // The codec writes the bytes of the headers
+  HelloFields hello = { 9, 1, 2, 3, 4, 0x0102030405060708ULL, 6 };
+  std::vector<uint8_t> helloBytes (HELLO_SIZE);
+  EncodeHello (&helloBytes[0], hello);
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (HelloHeader (9, 1, 2, 3, 4, 0x0102030405060708ULL, 6));
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (packet) == helloBytes), true, "hello bytes");
+  HelloFields decoded;
+  DecodeHello (&helloBytes[0], decoded);
+  NS_TEST_ASSERT_MSG_EQ (decoded.trajectoryBegin, hello.trajectoryBegin, "hello round trip");
+
+  CompactWarningFields warning = { 300, 7, 0x10000000, 12, EncodeCompactPosition (-20.04), 5 };
+  std::vector<uint8_t> warningBytes (COMPACT_WARNING_MAX_SIZE);
+  warningBytes.resize (EncodeCompactWarning (&warningBytes[0], warning));
+  packet = Create<Packet> ();
+  packet->AddHeader (CompactWarningHeader (300, 7, 12, 0x10000000, -20.04, 0.5));
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (packet) == warningBytes), true, "compact warning bytes");
+  CompactWarningFields decodedWarning;
+  NS_TEST_ASSERT_MSG_EQ (DecodeCompactWarning (&warningBytes[0], warningBytes.size (), decodedWarning),
+                         warningBytes.size (), "compact warning size");
+  NS_TEST_ASSERT_MSG_EQ (decodedWarning.positionx, -200, "compact warning round trip");
+  NS_TEST_ASSERT_MSG_EQ (DecodeCompactWarning (&warningBytes[0], warningBytes.size () - 1, decodedWarning),
+                         0, "truncated compact warning");
+
+  NeighborSummary summary (2);
+  summary.Add (17);
+  std::vector<uint8_t> summaryBytes (NeighborSummarySize (summary));
+  EncodeNeighborSummary (&summaryBytes[0], summary);
+  packet = Create<Packet> ();
+  packet->AddHeader (NeighborSummaryHeader (summary));
+  NS_TEST_ASSERT_MSG_EQ ((GetBytes (packet) == summaryBytes), true, "summary bytes");
+  NeighborSummary decodedSummary;
+  DecodeNeighborSummary (&summaryBytes[0], summaryBytes.size (), decodedSummary);
+  NS_TEST_ASSERT_MSG_EQ ((decodedSummary == summary), true, "summary round trip");
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -61,6 +1828,30 @@ KdtmTestSuite::KdtmTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new KdtmTestCase1, TestCase::QUICK);
+  AddTestCase (new KdtmPartitionTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmRemotePositionTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmDeadReckoningTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmTraceTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmRecordTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmSnapshotTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmLinkWindowTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmLinkSolverTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmPolicyTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmKineticDegreeTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmDegreePruningTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmHelloFastPathTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmForwardWarningTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmCompactWarningTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmWarningBatchTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmNeighborStateTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmQueueDecisionTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmReplayTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmTxErrorTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmNeighborSummaryTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmHelloSchedulerTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmKpiTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmTraceWriterTestCase, TestCase::QUICK);
+  AddTestCase (new KdtmCoreTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite